@@ -0,0 +1,395 @@
+//C++
+#include <vector>
+#include <functional>
+#include <chrono>
+#include <atomic>
+#include <array>
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+//AbstractionLayer
+#include "Log.hpp"
+#include "OperatingSystemModule.hpp"
+#include "CommandQueue.hpp"
+
+static const char TAG[] = "commandQueue";
+static constexpr Count benchmarkProducers = 8;
+static constexpr Count benchmarkConsumers = 8;
+static constexpr Milliseconds benchmarkDuration = 200;
+static constexpr Count batchBenchmarkCommands = 1 << 20;
+static constexpr std::array<Count, 5> batchSizes = {1, 4, 16, 64, 256};
+
+/// @brief The command used by the shared design in the benchmark.
+struct BenchmarkCommand {
+    static constexpr char Name[] = "BenchmarkCommand";
+    using DataType = uint32_t;
+};
+
+/**
+ * @struct Benchmark
+ * @brief A command queue design and what happened while it was benchmarked.
+ */
+struct Benchmark {
+    ErrorType (*add)(uint32_t &command);  ///< Add a command.
+    ErrorType (*take)(uint32_t &command); ///< Take a command.
+    ErrorType (*wait)();                  ///< Wait for commands.
+    bool exact;                           ///< True if every command added must be taken exactly once.
+    std::atomic<bool> stop = false;
+    std::atomic<Count> producerIndex = 0;
+    std::atomic<Count> consumerIndex = 0;
+    std::atomic<Count> producersRunning = 0;
+    std::atomic<Count> consumersRunning = 0;
+    std::atomic<Count> added = 0;
+    std::atomic<Count> taken = 0;
+    /// @brief The times the consumers blocked while the producers were running.
+    Count consumerSwitches = 0;
+};
+
+static InstanceCommandQueue<BenchmarkCommand::DataType> instanceQueue;
+/// @brief The queue used to benchmark batches. Holds the biggest batch.
+static InstanceCommandQueue<uint32_t, batchSizes.back()> batchQueue;
+/// @brief The number of commands added and taken at once. 1 uses addToQueue and getNextInQueue.
+static Count batchSize = 1;
+static std::atomic<bool> batchConsumerReady = false;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static void *testBenchmarkProducerStartFunction(void *arg) {
+    Benchmark &benchmark = *static_cast<Benchmark *>(arg);
+    //The producer is kept in the top byte so that consumers can check that each producer's commands arrive in order.
+    const uint32_t producer = static_cast<uint32_t>(benchmark.producerIndex++) << 24;
+    uint32_t sequence = 0;
+
+    while (!benchmark.stop) {
+        uint32_t command = producer | sequence;
+        if (ErrorType::Success == benchmark.add(command)) {
+            sequence++;
+        }
+        else {
+            //Full. Gives the consumers a chance to run.
+            OperatingSystem::Instance().delay(Microseconds(10));
+        }
+    }
+
+    benchmark.added += sequence;
+    benchmark.producersRunning--;
+
+    return nullptr;
+}
+
+static void *testBenchmarkConsumerStartFunction(void *arg) {
+    Benchmark &benchmark = *static_cast<Benchmark *>(arg);
+    benchmark.consumerIndex++;
+    std::array<int64_t, benchmarkProducers> lastSequence;
+    lastSequence.fill(-1);
+    Count taken = 0;
+
+    while (true) {
+        uint32_t command;
+        if (ErrorType::Success == benchmark.take(command)) {
+            if (benchmark.exact) {
+                const uint32_t producer = command >> 24;
+                const int64_t sequence = command & 0xFFFFFF;
+                assert(producer < benchmarkProducers);
+                assert(sequence > lastSequence[producer]);
+                lastSequence[producer] = sequence;
+            }
+            taken++;
+            continue;
+        }
+
+        if (benchmark.stop && 0 == benchmark.producersRunning) {
+            break;
+        }
+
+        benchmark.wait();
+    }
+
+    benchmark.taken += taken;
+    benchmark.consumersRunning--;
+
+    return nullptr;
+}
+
+static void *testBatchProducerStartFunction(void *arg) {
+    std::vector<uint32_t> batch(batchSize);
+    uint32_t next = 0;
+
+    while (next < batchBenchmarkCommands) {
+        Count added = 0;
+        ErrorType error;
+
+        if (1 == batchSize) {
+            batch[0] = next;
+            error = batchQueue.addToQueue(batch[0]);
+            added = ErrorType::Success == error ? 1 : 0;
+        }
+        else {
+            const Count toAdd = std::min<Count>(batchSize, batchBenchmarkCommands - next);
+            for (Count i = 0; i < toAdd; i++) {
+                batch[i] = next + i;
+            }
+            error = batchQueue.addToQueueBatch(std::span<uint32_t>(batch.data(), toAdd), added);
+        }
+
+        next += added;
+        if (0 == added) {
+            //Full. Gives the consumer a chance to run.
+            OperatingSystem::Instance().delay(Microseconds(10));
+        }
+    }
+
+    return nullptr;
+}
+
+static void *testBatchConsumerStartFunction(void *arg) {
+    std::vector<uint32_t> batch(batchSize);
+    uint32_t expected = 0;
+    batchConsumerReady = true;
+
+    while (expected < batchBenchmarkCommands) {
+        Count taken = 0;
+
+        if (1 == batchSize) {
+            taken = ErrorType::Success == batchQueue.getNextInQueue(batch[0]) ? 1 : 0;
+        }
+        else {
+            batchQueue.getNextInQueueBatch(batch, taken);
+        }
+
+        //A single producer so every command is in the order it was added.
+        for (Count i = 0; i < taken; i++) {
+            assert(expected++ == batch[i]);
+        }
+        if (0 == taken) {
+            assert(ErrorType::Success == batchQueue.waitForCommands());
+        }
+    }
+
+    return nullptr;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @brief Run producers and consumers on a design for a while.
+ * @param[in] benchmark The design.
+ * @param[in] prefix Makes the thread names unique to the design.
+ * @param[out] commandsPerSecond The commands taken per second.
+ */
+static void runBenchmark(Benchmark &benchmark, const char *prefix, double &commandsPerSecond) {
+    benchmark.producersRunning = benchmarkProducers;
+    benchmark.consumersRunning = benchmarkConsumers;
+    std::array<std::array<char, OperatingSystemTypes::MaxThreadNameLength>, benchmarkConsumers> consumerNames;
+    std::array<std::array<char, OperatingSystemTypes::MaxThreadNameLength>, benchmarkProducers> producerNames;
+    std::array<Id, benchmarkConsumers> consumers;
+    Id threadId;
+
+    for (Count i = 0; i < benchmarkConsumers; i++) {
+        snprintf(consumerNames[i].data(), consumerNames[i].size(), "%sCons%u", prefix, static_cast<unsigned>(i));
+        assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, consumerNames[i], &benchmark, 16384, testBenchmarkConsumerStartFunction, consumers[i]));
+    }
+    while (benchmark.consumerIndex < benchmarkConsumers);
+
+    const auto startTime = std::chrono::steady_clock::now();
+    for (Count i = 0; i < benchmarkProducers; i++) {
+        snprintf(producerNames[i].data(), producerNames[i].size(), "%sProd%u", prefix, static_cast<unsigned>(i));
+        assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, producerNames[i], &benchmark, 16384, testBenchmarkProducerStartFunction, threadId));
+    }
+
+    OperatingSystem::Instance().delay(benchmarkDuration);
+    for (const auto &thread : OperatingSystem::Instance().status(true).threads) {
+        if (consumers.end() != std::find(consumers.begin(), consumers.end(), thread.id)) {
+            benchmark.consumerSwitches += thread.voluntaryContextSwitches;
+        }
+    }
+    benchmark.stop = true;
+    for (const auto &name : producerNames) {
+        assert(ErrorType::Success == OperatingSystem::Instance().joinThread(name));
+    }
+
+    //A design that can miss a wakeup would otherwise leave consumers waiting forever once the producers are gone.
+    while (benchmark.consumersRunning > 0) {
+        for (const Id consumer : consumers) {
+            OperatingSystem::Instance().unblock(consumer);
+        }
+        OperatingSystem::Instance().delay(Milliseconds(1));
+    }
+    for (const auto &name : consumerNames) {
+        assert(ErrorType::Success == OperatingSystem::Instance().joinThread(name));
+    }
+
+    commandsPerSecond = benchmark.taken / std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+/**
+ * @brief Queues of the same type keep their own commands.
+ */
+static int instanceTest() {
+    InstanceCommandQueue<uint32_t, 4> first;
+    InstanceCommandQueue<uint32_t, 4> second;
+    uint32_t command;
+
+    assert(ErrorType::NoData == first.getNextInQueue(command));
+    assert(!first.commandsReady());
+
+    for (uint32_t i = 0; i < 4; i++) {
+        command = i;
+        assert(ErrorType::Success == first.addToQueue(command));
+    }
+    command = 4;
+    assert(ErrorType::LimitReached == first.addToQueue(command));
+    assert(4 == first.status().commandsQueued);
+    assert(0 == second.status().commandsQueued);
+    assert(!second.commandsReady());
+    assert(ErrorType::NoData == second.getNextInQueue(command));
+
+    for (uint32_t i = 0; i < 4; i++) {
+        assert(ErrorType::Success == first.getNextInQueue(command));
+        assert(i == command);
+    }
+    assert(ErrorType::NoData == first.getNextInQueue(command));
+    assert(0 == first.status().commandsQueued);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Compare waking one waiting thread per command against waking all of them, with 8 producers and 8 consumers.
+ */
+static int multiConsumerBenchmark() {
+    //The shared design isn't checked for exactness because a consumer can take a position before the producer has written to it.
+    Benchmark shared;
+    shared.add = [](uint32_t &command) { return CommandQueue<BenchmarkCommand::Name, BenchmarkCommand::DataType>().addToQueue(command); };
+    shared.take = [](uint32_t &command) { return CommandQueue<BenchmarkCommand::Name, BenchmarkCommand::DataType>().getNextInQueue(command); };
+    shared.wait = []() { return CommandQueueTypes::WaitForCommands<BenchmarkCommand>(); };
+    shared.exact = false;
+
+    Benchmark instance;
+    instance.add = [](uint32_t &command) { return instanceQueue.addToQueue(command); };
+    instance.take = [](uint32_t &command) { return instanceQueue.getNextInQueue(command); };
+    instance.wait = []() { return instanceQueue.waitForCommands(); };
+    instance.exact = true;
+
+    double sharedRate;
+    double instanceRate;
+    runBenchmark(shared, "sh", sharedRate);
+    runBenchmark(instance, "in", instanceRate);
+
+    assert(instance.added == instance.taken);
+    assert(!instanceQueue.commandsReady());
+
+    PLT_LOGI(TAG, "%u producers, %u consumers: %.0f commands/s waking all, %.0f commands/s waking one", benchmarkProducers, benchmarkConsumers, sharedRate, instanceRate);
+    PLT_LOGI(TAG, "Consumer context switches per 1000 commands: %.2f waking all, %.2f waking one",
+             1000.0 * shared.consumerSwitches / shared.taken, 1000.0 * instance.consumerSwitches / instance.taken);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Batches are added and taken in order and stop at the ends of the queue.
+ */
+static int batchTest() {
+    InstanceCommandQueue<uint32_t, 8> queue;
+    std::array<uint32_t, 6> commands = {0, 1, 2, 3, 4, 5};
+    std::array<uint32_t, 6> taken;
+    Count count;
+
+    assert(ErrorType::NoData == queue.getNextInQueueBatch(taken, count));
+    assert(0 == count);
+
+    assert(ErrorType::Success == queue.addToQueueBatch(commands, count));
+    assert(6 == count);
+    //Only the first two fit.
+    commands = {6, 7, 8, 9, 10, 11};
+    assert(ErrorType::LimitReached == queue.addToQueueBatch(commands, count));
+    assert(2 == count);
+    assert(8 == queue.status().commandsQueued);
+    assert(ErrorType::LimitReached == queue.addToQueueBatch(std::span<uint32_t>(commands).subspan(count), count));
+    assert(0 == count);
+
+    assert(ErrorType::Success == queue.getNextInQueueBatch(std::span<uint32_t>(taken).first(3), count));
+    assert(3 == count);
+    for (uint32_t i = 0; i < count; i++) {
+        assert(i == taken[i]);
+    }
+
+    //Single commands and batches share the same order.
+    uint32_t command;
+    assert(ErrorType::Success == queue.getNextInQueue(command));
+    assert(3 == command);
+    command = 12;
+    assert(ErrorType::Success == queue.addToQueue(command));
+
+    //Wraps around the end of the ring.
+    assert(ErrorType::Success == queue.getNextInQueueBatch(taken, count));
+    assert(5 == count);
+    const std::array<uint32_t, 5> expected = {4, 5, 6, 7, 12};
+    assert(std::equal(expected.begin(), expected.end(), taken.begin()));
+    assert(ErrorType::NoData == queue.getNextInQueueBatch(taken, count));
+    assert(0 == queue.status().commandsQueued);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Commands per second from one producer to one consumer for each batch size.
+ */
+static int batchBenchmark() {
+    std::array<std::array<char, OperatingSystemTypes::MaxThreadNameLength>, batchSizes.size()> producerNames;
+    std::array<std::array<char, OperatingSystemTypes::MaxThreadNameLength>, batchSizes.size()> consumerNames;
+    Id threadId;
+
+    for (Count i = 0; i < batchSizes.size(); i++) {
+        batchSize = batchSizes[i];
+        batchConsumerReady = false;
+        snprintf(producerNames[i].data(), producerNames[i].size(), "batchProd%u", static_cast<unsigned>(i));
+        snprintf(consumerNames[i].data(), consumerNames[i].size(), "batchCons%u", static_cast<unsigned>(i));
+
+        assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, consumerNames[i], nullptr, 16384, testBatchConsumerStartFunction, threadId));
+        while (!batchConsumerReady);
+
+        const auto startTime = std::chrono::steady_clock::now();
+        assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, producerNames[i], nullptr, 16384, testBatchProducerStartFunction, threadId));
+        assert(ErrorType::Success == OperatingSystem::Instance().joinThread(producerNames[i]));
+        assert(ErrorType::Success == OperatingSystem::Instance().joinThread(consumerNames[i]));
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        assert(!batchQueue.commandsReady());
+        PLT_LOGI(TAG, "Batches of %u: %.0f commands/s", static_cast<unsigned>(batchSize), batchBenchmarkCommands / elapsed);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static int runAllTests() {
+    std::vector<std::function<int(void)>> tests = {
+        instanceTest,
+        multiConsumerBenchmark,
+        batchTest,
+        batchBenchmark,
+    };
+
+    for (auto test : tests) {
+        if (EXIT_SUCCESS != test()) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int main() {
+
+    OperatingSystem::Init();
+    Logger::Init();
+
+    int result = runAllTests();
+
+    return result;
+}
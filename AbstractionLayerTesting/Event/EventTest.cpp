@@ -0,0 +1,1226 @@
+//C++
+#include <vector>
+#include <functional>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <optional>
+#include <bit>
+#ifdef __linux__
+//Posix
+#include <sys/epoll.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+//AbstractionLayer
+#include "Log.hpp"
+#include "OperatingSystemModule.hpp"
+#include "EventQueue.hpp"
+#include "Coroutine.hpp"
+
+static const char TAG[] = "event";
+static constexpr Count maxProducers = 8;
+static constexpr Count eventsPerProducer = 5000;
+
+/**
+ * @class TestEventQueue
+ * @brief An event queue that is run by the consumer thread.
+ */
+class TestEventQueue : public EventQueue {
+    public:
+    /// @brief Make the calling thread the one that runs the events.
+    void becomeOwner() {
+        Id self;
+        OperatingSystem::Instance().currentThreadId(self);
+        changeOwner(self);
+    }
+};
+
+static TestEventQueue eventQueue;
+static EventQueue::LoopMode consumerLoopMode = EventQueue::LoopMode::Blocking;
+static Count producers = 0;
+static std::atomic<bool> consumerReady = false;
+static std::atomic<bool> producersGo = false;
+static std::atomic<Count> producerIndex = 0;
+static std::atomic<Count> queueFull = 0;
+/// @brief The last sequence number run for each producer. Only touched by the consumer.
+static std::array<Count, maxProducers> lastSequence;
+static Count eventsRun = 0;
+static Count emptyEvents = 0;
+static TestEventQueue drainQueue;
+/// @brief As many events as fit in the queue.
+static constexpr Count drainEvents = APP_MAX_QUEUEABLE_EVENTS;
+static constexpr Count quickDrainEvents = drainEvents / 2;
+static_assert(quickDrainEvents >= 2 && drainEvents - quickDrainEvents >= 4, "Not enough room in the queue to check the drain budgets.");
+static std::atomic<bool> drainerReady = false;
+static std::atomic<bool> fillerDone = false;
+static std::atomic<bool> drainerWaiting = false;
+/// @brief The number of events run from drainQueue. Only touched by the drainer.
+static Count drained = 0;
+static TestEventQueue laneQueue;
+/// @brief Which step of the priority test the filler or runner is on.
+static std::atomic<Count> laneStep = 0;
+/// @brief The tags of the events run from laneQueue in the order they were run. Only touched by the runner.
+static std::vector<int> laneOrder;
+static TestEventQueue timerQueue;
+static std::atomic<bool> timerRunnerWaiting = false;
+/// @brief The tags of the events run from timerQueue in the order they were run. Only touched by the timer runner.
+static std::vector<int> timerOrder;
+static TestEventQueue futureQueue;
+static std::atomic<bool> futureRunnerReady = false;
+/// @brief Set by the last event added to futureQueue. Only touched by the future runner.
+static bool futureRunnerDone = false;
+/// @brief The queue that coroutines are started on.
+static TestEventQueue coroutineQueue;
+/// @brief The queue that runs the operations the coroutines wait for.
+static TestEventQueue workQueue;
+static std::atomic<bool> workRunnerReady = false;
+/// @brief Keeps the work runner from running operations until every coroutine is waiting on one.
+static EventQueue::Future<> workGate;
+static std::optional<EventQueue::Future<>::Promise> workGatePromise;
+/// @brief Set by the last event added to workQueue. Only touched by the work runner.
+static bool workRunnerDone = false;
+/// @brief Holds the coroutine runner in an event while the work runner fills coroutineQueue.
+static EventQueue::Future<> resumeGate;
+static std::optional<EventQueue::Future<>::Promise> resumeGatePromise;
+/// @brief Coroutines waiting for an operation. Only touched by the coroutine runner.
+static Count coroutinesInFlight = 0;
+/// @brief Coroutines that have finished. Only touched by the coroutine runner.
+static Count coroutinesFinished = 0;
+/// @brief The queue whose overflow policies are checked.
+static TestEventQueue overflowQueue;
+static std::atomic<bool> overflowRunnerReady = false;
+/// @brief Keeps the overflow runner from running events until the filler has checked every policy that drops or rejects events.
+static EventQueue::Future<> overflowGate;
+static std::optional<EventQueue::Future<>::Promise> overflowGatePromise;
+/// @brief Set by the last event added to overflowQueue. Only touched by the overflow runner.
+static bool overflowRunnerDone = false;
+/// @brief The tags of the events run from overflowQueue in the order they were run.
+static std::vector<int> overflowOrder;
+/// @brief The queue run by a group of workers.
+static TestEventQueue workerGroupQueue;
+static constexpr Count eventWorkers = 4;
+static constexpr Count affinityKeys = 3;
+static constexpr Count eventsPerAffinityKey = 20;
+/// @brief The number of events from workerGroupQueue running right now.
+static std::atomic<Count> eventsRunning = 0;
+/// @brief The most events from workerGroupQueue that were ever running at once.
+static std::atomic<Count> mostEventsRunning = 0;
+static std::atomic<Count> workerEventsFinished = 0;
+/// @brief True while an event with that affinity key is running.
+static std::array<std::atomic<bool>, affinityKeys> affinityKeyRunning;
+/// @brief The order the events of each affinity key were run in. Only touched by the event with the key that is running.
+static std::array<std::vector<Count>, affinityKeys> affinityOrder;
+#ifdef __linux__
+/// @brief The queue run with LoopMode::Descriptors.
+static TestEventQueue descriptorQueue;
+/// @brief The queue whose wake descriptor is polled by the test instead of by the queue.
+static TestEventQueue pollingQueue;
+/// @brief The pipe watched by descriptorQueue. The read end is first.
+static std::array<int, 2> descriptorPipe = {-1, -1};
+static std::atomic<bool> descriptorRunnerReady = false;
+/// @brief Set by the last event added to descriptorQueue. Only touched by the descriptor runner.
+static bool descriptorRunnerDone = false;
+/// @brief The bytes read from the pipe by the handler.
+static std::atomic<Count> descriptorBytesRead = 0;
+/// @brief The number of times the descriptor runner has come back from runEvents.
+static std::atomic<Count> descriptorLoops = 0;
+#endif
+/// @brief Heap allocations made by events while they were created and added.
+static std::atomic<Count> eventAllocations = 0;
+/// @brief Heap allocations made by std::function while holding the same callbacks.
+static std::atomic<Count> functionAllocations = 0;
+/// @brief Heap allocations made by the current thread.
+static thread_local Count allocations = 0;
+
+//Not inlined so that the compiler doesn't mistake the replacements for a mismatched malloc and delete.
+[[gnu::noinline]] void *operator new(std::size_t size) {
+    allocations++;
+    void *memory = std::malloc(size > 0 ? size : 1);
+    if (nullptr == memory) {
+        std::abort();
+    }
+
+    return memory;
+}
+
+[[gnu::noinline]] void operator delete(void *memory) noexcept {
+    std::free(memory);
+}
+
+[[gnu::noinline]] void operator delete(void *memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+//Coroutines are kept out of the extern "C" block since they can't have C linkage.
+
+/// @brief Wait for an operation on the work queue.
+static EventQueue::Task inFlightTask() {
+    coroutinesInFlight++;
+    const ErrorType error = co_await workQueue.awaitEvent([]() -> ErrorType {
+        assert(workQueue.currentThreadIsOwner());
+        return ErrorType::Success;
+    });
+    //Resumed where it was started rather than where the operation ran.
+    assert(coroutineQueue.currentThreadIsOwner());
+    coroutinesInFlight--;
+    coroutinesFinished++;
+
+    co_return error;
+}
+
+static EventQueue::Task doubleTask(int &value) {
+    co_return co_await workQueue.awaitEvent([&value]() -> ErrorType {
+        value *= 2;
+        return ErrorType::Success;
+    });
+}
+
+static EventQueue::Task composedTask() {
+    int value = 21;
+    assert(ErrorType::Success == co_await doubleTask(value));
+    assert(42 == value);
+    assert(coroutineQueue.currentThreadIsOwner());
+
+    //Move to the work queue, where its operations run without waiting, and back.
+    assert(ErrorType::Success == co_await workQueue.schedule());
+    assert(workQueue.currentThreadIsOwner());
+    bool ran = false;
+    assert(ErrorType::Success == co_await workQueue.awaitEvent([&ran]() -> ErrorType {
+        ran = true;
+        return ErrorType::Success;
+    }));
+    assert(ran);
+    assert(ErrorType::Success == co_await coroutineQueue.schedule());
+    assert(coroutineQueue.currentThreadIsOwner());
+
+    assert(ErrorType::Timeout == co_await workQueue.awaitEvent([]() -> ErrorType { return ErrorType::Timeout; }));
+
+    co_return ErrorType::EndOfFile;
+}
+
+/**
+ * @brief Wait for another thread to reach a step of a test.
+ * @details Sleeps between checks instead of spinning so that on a single core the thread being waited for gets to run.
+ */
+template <typename Condition>
+static void waitUntil(Condition condition) {
+    while (!condition()) {
+        OperatingSystem::Instance().delay(Microseconds(50));
+    }
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static void *testConsumerStartFunction(void *arg) {
+    eventQueue.becomeOwner();
+    consumerReady = true;
+
+    while (eventsRun < producers * eventsPerProducer) {
+        if (ErrorType::InvalidParameter == eventQueue.mainLoop(consumerLoopMode)) {
+            emptyEvents++;
+        }
+    }
+
+    return nullptr;
+}
+
+static void *testProducerStartFunction(void *arg) {
+    const Count producer = producerIndex++;
+    waitUntil([&]() { return producersGo.load(); });
+
+    for (Count sequence = 1; sequence <= eventsPerProducer; sequence++) {
+        auto callback = [producer, sequence]() -> ErrorType {
+            //Events from one producer run in the order they were added.
+            assert(lastSequence[producer] + 1 == sequence);
+            lastSequence[producer] = sequence;
+            eventsRun++;
+            return ErrorType::Success;
+        };
+        //About as much as the network and storage callbacks capture.
+        auto largeCallback = [producer, sequence, padding = std::array<uintptr_t, 8>{}]() -> ErrorType {
+            assert(0 == padding[0]);
+            assert(lastSequence[producer] + 1 == sequence);
+            lastSequence[producer] = sequence;
+            eventsRun++;
+            return ErrorType::Success;
+        };
+
+        //Alternate so that callbacks of different sizes pass through the same slots.
+        const bool large = 0 == sequence % 2;
+
+        Count allocationsBefore = allocations;
+        EventQueue::Event event = large ? EventQueue::Event(largeCallback) : EventQueue::Event(callback);
+
+        while (ErrorType::LimitReached == eventQueue.addEvent(event)) {
+            queueFull++;
+            OperatingSystem::Instance().delay(Microseconds(10));
+        }
+        eventAllocations += allocations - allocationsBefore;
+
+        allocationsBefore = allocations;
+        std::function<ErrorType()> function = large ? std::function<ErrorType()>(largeCallback) : std::function<ErrorType()>(callback);
+        functionAllocations += allocations - allocationsBefore;
+    }
+
+    return nullptr;
+}
+
+static void *testFillerStartFunction(void *arg) {
+    //The first events are quick so that the count budget can be checked, the rest are slow so that the time budget can be.
+    for (Count i = 0; i < drainEvents; i++) {
+        EventQueue::Event event([i]() -> ErrorType {
+            if (i >= quickDrainEvents) {
+                OperatingSystem::Instance().delay(Milliseconds(1));
+            }
+            drained++;
+            return ErrorType::Success;
+        });
+        assert(ErrorType::Success == drainQueue.addEvent(event));
+    }
+    fillerDone = true;
+
+    //Add one more once the drainer is waiting to check that draining blocks until there is something to run.
+    waitUntil([&]() { return drainerWaiting.load(); });
+    OperatingSystem::Instance().delay(Milliseconds(10));
+    EventQueue::Event event([]() -> ErrorType {
+        drained++;
+        return ErrorType::Success;
+    });
+    assert(ErrorType::Success == drainQueue.addEvent(event));
+
+    return nullptr;
+}
+
+static void *testDrainerStartFunction(void *arg) {
+    Count eventsRun = 0;
+    drainQueue.becomeOwner();
+    drainerReady = true;
+    waitUntil([&]() { return fillerDone.load(); });
+
+    drainQueue.setDrainBudget(quickDrainEvents / 2, 0);
+    assert(ErrorType::Success == drainQueue.runEvents(EventQueue::LoopMode::Drain, eventsRun));
+    assert(quickDrainEvents / 2 == eventsRun);
+    assert(ErrorType::Success == drainQueue.runEvents(EventQueue::LoopMode::Drain, eventsRun));
+    assert(quickDrainEvents / 2 == eventsRun);
+    assert(quickDrainEvents == drained);
+
+    //Every slow event takes at least a millisecond so a few milliseconds of budget can't run them all.
+    drainQueue.setDrainBudget(0, Microseconds(3000));
+    assert(ErrorType::Success == drainQueue.runEvents(EventQueue::LoopMode::Drain, eventsRun));
+    assert(eventsRun >= 1 && eventsRun <= 3);
+    Count total = quickDrainEvents + eventsRun;
+
+    drainQueue.setDrainBudget(0, 0);
+    assert(ErrorType::Success == drainQueue.runEvents(EventQueue::LoopMode::Drain, eventsRun));
+    total += eventsRun;
+    assert(drainEvents == total);
+    assert(drainEvents == drained);
+
+    assert(ErrorType::NoData == drainQueue.runEvents(EventQueue::LoopMode::Polling, eventsRun));
+    assert(0 == eventsRun);
+
+    drainerWaiting = true;
+    do {
+        drainQueue.runEvents(EventQueue::LoopMode::Drain, eventsRun);
+    } while (0 == eventsRun);
+    assert(1 == eventsRun);
+    assert(drainEvents + 1 == drained);
+
+    return nullptr;
+}
+
+#if APP_EVENT_PRIORITY_LANES == 3
+static void addTaggedEvent(const int tag, const EventQueue::Priority priority, const Nanoseconds deadline = 0) {
+    EventQueue::Event event([tag]() -> ErrorType {
+        laneOrder.push_back(tag);
+        return ErrorType::Success;
+    });
+    event.setDeadline(deadline);
+    assert(ErrorType::Success == laneQueue.addEvent(event, priority));
+}
+
+static void *testLaneFillerStartFunction(void *arg) {
+    //Tags are hundreds for the lane, then the order they should run in within the lane.
+    addTaggedEvent(1, EventQueue::Priority::Low);
+    addTaggedEvent(2, EventQueue::Priority::Low);
+    addTaggedEvent(103, EventQueue::Priority::Normal);
+    addTaggedEvent(104, EventQueue::Priority::Normal);
+    addTaggedEvent(102, EventQueue::Priority::Normal, 200);
+    addTaggedEvent(101, EventQueue::Priority::Normal, 100);
+    addTaggedEvent(201, EventQueue::Priority::High);
+    addTaggedEvent(202, EventQueue::Priority::High);
+    laneStep = 1;
+
+    waitUntil([&]() { return 2 == laneStep; });
+    addTaggedEvent(1, EventQueue::Priority::Low);
+    for (int i = 0; i < 20; i++) {
+        addTaggedEvent(200, EventQueue::Priority::High);
+    }
+    laneStep = 3;
+
+    return nullptr;
+}
+
+static void *testLaneRunnerStartFunction(void *arg) {
+    Count eventsRun;
+    laneQueue.becomeOwner();
+    laneQueue.setDrainBudget(0, 0);
+    laneStep = 0;
+    laneOrder.clear();
+    laneOrder.reserve(64);
+
+    waitUntil([&]() { return 1 == laneStep; });
+    const EventQueue::Status status = laneQueue.queueStatus();
+    assert(2 == status.laneDepth[EventQueue::laneOf(EventQueue::Priority::Low)]);
+    assert(4 == status.laneDepth[EventQueue::laneOf(EventQueue::Priority::Normal)]);
+    assert(2 == status.laneDepth[EventQueue::laneOf(EventQueue::Priority::High)]);
+
+    assert(ErrorType::Success == laneQueue.runEvents(EventQueue::LoopMode::Drain, eventsRun));
+    assert(8 == eventsRun);
+    //Highest lane first. Deadlines first within a lane, then FIFO.
+    assert((std::vector<int>{201, 202, 101, 102, 103, 104, 1, 2}) == laneOrder);
+    assert(0 == laneQueue.queueStatus().laneDepth[EventQueue::laneOf(EventQueue::Priority::Normal)]);
+
+    laneOrder.clear();
+    laneStep = 2;
+    waitUntil([&]() { return 3 == laneStep; });
+    assert(ErrorType::Success == laneQueue.runEvents(EventQueue::LoopMode::Drain, eventsRun));
+    assert(21 == eventsRun);
+    //The low priority event doesn't have to wait for every high priority one.
+    const auto low = std::find(laneOrder.begin(), laneOrder.end(), 1);
+    assert(laneOrder.end() != low);
+    assert(low != laneOrder.begin() && low != laneOrder.end() - 1);
+
+    return nullptr;
+}
+#endif
+
+#if APP_MAX_TIMED_EVENTS > 0
+static Nanoseconds now() {
+    Nanoseconds time;
+    OperatingSystem::Instance().monotonicTime(time);
+    return time;
+}
+
+/// @brief Add an event that checks that it didn't run before its time.
+static ErrorType addTimedEvent(const int tag, const Nanoseconds time) {
+    EventQueue::Event event([tag, time]() -> ErrorType {
+        assert(now() >= time);
+        timerOrder.push_back(tag);
+        return ErrorType::Success;
+    });
+
+    return timerQueue.addEventAt(time, event);
+}
+
+/// @brief Run timerQueue until it has run a number of events in total.
+static void runTimedEvents(const Count total) {
+    Count eventsRun;
+    while (timerOrder.size() < total) {
+        timerQueue.runEvents(EventQueue::LoopMode::Drain, eventsRun);
+    }
+}
+
+static void *testTimerRunnerStartFunction(void *arg) {
+    timerQueue.becomeOwner();
+    timerQueue.setDrainBudget(0, 0);
+    timerOrder.clear();
+    timerOrder.reserve(2 * APP_MAX_TIMED_EVENTS);
+
+    //Added out of order, and from the thread that runs them, which must not run them right away.
+    const Nanoseconds start = now();
+    assert(ErrorType::Success == addTimedEvent(3, start + 30000000));
+    assert(ErrorType::Success == addTimedEvent(1, start + 10000000));
+    assert(ErrorType::Success == addTimedEvent(2, start + 20000000));
+    assert(ErrorType::Success == addTimedEvent(0, 1));
+    assert(timerOrder.empty());
+    assert(4 == timerQueue.queueStatus().timedEvents);
+
+    runTimedEvents(4);
+    assert((std::vector<int>{0, 1, 2, 3}) == timerOrder);
+    assert(0 == timerQueue.queueStatus().timedEvents);
+    PLT_LOGI(TAG, "Last timed event ran %.2fms after it was due", static_cast<double>(now() - start - 30000000) / 1000000);
+
+    //Room on the timer heap is limited.
+    timerOrder.clear();
+    const Nanoseconds soon = now() + 1000000;
+    for (Count i = 0; i < APP_MAX_TIMED_EVENTS; i++) {
+        assert(ErrorType::Success == addTimedEvent(i, soon));
+    }
+    assert(ErrorType::LimitReached == addTimedEvent(APP_MAX_TIMED_EVENTS, soon));
+    runTimedEvents(APP_MAX_TIMED_EVENTS);
+    //Events due at the same time run in the order they were added.
+    for (Count i = 0; i < APP_MAX_TIMED_EVENTS; i++) {
+        assert(static_cast<int>(i) == timerOrder[i]);
+    }
+
+    //A new event wakes the queue up before the next timed event is due.
+    timerOrder.clear();
+    const Nanoseconds later = now() + 1000000000;
+    assert(ErrorType::Success == addTimedEvent(1, later));
+    timerRunnerWaiting = true;
+    runTimedEvents(1);
+    assert(0 == timerOrder[0]);
+    assert(now() < later);
+    runTimedEvents(2);
+    assert(1 == timerOrder[1]);
+
+    return nullptr;
+}
+
+static void *testTimerAdderStartFunction(void *arg) {
+    OperatingSystem::Instance().delay(Milliseconds(10));
+
+    EventQueue::Event event([]() -> ErrorType {
+        timerOrder.push_back(0);
+        return ErrorType::Success;
+    });
+    assert(ErrorType::Success == timerQueue.addEvent(event));
+
+    return nullptr;
+}
+#endif
+
+static void *testFutureRunnerStartFunction(void *arg) {
+    futureQueue.becomeOwner();
+    futureRunnerReady = true;
+
+    Count eventsRun;
+    while (!futureRunnerDone) {
+        futureQueue.runEvents(EventQueue::LoopMode::Drain, eventsRun);
+    }
+
+    return nullptr;
+}
+
+/// @brief Add an event to futureQueue that completes a promise with a value.
+static ErrorType addCompletingEvent(EventQueue::Future<int> &future, const int value, const Microseconds delay = 0) {
+    EventQueue::Event event([promise = future.promise(), value]() -> ErrorType {
+        promise.complete(value);
+        return ErrorType::Success;
+    });
+
+    return 0 == delay ? futureQueue.addEvent(event) : futureQueue.addEventAfter(delay, event);
+}
+
+static void *testFutureWaiterStartFunction(void *arg) {
+    //Several operations in flight at once.
+    EventQueue::Future<int> first, second, third;
+    assert(ErrorType::Success == addCompletingEvent(first, 1));
+    assert(ErrorType::Success == addCompletingEvent(second, 2));
+    assert(ErrorType::Success == addCompletingEvent(third, 3));
+    assert(ErrorType::Success == EventQueue::Completion::waitForAll(0, first, second, third));
+    assert(1 == first.result() && 2 == second.result() && 3 == third.result());
+
+#if APP_MAX_TIMED_EVENTS > 0
+    //Giving up on a wait leaves the future to be completed later.
+    EventQueue::Future<int> late;
+    assert(ErrorType::Success == addCompletingEvent(late, 4, 50000));
+    assert(ErrorType::Timeout == late.waitFor(5000));
+    assert(!late.ready());
+    assert(ErrorType::Success == late.wait());
+    assert(4 == late.result());
+
+    //Being unblocked by anything other than the promise doesn't end the wait.
+    Id self;
+    OperatingSystem::Instance().currentThreadId(self);
+    EventQueue::Future<int> unblocked;
+    assert(ErrorType::Success == addCompletingEvent(unblocked, 5, 10000));
+    OperatingSystem::Instance().unblock(self);
+    assert(ErrorType::Success == unblocked.wait());
+    assert(unblocked.ready() && 5 == unblocked.result());
+#endif
+
+    //A future can be reused once it is ready.
+    assert(ErrorType::Success == addCompletingEvent(first, 6));
+    assert(ErrorType::Success == first.wait());
+    assert(6 == first.result());
+
+    EventQueue::Event stop([]() -> ErrorType {
+        futureRunnerDone = true;
+        return ErrorType::Success;
+    });
+    assert(ErrorType::Success == futureQueue.addEvent(stop));
+
+    return nullptr;
+}
+
+static void *testWorkRunnerStartFunction(void *arg) {
+    workQueue.becomeOwner();
+    workRunnerReady = true;
+    assert(ErrorType::Success == workGate.wait());
+
+    //Hold the coroutine runner and fill its queue so that the coroutines the operations finish can't be resumed through it.
+    EventQueue::Future<> held;
+    EventQueue::Event hold([promise = held.promise()]() -> ErrorType {
+        promise.complete(ErrorType::Success);
+        return resumeGate.wait();
+    });
+    assert(ErrorType::Success == coroutineQueue.addEvent(hold));
+    assert(ErrorType::Success == held.wait());
+    EventQueue::Event filler([]() -> ErrorType { return ErrorType::Success; });
+    while (ErrorType::Success == coroutineQueue.addEvent(filler, EventQueue::Priority::High)) {
+        filler = EventQueue::Event([]() -> ErrorType { return ErrorType::Success; });
+    }
+
+    //Doesn't wait for room in coroutineQueue, which only the held runner could make.
+    Count eventsRun;
+    while (ErrorType::NoData != workQueue.runEvents(EventQueue::LoopMode::Polling, eventsRun));
+    resumeGatePromise->complete(ErrorType::Success);
+
+    while (!workRunnerDone) {
+        workQueue.runEvents(EventQueue::LoopMode::Drain, eventsRun);
+    }
+
+    return nullptr;
+}
+
+static void *testCoroutineRunnerStartFunction(void *arg) {
+    coroutineQueue.becomeOwner();
+    coroutineQueue.setDrainBudget(0, 0);
+    const Count frames = EventQueue::Task::framesAvailable();
+    Count eventsRun;
+
+    //Every frame in the pool waiting on an operation at once, from one thread, without touching the heap.
+    const Count allocationsBefore = allocations;
+    for (Count i = 0; i < APP_MAX_COROUTINES; i++) {
+        assert(ErrorType::Success == coroutineQueue.start(inFlightTask()));
+    }
+    while (coroutinesInFlight < APP_MAX_COROUTINES) {
+        coroutineQueue.runEvents(EventQueue::LoopMode::Drain, eventsRun);
+    }
+    assert(allocationsBefore == allocations);
+    assert(0 == EventQueue::Task::framesAvailable());
+    assert(ErrorType::NoMemory == coroutineQueue.start(inFlightTask()));
+
+    workGatePromise->complete(ErrorType::Success);
+    while (coroutinesFinished < APP_MAX_COROUTINES) {
+        coroutineQueue.runEvents(EventQueue::LoopMode::Drain, eventsRun);
+    }
+    assert(0 == coroutinesInFlight);
+    assert(frames == EventQueue::Task::framesAvailable());
+
+    EventQueue::Future<> done;
+    assert(ErrorType::Success == coroutineQueue.start(composedTask(), &done));
+    while (!done.ready()) {
+        coroutineQueue.runEvents(EventQueue::LoopMode::Drain, eventsRun);
+    }
+    assert(ErrorType::EndOfFile == done.result());
+    assert(frames == EventQueue::Task::framesAvailable());
+
+    EventQueue::Event stop([]() -> ErrorType {
+        workRunnerDone = true;
+        return ErrorType::Success;
+    });
+    assert(ErrorType::Success == workQueue.addEvent(stop));
+
+    return nullptr;
+}
+
+static void *testOverflowRunnerStartFunction(void *arg) {
+    overflowQueue.becomeOwner();
+    overflowRunnerReady = true;
+    assert(ErrorType::Success == overflowGate.wait());
+
+    Count eventsRun;
+    while (!overflowRunnerDone) {
+        overflowQueue.runEvents(EventQueue::LoopMode::Drain, eventsRun);
+    }
+
+    return nullptr;
+}
+
+static ErrorType addOverflowEvent(const int tag, const Id key = 0) {
+    EventQueue::Event event([tag]() -> ErrorType {
+        overflowOrder.push_back(tag);
+        return ErrorType::Success;
+    });
+    event.setCoalescingKey(key);
+
+    return overflowQueue.addEvent(event);
+}
+
+/// @brief Run the events in overflowQueue from the filler while the runner is held back.
+static void runOverflowEvents() {
+    Count eventsRun;
+    while (ErrorType::NoData != overflowQueue.runEvents(EventQueue::LoopMode::Polling, eventsRun));
+}
+
+static void *testOverflowFillerStartFunction(void *arg) {
+    constexpr int capacity = static_cast<int>(std::bit_ceil(static_cast<Count>(APP_MAX_QUEUEABLE_EVENTS)));
+    overflowOrder.clear();
+    overflowOrder.reserve(2 * capacity);
+
+    for (int i = 0; i < capacity; i++) {
+        assert(ErrorType::Success == addOverflowEvent(i));
+    }
+    assert(ErrorType::LimitReached == addOverflowEvent(-1));
+
+    overflowQueue.setOverflowPolicy(EventQueue::OverflowPolicy::DropNewest);
+    assert(ErrorType::Success == addOverflowEvent(-1));
+    assert(1 == overflowQueue.queueStatus().eventsDropped);
+
+    //The oldest event is dropped and the new one waits behind the others.
+    overflowQueue.setOverflowPolicy(EventQueue::OverflowPolicy::DropOldest);
+    assert(ErrorType::Success == addOverflowEvent(capacity));
+    assert(2 == overflowQueue.queueStatus().eventsDropped);
+    assert(capacity == static_cast<int>(overflowQueue.queueStatus().laneDepth[EventQueue::laneOf(EventQueue::Priority::Normal)]));
+    runOverflowEvents();
+    std::vector<int> expected;
+    for (int i = 1; i <= capacity; i++) {
+        expected.push_back(i);
+    }
+    assert(expected == overflowOrder);
+
+#if APP_MAX_TIMED_EVENTS > 0
+    //Events the queue adds for itself are never dropped.
+    EventQueue::Event timed([]() -> ErrorType {
+        overflowOrder.push_back(-1);
+        return ErrorType::Success;
+    });
+    assert(ErrorType::Success == overflowQueue.addEventAt(1, timed));
+    for (int i = 1; i < capacity; i++) {
+        EventQueue::Event event([]() -> ErrorType { return ErrorType::Success; });
+        assert(ErrorType::Success == overflowQueue.addEvent(event, EventQueue::Priority::High));
+    }
+    EventQueue::Event event([]() -> ErrorType { return ErrorType::Success; });
+    assert(ErrorType::LimitReached == overflowQueue.addEvent(event, EventQueue::Priority::High));
+    overflowOrder.clear();
+    runOverflowEvents();
+    assert((std::vector<int>{-1}) == overflowOrder);
+#endif
+
+    //Events with the same key replace each other, whether or not the thread running the events has seen the one waiting.
+    overflowOrder.clear();
+    assert(ErrorType::Success == addOverflowEvent(1, 7));
+    assert(ErrorType::Success == addOverflowEvent(2));
+    assert(ErrorType::Success == addOverflowEvent(3, 7));
+    assert(ErrorType::Success == addOverflowEvent(4, 9));
+    assert(1 == overflowQueue.queueStatus().eventsCoalesced);
+    Count eventsRun;
+    assert(ErrorType::Success == overflowQueue.runEvents(EventQueue::LoopMode::Polling, eventsRun));
+    assert(ErrorType::Success == addOverflowEvent(5, 9));
+    assert(2 == overflowQueue.queueStatus().eventsCoalesced);
+    runOverflowEvents();
+    assert((std::vector<int>{3, 2, 5}) == overflowOrder);
+    assert(2 == overflowQueue.queueStatus().eventsDropped);
+
+    //An event that would sort differently is added instead of replacing the one with the same key.
+    overflowOrder.clear();
+    assert(ErrorType::Success == addOverflowEvent(6, 7));
+    EventQueue::Event urgent([]() -> ErrorType {
+        overflowOrder.push_back(7);
+        return ErrorType::Success;
+    });
+    urgent.setCoalescingKey(7);
+    urgent.setDeadline(1);
+    assert(ErrorType::Success == overflowQueue.addEvent(urgent));
+    assert(2 == overflowQueue.queueStatus().eventsCoalesced);
+    runOverflowEvents();
+    assert((std::vector<int>{7, 6}) == overflowOrder);
+
+    //Nothing is running the events so the producer gives up.
+    overflowQueue.setOverflowPolicy(EventQueue::OverflowPolicy::Block, 5000);
+    for (int i = 0; i < capacity; i++) {
+        assert(ErrorType::Success == addOverflowEvent(i));
+    }
+    assert(ErrorType::Timeout == addOverflowEvent(-1));
+
+    //The producer waits for the runner to make room.
+    overflowQueue.setOverflowPolicy(EventQueue::OverflowPolicy::Block, 1000000);
+    overflowGatePromise->complete(ErrorType::Success);
+    assert(ErrorType::Success == addOverflowEvent(capacity));
+
+    EventQueue::Event stop([]() -> ErrorType {
+        overflowRunnerDone = true;
+        return ErrorType::Success;
+    });
+    assert(ErrorType::Success == overflowQueue.addEvent(stop));
+
+    return nullptr;
+}
+
+/// @brief Count the events running from workerGroupQueue while this one does, then wait a little so that others can start.
+static void runWorkerGroupEvent(const Microseconds duration) {
+    const Count running = ++eventsRunning;
+    Count most = mostEventsRunning.load();
+    while (running > most && !mostEventsRunning.compare_exchange_weak(most, running));
+
+    OperatingSystem::Instance().delay(duration);
+    eventsRunning--;
+    workerEventsFinished++;
+}
+
+static void *testWorkerGroupProducerStartFunction(void *arg) {
+    //Events without an affinity key run in parallel.
+    for (Count i = 0; i < eventWorkers; i++) {
+        EventQueue::Event event([]() -> ErrorType {
+            runWorkerGroupEvent(20000);
+            return ErrorType::Success;
+        });
+        assert(ErrorType::Success == workerGroupQueue.addEvent(event));
+    }
+    while (workerEventsFinished < eventWorkers) {
+        OperatingSystem::Instance().delay(Milliseconds(1));
+    }
+    assert(mostEventsRunning > 1);
+
+    //Events with the same affinity key run one at a time and in order. Different keys still run alongside each other.
+    mostEventsRunning = 0;
+    workerEventsFinished = 0;
+    for (Count i = 0; i < eventsPerAffinityKey; i++) {
+        for (Count key = 0; key < affinityKeys; key++) {
+            EventQueue::Event event([key, i]() -> ErrorType {
+                assert(!affinityKeyRunning[key].exchange(true));
+                affinityOrder[key].push_back(i);
+                runWorkerGroupEvent(1000);
+                affinityKeyRunning[key] = false;
+                return ErrorType::Success;
+            });
+            event.setAffinityKey(key + 1);
+            while (ErrorType::LimitReached == workerGroupQueue.addEvent(event)) {
+                OperatingSystem::Instance().delay(Milliseconds(1));
+            }
+        }
+    }
+    while (workerEventsFinished < affinityKeys * eventsPerAffinityKey) {
+        OperatingSystem::Instance().delay(Milliseconds(1));
+    }
+    assert(mostEventsRunning > 1);
+    for (const auto &order : affinityOrder) {
+        assert(eventsPerAffinityKey == order.size());
+        assert(std::is_sorted(order.begin(), order.end()));
+    }
+
+#if APP_MAX_TIMED_EVENTS > 0
+    //A timed event holds its affinity key while it runs the same as any other so the events added behind it wait for it.
+    workerEventsFinished = 0;
+    affinityOrder[0].clear();
+    for (Count i = 0; i < 4; i++) {
+        EventQueue::Event event([i]() -> ErrorType {
+            assert(!affinityKeyRunning[0].exchange(true));
+            affinityOrder[0].push_back(i);
+            runWorkerGroupEvent(0 == i ? 20000 : 1000);
+            affinityKeyRunning[0] = false;
+            return ErrorType::Success;
+        });
+        event.setAffinityKey(1);
+        if (0 == i) {
+            assert(ErrorType::Success == workerGroupQueue.addEventAfter(1000, event));
+            waitUntil([]() { return affinityKeyRunning[0].load(); });
+        }
+        else {
+            assert(ErrorType::Success == workerGroupQueue.addEvent(event));
+        }
+    }
+    waitUntil([]() { return 4 == workerEventsFinished; });
+    assert((std::vector<Count>{0, 1, 2, 3}) == affinityOrder[0]);
+#endif
+
+    //A worker adding an event to its own queue runs it right away so that blocking calls made from events don't wait on themselves.
+    EventQueue::Future<> nested;
+    EventQueue::Event outer([promise = nested.promise()]() -> ErrorType {
+        EventQueue::Event inner([]() -> ErrorType { return ErrorType::EndOfFile; });
+        promise.complete(workerGroupQueue.addEvent(inner));
+        return ErrorType::Success;
+    });
+    assert(ErrorType::Success == workerGroupQueue.addEvent(outer));
+    assert(ErrorType::Success == nested.wait());
+    assert(ErrorType::EndOfFile == nested.result());
+
+    return nullptr;
+}
+
+#ifdef __linux__
+static void *testDescriptorRunnerStartFunction(void *arg) {
+    descriptorQueue.becomeOwner();
+    assert(ErrorType::Success == descriptorQueue.watchDescriptor(descriptorPipe[0], EPOLLIN, [](const int descriptor, const uint32_t readyEvents) -> ErrorType {
+        assert(readyEvents & EPOLLIN);
+        char byte;
+        while (1 == read(descriptor, &byte, sizeof(byte))) {
+            descriptorBytesRead++;
+        }
+        return ErrorType::Success;
+    }));
+    assert(ErrorType::InvalidParameter == descriptorQueue.watchDescriptor(-1, EPOLLIN, [](const int, const uint32_t) -> ErrorType { return ErrorType::Success; }));
+    descriptorRunnerReady = true;
+
+    Count eventsRun;
+    while (!descriptorRunnerDone) {
+        assert(ErrorType::Success == descriptorQueue.runEvents(EventQueue::LoopMode::Descriptors, eventsRun));
+        descriptorLoops++;
+    }
+
+    assert(ErrorType::Success == descriptorQueue.unwatchDescriptor(descriptorPipe[0]));
+    assert(ErrorType::FileNotFound == descriptorQueue.unwatchDescriptor(descriptorPipe[0]));
+
+    return nullptr;
+}
+
+static void *testDescriptorWriterStartFunction(void *arg) {
+    //The runner wakes up for the pipe.
+    const char byte = 'x';
+    assert(sizeof(byte) == write(descriptorPipe[1], &byte, sizeof(byte)));
+    while (1 != descriptorBytesRead) {
+        OperatingSystem::Instance().delay(Milliseconds(1));
+    }
+
+    //And for events, including timed ones.
+    EventQueue::Future<> ran;
+    EventQueue::Event event([promise = ran.promise()]() -> ErrorType {
+        promise.complete(ErrorType::EndOfFile);
+        return ErrorType::Success;
+    });
+    assert(ErrorType::Success == descriptorQueue.addEvent(event));
+    assert(ErrorType::Success == ran.wait());
+    assert(ErrorType::EndOfFile == ran.result());
+
+#if APP_MAX_TIMED_EVENTS > 0
+    EventQueue::Future<> timed;
+    EventQueue::Event timedEvent([promise = timed.promise()]() -> ErrorType {
+        promise.complete(ErrorType::EndOfFile);
+        return ErrorType::Success;
+    });
+    assert(ErrorType::Success == descriptorQueue.addEventAfter(5000, timedEvent));
+    assert(ErrorType::Success == timed.wait());
+#endif
+
+    //With nothing to do the runner sleeps instead of coming back around.
+    OperatingSystem::Instance().delay(Milliseconds(10));
+    const Count loops = descriptorLoops;
+    OperatingSystem::Instance().delay(Milliseconds(20));
+    assert(loops == descriptorLoops);
+
+    //The wake descriptor of a queue that isn't waited on by LoopMode::Descriptors is only readable while there are events to run.
+    pollingQueue.becomeOwner();
+    pollfd wake = {};
+    wake.events = POLLIN;
+    assert(ErrorType::Success == pollingQueue.wakeDescriptor(wake.fd));
+    assert(0 == poll(&wake, 1, 0));
+    for (int i = 0; i < 2; i++) {
+        EventQueue::Event pollingEvent([]() -> ErrorType { return ErrorType::Success; });
+        assert(ErrorType::Success == pollingQueue.addEvent(pollingEvent));
+        assert(1 == poll(&wake, 1, 0));
+
+        Count eventsRun;
+        while (ErrorType::NoData != pollingQueue.runEvents(EventQueue::LoopMode::Polling, eventsRun));
+        assert(0 == poll(&wake, 1, 0));
+    }
+
+    EventQueue::Event done([]() -> ErrorType {
+        descriptorRunnerDone = true;
+        return ErrorType::Success;
+    });
+    assert(ErrorType::Success == descriptorQueue.addEvent(done));
+
+    return nullptr;
+}
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @brief Add events from many threads at once and check that every one is run exactly once and in order.
+ * @param[in] producerCount The number of threads adding events.
+ * @param[in] loopMode The mode the consumer runs the event queue in.
+ */
+static int multiProducerTest(const Count producerCount, const EventQueue::LoopMode loopMode) {
+    producers = producerCount;
+    consumerLoopMode = loopMode;
+    eventAllocations = 0;
+    functionAllocations = 0;
+    eventsRun = 0;
+    emptyEvents = 0;
+    producerIndex = 0;
+    queueFull = 0;
+    consumerReady = false;
+    producersGo = false;
+    lastSequence.fill(0);
+
+    Id threadId;
+    assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, {"consumer"}, nullptr, 16384, testConsumerStartFunction, threadId));
+    waitUntil([&]() { return consumerReady.load(); });
+
+    std::array<std::array<char, OperatingSystemTypes::MaxThreadNameLength>, maxProducers> names = {{{"producer0"}, {"producer1"}, {"producer2"}, {"producer3"}, {"producer4"}, {"producer5"}, {"producer6"}, {"producer7"}}};
+    for (Count i = 0; i < producerCount; i++) {
+        assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, names[i], nullptr, 16384, testProducerStartFunction, threadId));
+    }
+    waitUntil([&]() { return producerIndex >= producerCount; });
+
+    const auto startTime = std::chrono::steady_clock::now();
+    producersGo = true;
+    for (Count i = 0; i < producerCount; i++) {
+        assert(ErrorType::Success == OperatingSystem::Instance().joinThread(names[i]));
+    }
+    assert(ErrorType::Success == OperatingSystem::Instance().joinThread({"consumer"}));
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    assert(0 == emptyEvents);
+    assert(producerCount * eventsPerProducer == eventsRun);
+    for (Count i = 0; i < producerCount; i++) {
+        assert(eventsPerProducer == lastSequence[i]);
+    }
+    assert(!eventQueue.eventsReady());
+
+    //Adding an event never allocates, no matter what it captures.
+    assert(0 == eventAllocations);
+
+    PLT_LOGI(TAG, "%u producers: %.0f events/s, queue full %u times", producerCount, eventsRun / elapsed, queueFull.load());
+    PLT_LOGI(TAG, "Allocations per event: %.2f inline, %.2f with std::function", static_cast<double>(eventAllocations) / eventsRun, static_cast<double>(functionAllocations) / eventsRun);
+
+    return EXIT_SUCCESS;
+}
+
+static int singleProducerTest() {
+    return multiProducerTest(1, EventQueue::LoopMode::Blocking);
+}
+
+static int manyProducersTest() {
+    return multiProducerTest(maxProducers, EventQueue::LoopMode::Drain);
+}
+
+/**
+ * @brief Events can hold callbacks that can only be moved.
+ */
+static int moveOnlyCaptureTest() {
+    auto owned = std::make_unique<Count>(42);
+    Count result = 0;
+
+    EventQueue::Event event([owned = std::move(owned), &result]() -> ErrorType {
+        result = *owned;
+        return ErrorType::Success;
+    });
+    EventQueue::Event moved = std::move(event);
+
+    assert(!event.eventCallbackValid());
+    assert(moved.eventCallbackValid());
+    assert(ErrorType::Success == moved.run());
+    assert(42 == result);
+    //Running an event destroys its callback.
+    assert(!moved.eventCallbackValid());
+    assert(ErrorType::InvalidParameter == moved.run());
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Drain runs every queued event in one call unless it runs out of budget, and waits for events when there are none.
+ */
+static int drainBudgetTest() {
+    Id threadId;
+    assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, {"drainer"}, nullptr, 16384, testDrainerStartFunction, threadId));
+    waitUntil([&]() { return drainerReady.load(); });
+    assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, {"filler"}, nullptr, 16384, testFillerStartFunction, threadId));
+
+    assert(ErrorType::Success == OperatingSystem::Instance().joinThread({"filler"}));
+    assert(ErrorType::Success == OperatingSystem::Instance().joinThread({"drainer"}));
+    assert(drainEvents + 1 == drained);
+
+    return EXIT_SUCCESS;
+}
+
+#if APP_EVENT_PRIORITY_LANES == 3
+/**
+ * @brief Higher lanes run first, deadlines order events within a lane, and lower lanes still get a turn.
+ */
+static int priorityTest() {
+    Id threadId;
+    laneStep = 4;
+    assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, {"laneRunner"}, nullptr, 16384, testLaneRunnerStartFunction, threadId));
+    waitUntil([&]() { return 0 == laneStep; });
+    assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, {"laneFiller"}, nullptr, 16384, testLaneFillerStartFunction, threadId));
+
+    assert(ErrorType::Success == OperatingSystem::Instance().joinThread({"laneFiller"}));
+    assert(ErrorType::Success == OperatingSystem::Instance().joinThread({"laneRunner"}));
+    assert(!laneQueue.eventsReady());
+
+    return EXIT_SUCCESS;
+}
+#endif
+
+/**
+ * @brief Timed events run in time order, never early, and the queue sleeps until the next one is due.
+ */
+static int timedEventTest() {
+#if APP_MAX_TIMED_EVENTS > 0
+    //Nothing would ever run the events of a queue whose owner isn't known to the operating system.
+    EventQueue unownedQueue;
+    EventQueue::Event event([]() -> ErrorType { return ErrorType::Success; });
+    assert(ErrorType::PrerequisitesNotMet == unownedQueue.addEventAfter(1000, event));
+
+    Id threadId;
+    assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, {"timerRunner"}, nullptr, 16384, testTimerRunnerStartFunction, threadId));
+    waitUntil([&]() { return timerRunnerWaiting.load(); });
+    assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, {"timerAdder"}, nullptr, 16384, testTimerAdderStartFunction, threadId));
+
+    assert(ErrorType::Success == OperatingSystem::Instance().joinThread({"timerAdder"}));
+    assert(ErrorType::Success == OperatingSystem::Instance().joinThread({"timerRunner"}));
+#else
+    //There is no room for timed events unless the application makes some.
+    EventQueue::Event event([]() -> ErrorType { return ErrorType::Success; });
+    assert(ErrorType::NotSupported == timerQueue.addEventAfter(1000, event));
+#endif
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Futures are completed by events on another thread and can be waited on together or with a timeout.
+ */
+static int futureTest() {
+    //A future that is already complete doesn't need a thread that can be blocked.
+    EventQueue::Future<> complete;
+    complete.promise().complete(ErrorType::NoData);
+    assert(ErrorType::Success == complete.wait());
+    assert(ErrorType::NoData == complete.result());
+
+    //Nothing can unblock a thread that isn't known to the operating system.
+    EventQueue::Future<> incomplete;
+    incomplete.promise();
+    assert(ErrorType::PrerequisitesNotMet == incomplete.wait());
+
+    Id threadId;
+    assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, {"futureRunner"}, nullptr, 16384, testFutureRunnerStartFunction, threadId));
+    waitUntil([&]() { return futureRunnerReady.load(); });
+    assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, {"futureWaiter"}, nullptr, 16384, testFutureWaiterStartFunction, threadId));
+
+    assert(ErrorType::Success == OperatingSystem::Instance().joinThread({"futureWaiter"}));
+    assert(ErrorType::Success == OperatingSystem::Instance().joinThread({"futureRunner"}));
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Coroutines wait for operations on another event queue without blocking the thread they run on.
+ */
+static int coroutineTest() {
+    //A task that is never started gives its frame back.
+    const Count frames = EventQueue::Task::framesAvailable();
+    {
+        EventQueue::Task task = composedTask();
+        assert(task);
+        assert(frames - 1 == EventQueue::Task::framesAvailable());
+    }
+    assert(frames == EventQueue::Task::framesAvailable());
+
+    workGatePromise = workGate.promise();
+    resumeGatePromise = resumeGate.promise();
+    Id threadId;
+    assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, {"workRunner"}, nullptr, 16384, testWorkRunnerStartFunction, threadId));
+    waitUntil([&]() { return workRunnerReady.load(); });
+    assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, {"coroutineRunner"}, nullptr, 16384, testCoroutineRunnerStartFunction, threadId));
+
+    assert(ErrorType::Success == OperatingSystem::Instance().joinThread({"coroutineRunner"}));
+    assert(ErrorType::Success == OperatingSystem::Instance().joinThread({"workRunner"}));
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Full lanes are handled by the overflow policy and events with the same coalescing key replace each other.
+ */
+static int overflowTest() {
+    overflowGatePromise = overflowGate.promise();
+    Id threadId;
+    assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, {"overflowRunner"}, nullptr, 16384, testOverflowRunnerStartFunction, threadId));
+    waitUntil([&]() { return overflowRunnerReady.load(); });
+    assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, {"overflowFiller"}, nullptr, 16384, testOverflowFillerStartFunction, threadId));
+
+    assert(ErrorType::Success == OperatingSystem::Instance().joinThread({"overflowFiller"}));
+    assert(ErrorType::Success == OperatingSystem::Instance().joinThread({"overflowRunner"}));
+    assert(!overflowQueue.eventsReady());
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief A group of workers runs events in parallel while keeping the events of each affinity key in order.
+ */
+static int workerGroupTest() {
+    assert(ErrorType::Success == workerGroupQueue.startWorkers(eventWorkers, 16384));
+    assert(ErrorType::InvalidParameter == workerGroupQueue.startWorkers(eventWorkers, 16384));
+
+    Id threadId;
+    assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, {"workerProducer"}, nullptr, 16384, testWorkerGroupProducerStartFunction, threadId));
+    assert(ErrorType::Success == OperatingSystem::Instance().joinThread({"workerProducer"}));
+    assert(!workerGroupQueue.eventsReady());
+
+    //Nothing runs the events once the workers have stopped so they are run right away again.
+    assert(ErrorType::Success == workerGroupQueue.stopWorkers());
+    assert(ErrorType::Success == workerGroupQueue.stopWorkers());
+    EventQueue::Event event([]() -> ErrorType { return ErrorType::NoData; });
+    assert(ErrorType::NoData == workerGroupQueue.addEvent(event));
+
+    return EXIT_SUCCESS;
+}
+
+#ifdef __linux__
+/**
+ * @brief One thread waits on its events and on a file descriptor at the same time.
+ */
+static int descriptorTest() {
+    assert(0 == pipe2(descriptorPipe.data(), O_NONBLOCK | O_CLOEXEC));
+
+    Id threadId;
+    assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, {"descRunner"}, nullptr, 16384, testDescriptorRunnerStartFunction, threadId));
+    waitUntil([&]() { return descriptorRunnerReady.load(); });
+    assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, {"descWriter"}, nullptr, 16384, testDescriptorWriterStartFunction, threadId));
+
+    assert(ErrorType::Success == OperatingSystem::Instance().joinThread({"descWriter"}));
+    assert(ErrorType::Success == OperatingSystem::Instance().joinThread({"descRunner"}));
+    assert(!descriptorQueue.eventsReady());
+
+    close(descriptorPipe[0]);
+    close(descriptorPipe[1]);
+
+    return EXIT_SUCCESS;
+}
+#endif
+
+static int runAllTests() {
+    std::vector<std::function<int(void)>> tests = {
+        singleProducerTest,
+        manyProducersTest,
+        moveOnlyCaptureTest,
+        drainBudgetTest,
+#if APP_EVENT_PRIORITY_LANES == 3
+        priorityTest,
+#endif
+        timedEventTest,
+        futureTest,
+        coroutineTest,
+        overflowTest,
+        workerGroupTest,
+#ifdef __linux__
+        descriptorTest,
+#endif
+    };
+
+    for (auto test : tests) {
+        if (EXIT_SUCCESS != test()) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int main() {
+
+    OperatingSystem::Init();
+    Logger::Init();
+
+    int result = runAllTests();
+
+    return result;
+}
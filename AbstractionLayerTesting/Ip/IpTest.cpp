@@ -24,8 +24,7 @@ struct ServerNetwork {
 static void *startNetworkThread(void *arg) {
     Wifi *wifi = reinterpret_cast<Wifi *>(arg);
     while (true) {
-        OperatingSystem::Instance().delay(1);
-        wifi->mainLoop();
+        wifi->mainLoop(EventQueue::LoopMode::Drain);
     }
     return nullptr;
 }
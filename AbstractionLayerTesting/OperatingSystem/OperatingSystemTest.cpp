@@ -1,12 +1,54 @@
 //C++
 #include <vector>
 #include <functional>
+#include <chrono>
+#include <atomic>
+#include <cstring>
+#include <algorithm>
 //Modules
 #include "Log.hpp"
 #include "OperatingSystemModule.hpp"
+#include "SeqLock.hpp"
 
 static const char TAG[] = "operatingSystem";
 bool threadWasCreated = false;
+static constexpr std::array<char, OperatingSystemTypes::MaxQueueNameLength> benchmarkQueueName = {"benchmarkQueue"};
+static constexpr std::array<char, OperatingSystemTypes::MaxQueueNameLength> benchmarkReplyQueueName = {"benchmarkReply"};
+static constexpr Count queueBenchmarkMessages = 100000;
+static constexpr Count semaphoreBenchmarkIterations = 100000;
+static Id pingSemaphore = OperatingSystemTypes::NullId;
+static Id pongSemaphore = OperatingSystemTypes::NullId;
+static std::atomic<Id> blockedThreadId = OperatingSystemTypes::NullId;
+static std::atomic<Id> blockedUntilThreadId = OperatingSystemTypes::NullId;
+static constexpr Bytes threadStatsStackUsage = 64 * 1024;
+static std::atomic<bool> threadStatsReady = false;
+static constexpr Count jitterBenchmarkIterations = 5000;
+static constexpr Microseconds jitterBenchmarkInterval = 200;
+static std::array<Microseconds, jitterBenchmarkIterations> wakeUpLatencies;
+static constexpr Count wakeBenchmarkRoundTrips = 10000;
+static Microseconds wakeBenchmarkSpinBudget = 0;
+static std::atomic<Id> wakePingThreadId = OperatingSystemTypes::NullId;
+static std::atomic<Id> wakePongThreadId = OperatingSystemTypes::NullId;
+static std::atomic<Count> wakePings = 0;
+static std::atomic<Count> wakePongs = 0;
+static constexpr Count criticalSectionThreads = 4;
+static constexpr Count criticalSectionIterations = 100000;
+static Count criticalSectionCounter = 0;
+static constexpr Count mutexThreads = 4;
+static constexpr Count mutexIterations = 10000;
+static Id testMutex = OperatingSystemTypes::NullId;
+static Count mutexCounter = 0;
+static Id testReadWriteLock = OperatingSystemTypes::NullId;
+static std::atomic<ErrorType> timedReadResult = ErrorType::Failure;
+static constexpr Count seqLockWrites = 100000;
+/// @brief Every member is derived from sequence so readers can tell if they saw a torn write.
+struct SeqLockTestValue {
+    uint64_t sequence;
+    uint64_t doubled;
+    uint64_t inverted;
+};
+static SeqLock<SeqLockTestValue> seqLockValue;
+static std::atomic<bool> seqLockWriterDone = false;
 
 #ifdef __cplusplus
 extern "C" {
@@ -19,13 +61,189 @@ static void *testThreadStartFunction(void *arg) {
 }
 
 static void *testSemaphoreStartFunction(void *arg) {
-    std::string *semaphoreName = reinterpret_cast<std::string *>(arg);
+    const Id semaphore = *reinterpret_cast<Id *>(arg);
 
-    OperatingSystem::Instance().incrementSemaphore(*semaphoreName);
+    OperatingSystem::Instance().incrementSemaphore(semaphore);
 
     return nullptr;
 }
 
+static void *testQueueProducerStartFunction(void *arg) {
+    for (Count i = 0; i < queueBenchmarkMessages; i++) {
+        assert(ErrorType::Success == OperatingSystem::Instance().sendToQueue(benchmarkQueueName, &i, 1000, false, false));
+    }
+
+    return nullptr;
+}
+
+static void *testQueueEchoStartFunction(void *arg) {
+    const Count roundTrips = *reinterpret_cast<Count *>(arg);
+    Count message;
+
+    for (Count i = 0; i < roundTrips; i++) {
+        assert(ErrorType::Success == OperatingSystem::Instance().receiveFromQueue(benchmarkQueueName, &message, 1000, false));
+        assert(ErrorType::Success == OperatingSystem::Instance().sendToQueue(benchmarkReplyQueueName, &message, 1000, false, false));
+    }
+
+    return nullptr;
+}
+
+static void *testSemaphorePongStartFunction(void *arg) {
+    for (Count i = 0; i < semaphoreBenchmarkIterations; i++) {
+        assert(ErrorType::Success == OperatingSystem::Instance().waitSemaphore(pingSemaphore, 1000));
+        assert(ErrorType::Success == OperatingSystem::Instance().incrementSemaphore(pongSemaphore));
+    }
+
+    return nullptr;
+}
+
+static void *testBlockStartFunction(void *arg) {
+    Id self;
+    assert(ErrorType::Success == OperatingSystem::Instance().currentThreadId(self));
+    blockedThreadId = self;
+    //We may have been unblocked before we got here.
+    const ErrorType error = OperatingSystem::Instance().block();
+    assert(ErrorType::Success == error || ErrorType::LimitReached == error);
+
+    return nullptr;
+}
+
+static void *testBlockUntilStartFunction(void *arg) {
+    Id self;
+    Nanoseconds now;
+    Nanoseconds deadline;
+    OperatingSystem::Instance().currentThreadId(self);
+
+    OperatingSystem::Instance().monotonicTime(deadline);
+    deadline += 5000000;
+    assert(ErrorType::Timeout == OperatingSystem::Instance().blockUntil(deadline));
+    OperatingSystem::Instance().monotonicTime(now);
+    assert(now >= deadline);
+    //A time that has already passed doesn't block.
+    assert(ErrorType::Timeout == OperatingSystem::Instance().blockUntil(deadline));
+
+    //An unblock that comes first is kept for the next call.
+    assert(ErrorType::Success == OperatingSystem::Instance().unblock(self));
+    assert(ErrorType::LimitReached == OperatingSystem::Instance().blockUntil(now + 1000000000));
+
+    OperatingSystem::Instance().monotonicTime(deadline);
+    deadline += 10000000000;
+    blockedUntilThreadId = self;
+    const ErrorType error = OperatingSystem::Instance().blockUntil(deadline);
+    assert(ErrorType::Success == error || ErrorType::LimitReached == error);
+    OperatingSystem::Instance().monotonicTime(now);
+    assert(now < deadline);
+
+    return nullptr;
+}
+
+static void *testThreadStatsStartFunction(void *arg) {
+    //Use a known amount of stack and CPU time.
+    volatile uint8_t stackUsage[threadStatsStackUsage];
+    for (Bytes i = 0; i < sizeof(stackUsage); i++) {
+        stackUsage[i] = 0;
+    }
+    const auto busyUntil = std::chrono::steady_clock::now() + std::chrono::milliseconds(20);
+    while (std::chrono::steady_clock::now() < busyUntil);
+
+    threadStatsReady = true;
+    OperatingSystem::Instance().block();
+
+    return nullptr;
+}
+
+//Sleeps until an absolute time over and over and records how late it woke up each time like cyclictest does.
+static void *testJitterStartFunction(void *arg) {
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    for (Count i = 0; i < jitterBenchmarkIterations; i++) {
+        next.tv_nsec += jitterBenchmarkInterval * 1000;
+        if (next.tv_nsec >= 1000000000) {
+            next.tv_sec++;
+            next.tv_nsec -= 1000000000;
+        }
+
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr);
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        wakeUpLatencies[i] = ((now.tv_sec - next.tv_sec) * 1000000000 + (now.tv_nsec - next.tv_nsec)) / 1000;
+    }
+
+    return nullptr;
+}
+
+static void *testCriticalSectionStartFunction(void *arg) {
+    for (Count i = 0; i < criticalSectionIterations; i++) {
+        OperatingSystem::Instance().disableAllInterrupts();
+        criticalSectionCounter++;
+        OperatingSystem::Instance().enableAllInterrupts();
+    }
+
+    return nullptr;
+}
+
+static void *testMutexStartFunction(void *arg) {
+    for (Count i = 0; i < mutexIterations; i++) {
+        assert(ErrorType::Success == OperatingSystem::Instance().lockMutex(testMutex, 1000));
+        mutexCounter++;
+        assert(ErrorType::Success == OperatingSystem::Instance().unlockMutex(testMutex));
+    }
+
+    return nullptr;
+}
+
+static void *testTimedReadStartFunction(void *arg) {
+    timedReadResult = OperatingSystem::Instance().lockRead(testReadWriteLock, 5);
+    return nullptr;
+}
+
+static void *testSeqLockWriterStartFunction(void *arg) {
+    for (uint64_t i = 1; i <= seqLockWrites; i++) {
+        seqLockValue.write({i, i * 2, ~i});
+    }
+    seqLockWriterDone = true;
+
+    return nullptr;
+}
+
+#if defined(__linux__)
+static void *testWakePingStartFunction(void *arg) {
+    Id self;
+    OperatingSystem::Instance().currentThreadId(self);
+    OperatingSystem::Instance().setSpinBudget(self, wakeBenchmarkSpinBudget);
+    wakePingThreadId = self;
+
+    for (Count i = 1; i <= wakeBenchmarkRoundTrips; i++) {
+        wakePings = i;
+        OperatingSystem::Instance().unblock(wakePongThreadId);
+
+        while (wakePongs < i) {
+            OperatingSystem::Instance().block();
+        }
+    }
+
+    return nullptr;
+}
+
+static void *testWakePongStartFunction(void *arg) {
+    Id self;
+    OperatingSystem::Instance().currentThreadId(self);
+    OperatingSystem::Instance().setSpinBudget(self, wakeBenchmarkSpinBudget);
+
+    for (Count i = 1; i <= wakeBenchmarkRoundTrips; i++) {
+        while (wakePings < i) {
+            OperatingSystem::Instance().block();
+        }
+
+        wakePongs = i;
+        OperatingSystem::Instance().unblock(wakePingThreadId);
+    }
+
+    return nullptr;
+}
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -36,15 +254,15 @@ static void *testSemaphoreStartFunction(void *arg) {
 //The start function is not called until after the createThread returns. On Linux and MAC, it's called before
 //so in this test you could comment out threadJoin and this test would still pass.
 static int createThreadTest() {
-    OperatingSystemConfig::Priority priority = OperatingSystemConfig::Priority::Normal;
-    std::string name("testThread");
+    OperatingSystemTypes::Priority priority = OperatingSystemTypes::Priority::Normal;
+    std::array<char, OperatingSystemTypes::MaxThreadNameLength> name = {"testThread"};
     Bytes stackSize = 4096;
     Id threadId;
     ErrorType error;
 
     error = OperatingSystem::Instance().createThread(priority, name, nullptr, stackSize, testThreadStartFunction, threadId);
     assert(ErrorType::Success == error);
-    assert(ErrorType::Success == OperatingSystem::Instance().isDeleted(name));
+    assert(ErrorType::Negative == OperatingSystem::Instance().isDeleted(name));
 
     OperatingSystem::Instance().delay(Milliseconds(1000));
 
@@ -52,7 +270,7 @@ static int createThreadTest() {
 
     OperatingSystem::Instance().deleteThread(name);
 
-    assert(ErrorType::NoData == OperatingSystem::Instance().isDeleted(name));
+    assert(ErrorType::Success == OperatingSystem::Instance().isDeleted(name));
 
     return EXIT_SUCCESS;
 }
@@ -62,27 +280,600 @@ static int semaphoreTest() {
 
     Count max = 1;
     Count initial = 0;
-    std::string semaphoreName("testSemaphore");
-    error = OperatingSystem::Instance().createSemaphore(max, initial, semaphoreName);
+    Id semaphore;
+    error = OperatingSystem::Instance().createSemaphore(max, initial, {"testSemaphore"}, semaphore);
     assert(ErrorType::Success == error);
     
-    OperatingSystemConfig::Priority priority = OperatingSystemConfig::Priority::Normal;
-    std::string threadName("testThread");
+    OperatingSystemTypes::Priority priority = OperatingSystemTypes::Priority::Normal;
+    std::array<char, OperatingSystemTypes::MaxThreadNameLength> threadName = {"semaphoreThread"};
     Bytes stackSize = 4096;
     Id threadId;
-    error = OperatingSystem::Instance().createThread(priority, threadName, &semaphoreName, stackSize, testSemaphoreStartFunction, threadId);
+    error = OperatingSystem::Instance().createThread(priority, threadName, &semaphore, stackSize, testSemaphoreStartFunction, threadId);
+    assert(ErrorType::Success == error);
+
+    error = OperatingSystem::Instance().waitSemaphore(semaphore, 1000);
     assert(ErrorType::Success == error);
+    assert(ErrorType::Success == OperatingSystem::Instance().joinThread(threadName));
+    assert(ErrorType::Success == OperatingSystem::Instance().deleteSemaphore(semaphore));
+
+    return EXIT_SUCCESS;
+}
+
+//Checks that the queue behaves the same way a FreeRTOS queue does.
+static int queueTest() {
+    constexpr std::array<char, OperatingSystemTypes::MaxQueueNameLength> queueName = {"testQueue"};
+    constexpr Count queueLength = 3;
+    uint32_t item = 0;
+
+    assert(ErrorType::Success == OperatingSystem::Instance().createQueue(queueName, sizeof(item), queueLength));
+    assert(ErrorType::Failure == OperatingSystem::Instance().createQueue(queueName, sizeof(item), queueLength));
+
+    //Empty queues time out instead of blocking forever.
+    assert(ErrorType::Timeout == OperatingSystem::Instance().receiveFromQueue(queueName, &item, 0, false));
+    const auto startTime = std::chrono::steady_clock::now();
+    assert(ErrorType::Timeout == OperatingSystem::Instance().peekFromQueue(queueName, &item, 20, false));
+    assert(std::chrono::steady_clock::now() - startTime >= std::chrono::milliseconds(20));
+
+    item = 1;
+    assert(ErrorType::Success == OperatingSystem::Instance().sendToQueue(queueName, &item, 0, false, false));
+    item = 2;
+    assert(ErrorType::Success == OperatingSystem::Instance().sendToQueue(queueName, &item, 0, false, false));
+    item = 0;
+    assert(ErrorType::Success == OperatingSystem::Instance().sendToQueue(queueName, &item, 0, true, false));
+    //Full queues time out too.
+    assert(ErrorType::Timeout == OperatingSystem::Instance().sendToQueue(queueName, &item, 0, false, true));
+
+    //Peeking does not remove the item.
+    uint32_t peeked = UINT32_MAX;
+    assert(ErrorType::Success == OperatingSystem::Instance().peekFromQueue(queueName, &peeked, 0, false));
+    assert(0 == peeked);
+
+    for (uint32_t expected = 0; expected < queueLength; expected++) {
+        assert(ErrorType::Success == OperatingSystem::Instance().receiveFromQueue(queueName, &item, 0, false));
+        assert(expected == item);
+    }
+
+    assert(ErrorType::NoData == OperatingSystem::Instance().receiveFromQueue({"doesNotExist"}, &item, 0, false));
+
+    return EXIT_SUCCESS;
+}
+
+//Measures the throughput of one producer and one consumer as well as the round trip latency of a message sent to another thread and back.
+static int queueBenchmark() {
+    assert(ErrorType::Success == OperatingSystem::Instance().createQueue(benchmarkQueueName, sizeof(Count), 64));
+    assert(ErrorType::Success == OperatingSystem::Instance().createQueue(benchmarkReplyQueueName, sizeof(Count), 1));
+
+    Bytes stackSize = 4096;
+    Id threadId;
+    Count message;
+
+    auto startTime = std::chrono::steady_clock::now();
+    assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, {"queueProducer"}, nullptr, stackSize, testQueueProducerStartFunction, threadId));
+    for (Count i = 0; i < queueBenchmarkMessages; i++) {
+        assert(ErrorType::Success == OperatingSystem::Instance().receiveFromQueue(benchmarkQueueName, &message, 1000, false));
+        assert(i == message);
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    PLT_LOGI(TAG, "Queue throughput: %.0f messages/s", queueBenchmarkMessages / elapsed);
+    OperatingSystem::Instance().joinThread({"queueProducer"});
+
+    Count roundTrips = queueBenchmarkMessages / 10;
+    assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, {"queueEcho"}, &roundTrips, stackSize, testQueueEchoStartFunction, threadId));
+    startTime = std::chrono::steady_clock::now();
+    for (Count i = 0; i < roundTrips; i++) {
+        assert(ErrorType::Success == OperatingSystem::Instance().sendToQueue(benchmarkQueueName, &i, 1000, false, false));
+        assert(ErrorType::Success == OperatingSystem::Instance().receiveFromQueue(benchmarkReplyQueueName, &message, 1000, false));
+    }
+    elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTime).count();
+    PLT_LOGI(TAG, "Queue round trip latency: %.2f us", elapsed / roundTrips);
+    OperatingSystem::Instance().joinThread({"queueEcho"});
+
+    return EXIT_SUCCESS;
+}
+
+static int timerTest() {
+    std::atomic<Count> expirations = 0;
+    Id periodicTimer;
+    Id oneShotTimer;
+
+    //A periodic timer with no period would never stop expiring.
+    assert(ErrorType::InvalidParameter == OperatingSystem::Instance().createTimer(periodicTimer, 0, true, []() {}));
+
+    //Sub-second periods are supported.
+    assert(ErrorType::Success == OperatingSystem::Instance().createTimer(periodicTimer, 5, true, [&expirations]() { expirations++; }));
+    assert(ErrorType::Success == OperatingSystem::Instance().startTimer(periodicTimer, 0));
+    OperatingSystem::Instance().delay(Milliseconds(100));
+    assert(ErrorType::Success == OperatingSystem::Instance().stopTimer(periodicTimer, 0));
+    const Count expirationsWhenStopped = expirations;
+    assert(expirationsWhenStopped >= 10 && expirationsWhenStopped <= 21);
+    OperatingSystem::Instance().delay(Milliseconds(20));
+    assert(expirationsWhenStopped == expirations);
+    assert(ErrorType::Success == OperatingSystem::Instance().deleteTimer(periodicTimer));
+    assert(ErrorType::NoData == OperatingSystem::Instance().startTimer(periodicTimer, 0));
+
+    //One shot timers are deleted after they expire.
+    std::atomic<Microseconds> lateness = 0;
+    std::chrono::steady_clock::time_point startTime;
+    constexpr Milliseconds oneShotPeriod = 2;
+    assert(ErrorType::Success == OperatingSystem::Instance().createTimer(oneShotTimer, oneShotPeriod, false, [&]() {
+        lateness = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count() - oneShotPeriod * 1000;
+    }));
+    startTime = std::chrono::steady_clock::now();
+    assert(ErrorType::Success == OperatingSystem::Instance().startTimer(oneShotTimer, 0));
+    OperatingSystem::Instance().delay(Milliseconds(20));
+    assert(ErrorType::NoData == OperatingSystem::Instance().deleteTimer(oneShotTimer));
+    PLT_LOGI(TAG, "One shot timer expired %llu us late", lateness.load());
+
+    return EXIT_SUCCESS;
+}
+
+static int semaphoreHandleTest() {
+    Id semaphore;
+
+    assert(ErrorType::InvalidParameter == OperatingSystem::Instance().createSemaphore(1, 2, {"testHandle"}, semaphore));
+    assert(ErrorType::Success == OperatingSystem::Instance().createSemaphore(2, 1, {"testHandle"}, semaphore));
+    assert(OperatingSystemTypes::NullId != semaphore);
+
+    //The name and the handle refer to the same semaphore.
+    assert(ErrorType::Success == OperatingSystem::Instance().decrementSemaphore({"testHandle"}));
+    assert(ErrorType::Timeout == OperatingSystem::Instance().decrementSemaphore(semaphore));
+    assert(ErrorType::Success == OperatingSystem::Instance().incrementSemaphore(semaphore));
+    assert(ErrorType::Success == OperatingSystem::Instance().incrementSemaphore({"testHandle"}));
+    assert(ErrorType::LimitReached == OperatingSystem::Instance().incrementSemaphore(semaphore));
+    assert(ErrorType::Success == OperatingSystem::Instance().waitSemaphore(semaphore, 0));
+    assert(ErrorType::Success == OperatingSystem::Instance().waitSemaphore(semaphore, 0));
+    assert(ErrorType::Timeout == OperatingSystem::Instance().waitSemaphore(semaphore, 0));
+
+    //Timed waits are not quantized to the millisecond.
+    const auto startTime = std::chrono::steady_clock::now();
+    assert(ErrorType::Timeout == OperatingSystem::Instance().waitSemaphore(semaphore, 5));
+    const auto waited = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+    assert(waited >= 5000);
+    PLT_LOGI(TAG, "Semaphore 5ms timeout took %ld us", static_cast<long>(waited));
+
+    assert(ErrorType::Success == OperatingSystem::Instance().deleteSemaphore(semaphore));
+    assert(ErrorType::NoData == OperatingSystem::Instance().waitSemaphore(semaphore, 0));
+    assert(ErrorType::NoData == OperatingSystem::Instance().waitSemaphore({"testHandle"}, 0));
+
+    return EXIT_SUCCESS;
+}
+
+//Measures the latency of posting and waiting on a semaphore nobody else is using and of waking another thread with one.
+static int semaphoreBenchmark() {
+    assert(ErrorType::Success == OperatingSystem::Instance().createSemaphore(1, 0, {"ping"}, pingSemaphore));
+    assert(ErrorType::Success == OperatingSystem::Instance().createSemaphore(1, 0, {"pong"}, pongSemaphore));
+
+    auto startTime = std::chrono::steady_clock::now();
+    for (Count i = 0; i < semaphoreBenchmarkIterations; i++) {
+        assert(ErrorType::Success == OperatingSystem::Instance().incrementSemaphore(pingSemaphore));
+        assert(ErrorType::Success == OperatingSystem::Instance().waitSemaphore(pingSemaphore, 0));
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count();
+    PLT_LOGI(TAG, "Uncontended semaphore post and wait: %.1f ns", elapsed / semaphoreBenchmarkIterations);
+
+    startTime = std::chrono::steady_clock::now();
+    for (Count i = 0; i < semaphoreBenchmarkIterations; i++) {
+        assert(ErrorType::Success == OperatingSystem::Instance().incrementSemaphore({"ping"}));
+        assert(ErrorType::Success == OperatingSystem::Instance().waitSemaphore({"ping"}, 0));
+    }
+    elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count();
+    PLT_LOGI(TAG, "Uncontended semaphore post and wait by name: %.1f ns", elapsed / semaphoreBenchmarkIterations);
+
+    Id threadId;
+    assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, {"semaphorePong"}, nullptr, 4096, testSemaphorePongStartFunction, threadId));
+    startTime = std::chrono::steady_clock::now();
+    for (Count i = 0; i < semaphoreBenchmarkIterations; i++) {
+        assert(ErrorType::Success == OperatingSystem::Instance().incrementSemaphore(pingSemaphore));
+        assert(ErrorType::Success == OperatingSystem::Instance().waitSemaphore(pongSemaphore, 1000));
+    }
+    elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTime).count();
+    PLT_LOGI(TAG, "Contended semaphore round trip: %.2f us", elapsed / semaphoreBenchmarkIterations);
+    OperatingSystem::Instance().joinThread({"semaphorePong"});
+
+    OperatingSystem::Instance().deleteSemaphore(pingSemaphore);
+    OperatingSystem::Instance().deleteSemaphore(pongSemaphore);
+
+    return EXIT_SUCCESS;
+}
+
+static int blockTest() {
+    Id self;
+    //Threads that weren't created by the operating system don't have an Id.
+    assert(ErrorType::NoData == OperatingSystem::Instance().currentThreadId(self));
+    assert(OperatingSystemTypes::NullId == self);
+    assert(ErrorType::NoData == OperatingSystem::Instance().block());
+
+    Id threadId;
+    assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, {"blockTest"}, nullptr, 4096, testBlockStartFunction, threadId));
+    while (OperatingSystemTypes::NullId == blockedThreadId);
+    assert(threadId == blockedThreadId);
+    assert(ErrorType::Success == OperatingSystem::Instance().unblock(threadId));
+    assert(ErrorType::Success == OperatingSystem::Instance().joinThread({"blockTest"}));
+    assert(ErrorType::NoData == OperatingSystem::Instance().unblock(threadId + 1));
+
+    return EXIT_SUCCESS;
+}
+
+static int blockUntilTest() {
+    assert(ErrorType::NoData == OperatingSystem::Instance().blockUntil(0));
+
+    Id threadId;
+    assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, {"blockUntil"}, nullptr, 4096, testBlockUntilStartFunction, threadId));
+    while (OperatingSystemTypes::NullId == blockedUntilThreadId);
+    assert(ErrorType::Success == OperatingSystem::Instance().unblock(threadId));
+    assert(ErrorType::Success == OperatingSystem::Instance().joinThread({"blockUntil"}));
+
+    return EXIT_SUCCESS;
+}
+
+static int criticalSectionTest() {
+    //Only the thread in the critical section can leave it.
+    assert(ErrorType::PrerequisitesNotMet == OperatingSystem::Instance().enableAllInterrupts());
+
+    //Nested critical sections from the same thread don't deadlock.
+    assert(ErrorType::Success == OperatingSystem::Instance().disableAllInterrupts());
+    assert(ErrorType::Success == OperatingSystem::Instance().disableAllInterrupts());
+    assert(ErrorType::Success == OperatingSystem::Instance().enableAllInterrupts());
+    assert(ErrorType::Success == OperatingSystem::Instance().enableAllInterrupts());
+    assert(ErrorType::PrerequisitesNotMet == OperatingSystem::Instance().enableAllInterrupts());
+
+    constexpr Count uncontendedIterations = 1000000;
+    auto startTime = std::chrono::steady_clock::now();
+    for (Count i = 0; i < uncontendedIterations; i++) {
+        OperatingSystem::Instance().disableAllInterrupts();
+        OperatingSystem::Instance().enableAllInterrupts();
+    }
+    double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count();
+    PLT_LOGI(TAG, "Uncontended critical section: %.1f ns", elapsed / uncontendedIterations);
+
+    std::array<std::array<char, OperatingSystemTypes::MaxThreadNameLength>, criticalSectionThreads> names = {{{"critical0"}, {"critical1"}, {"critical2"}, {"critical3"}}};
+    Id threadId;
+    startTime = std::chrono::steady_clock::now();
+    for (const auto &name : names) {
+        assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, name, nullptr, 16384, testCriticalSectionStartFunction, threadId));
+    }
+    for (const auto &name : names) {
+        assert(ErrorType::Success == OperatingSystem::Instance().joinThread(name));
+    }
+    elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - startTime).count();
+    assert(criticalSectionThreads * criticalSectionIterations == criticalSectionCounter);
+    PLT_LOGI(TAG, "Contended critical section (%u threads): %.1f ns", criticalSectionThreads, elapsed / (criticalSectionThreads * criticalSectionIterations));
+
+#if defined(__linux__)
+    std::vector<OperatingSystem::CriticalSectionStatistics> statistics;
+    assert(ErrorType::Success == OperatingSystem::Instance().criticalSectionStatistics(statistics));
+    assert(!statistics.empty());
+    for (const auto &callSite : statistics) {
+        PLT_LOGI(TAG, "Critical section call site %p: entries:%u, contentions:%u, waiting:%llu us",
+        callSite.callSite, callSite.entries, callSite.contentions, static_cast<unsigned long long>(callSite.timeWaiting));
+    }
+#endif
+
+    return EXIT_SUCCESS;
+}
+
+static int mutexTest() {
+    assert(ErrorType::Success == OperatingSystem::Instance().createMutex(testMutex, true));
+    assert(OperatingSystemTypes::NullId != testMutex);
+
+    assert(ErrorType::Success == OperatingSystem::Instance().lockMutex(testMutex, 0));
+    //Mutexes are not recursive.
+    assert(ErrorType::PrerequisitesNotMet == OperatingSystem::Instance().lockMutex(testMutex, 0));
+    assert(ErrorType::Success == OperatingSystem::Instance().unlockMutex(testMutex));
+
+    std::array<std::array<char, OperatingSystemTypes::MaxThreadNameLength>, mutexThreads> names = {{{"mutex0"}, {"mutex1"}, {"mutex2"}, {"mutex3"}}};
+    Id threadId;
+    for (const auto &name : names) {
+        assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, name, nullptr, 16384, testMutexStartFunction, threadId));
+    }
+    for (const auto &name : names) {
+        assert(ErrorType::Success == OperatingSystem::Instance().joinThread(name));
+    }
+    assert(mutexThreads * mutexIterations == mutexCounter);
+
+    //A locked mutex can not be deleted.
+    assert(ErrorType::Success == OperatingSystem::Instance().lockMutex(testMutex, 0));
+    assert(ErrorType::PrerequisitesNotMet == OperatingSystem::Instance().deleteMutex(testMutex));
+    assert(ErrorType::Success == OperatingSystem::Instance().unlockMutex(testMutex));
+
+    assert(ErrorType::Success == OperatingSystem::Instance().deleteMutex(testMutex));
+    assert(ErrorType::NoData == OperatingSystem::Instance().lockMutex(testMutex, 0));
+    assert(ErrorType::NoData == OperatingSystem::Instance().deleteMutex(testMutex));
+
+    return EXIT_SUCCESS;
+}
+
+static int readWriteLockTest() {
+    Id &lock = testReadWriteLock;
+    assert(ErrorType::Success == OperatingSystem::Instance().createReadWriteLock(lock));
+
+    //Readers share the lock but keep writers out.
+    assert(ErrorType::Success == OperatingSystem::Instance().lockRead(lock, 0));
+    assert(ErrorType::Success == OperatingSystem::Instance().lockRead(lock, 0));
+    assert(ErrorType::Timeout == OperatingSystem::Instance().lockWrite(lock, 0));
+    assert(ErrorType::Success == OperatingSystem::Instance().unlockReadWriteLock(lock));
+    assert(ErrorType::Success == OperatingSystem::Instance().unlockReadWriteLock(lock));
+
+    //A writer keeps everyone else out.
+    assert(ErrorType::Success == OperatingSystem::Instance().lockWrite(lock, 0));
+    assert(ErrorType::Timeout == OperatingSystem::Instance().lockRead(lock, 0));
+    Id threadId;
+    const auto startTime = std::chrono::steady_clock::now();
+    assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, {"timedRead"}, nullptr, 16384, testTimedReadStartFunction, threadId));
+    assert(ErrorType::Success == OperatingSystem::Instance().joinThread({"timedRead"}));
+    assert(ErrorType::Timeout == timedReadResult);
+    assert(std::chrono::steady_clock::now() - startTime >= std::chrono::milliseconds(5));
+    assert(ErrorType::Success == OperatingSystem::Instance().unlockReadWriteLock(lock));
+
+    assert(ErrorType::Success == OperatingSystem::Instance().deleteReadWriteLock(lock));
+    assert(ErrorType::NoData == OperatingSystem::Instance().lockRead(lock, 0));
+
+    return EXIT_SUCCESS;
+}
+
+static int seqLockTest() {
+    Id threadId;
+    assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, {"seqLockWriter"}, nullptr, 16384, testSeqLockWriterStartFunction, threadId));
 
-    error = OperatingSystem::Instance().waitSemaphore(semaphoreName, 1000);
+    Count reads = 0;
+    uint64_t lastSequence = 0;
+    bool writerDone;
+    do {
+        writerDone = seqLockWriterDone;
+        const SeqLockTestValue value = seqLockValue.read();
+        assert(0 == value.sequence || (value.doubled == value.sequence * 2 && value.inverted == ~value.sequence));
+        assert(value.sequence >= lastSequence);
+        lastSequence = value.sequence;
+        reads++;
+    } while (!writerDone);
+    assert(ErrorType::Success == OperatingSystem::Instance().joinThread({"seqLockWriter"}));
+    assert(seqLockWrites == seqLockValue.read().sequence);
+    PLT_LOGI(TAG, "Seqlock reader took %u consistent snapshots during %u writes", reads, seqLockWrites);
+
+    return EXIT_SUCCESS;
+}
+
+static int periodicTaskTest() {
+    constexpr Microseconds period = 1000;
+    constexpr Count periods = 200;
+    constexpr Microseconds work = 300;
+    Id task;
+
+    assert(ErrorType::InvalidParameter == OperatingSystem::Instance().createPeriodicTask(task, 0, 0));
+    assert(ErrorType::InvalidParameter == OperatingSystem::Instance().createPeriodicTask(task, period, period));
+
+    for (const Microseconds spin : {Microseconds(0), Microseconds(50)}) {
+        assert(ErrorType::Success == OperatingSystem::Instance().createPeriodicTask(task, period, spin));
+
+        //The time spent working each period doesn't add up.
+        const auto startTime = std::chrono::steady_clock::now();
+        for (Count i = 0; i < periods; i++) {
+            const auto workDone = std::chrono::steady_clock::now() + std::chrono::microseconds(work);
+            while (std::chrono::steady_clock::now() < workDone);
+            OperatingSystem::Instance().waitUntilNextPeriod(task);
+        }
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+        assert(elapsed >= static_cast<long>(periods * period));
+
+        OperatingSystemTypes::PeriodicTaskStatistics statistics;
+        assert(ErrorType::Success == OperatingSystem::Instance().periodicTaskStatistics(task, statistics));
+        assert(periods == statistics.periods);
+        PLT_LOGI(TAG, "%u periods of %llu us with %llu us spin took %ld us. Missed deadlines:%u, max jitter:%llu us, average jitter:%llu us",
+        periods, static_cast<unsigned long long>(period), static_cast<unsigned long long>(spin), static_cast<long>(elapsed),
+        statistics.missedDeadlines, static_cast<unsigned long long>(statistics.maxJitter), static_cast<unsigned long long>(statistics.averageJitter));
+
+        assert(ErrorType::Success == OperatingSystem::Instance().deletePeriodicTask(task));
+    }
+
+    //Overrunning a period skips ahead instead of trying to catch up.
+    assert(ErrorType::Success == OperatingSystem::Instance().createPeriodicTask(task, period, 0));
+    OperatingSystem::Instance().delay(Microseconds(3 * period + period / 2));
+    assert(ErrorType::Timeout == OperatingSystem::Instance().waitUntilNextPeriod(task));
+    OperatingSystemTypes::PeriodicTaskStatistics statistics;
+    assert(ErrorType::Success == OperatingSystem::Instance().periodicTaskStatistics(task, statistics));
+    assert(statistics.missedDeadlines >= 3);
+    assert(1 == statistics.periods);
+
+    assert(ErrorType::Success == OperatingSystem::Instance().deletePeriodicTask(task));
+    assert(ErrorType::NoData == OperatingSystem::Instance().waitUntilNextPeriod(task));
+    assert(ErrorType::NoData == OperatingSystem::Instance().periodicTaskStatistics(task, statistics));
+
+    return EXIT_SUCCESS;
+}
+
+static int timeTest() {
+    constexpr Count clockReads = 1000000;
+    Nanoseconds before;
+    Nanoseconds after;
+    Nanoseconds now;
+
+    assert(ErrorType::Success == OperatingSystem::Instance().monotonicTime(before));
+    for (Count i = 0; i < clockReads; i++) {
+        OperatingSystem::Instance().monotonicTime(now);
+    }
+    assert(ErrorType::Success == OperatingSystem::Instance().monotonicTime(after));
+    assert(after >= now && now >= before);
+    PLT_LOGI(TAG, "Monotonic clock read: %.1f ns", static_cast<double>(after - before) / clockReads);
+
+    //Short intervals can be measured.
+    assert(ErrorType::Success == OperatingSystem::Instance().monotonicTime(before));
+    OperatingSystem::Instance().delay(Microseconds(500));
+    assert(ErrorType::Success == OperatingSystem::Instance().monotonicTime(after));
+    assert(after - before >= 500000);
+
+    //The sub-second system time agrees with the one second system time.
+    UnixTime unixTime;
+    Microseconds systemTime;
+    assert(ErrorType::Success == OperatingSystem::Instance().getSystemTime(systemTime));
+    assert(ErrorType::Success == OperatingSystem::Instance().getSystemTime(unixTime));
+    assert(unixTime - systemTime / 1000000 <= 1);
+
+    Ticks startTicks;
+    Ticks endTicks;
+    Ticks ticks;
+    Milliseconds elapsed;
+    assert(ErrorType::Success == OperatingSystem::Instance().millisecondsToTicks(20, ticks));
+    assert(ErrorType::Success == OperatingSystem::Instance().ticksToMilliseconds(ticks, elapsed));
+    assert(20 == elapsed);
+    assert(ErrorType::Success == OperatingSystem::Instance().getSystemTick(startTicks));
+    OperatingSystem::Instance().delay(Milliseconds(20));
+    assert(ErrorType::Success == OperatingSystem::Instance().getSystemTick(endTicks));
+    assert(ErrorType::Success == OperatingSystem::Instance().ticksToMilliseconds(endTicks - startTicks, elapsed));
+    assert(elapsed >= 20);
+
+    return EXIT_SUCCESS;
+}
+
+static int statusTest() {
+    OperatingSystemTypes::ProcessUsage usage;
+    assert(ErrorType::Success == OperatingSystem::Instance().processUsage(usage));
+
+    //Keep the CPU busy so that there is something to measure.
+    const auto busyUntil = std::chrono::steady_clock::now() + std::chrono::milliseconds(50);
+    while (std::chrono::steady_clock::now() < busyUntil);
+
+    std::vector<uint8_t> allocation(1024 * 1024, 1);
+    const auto startTime = std::chrono::steady_clock::now();
+    const OperatingSystemTypes::Status &status = OperatingSystem::Instance().status(true);
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+
+    assert(status.idle >= 0.0f && status.idle <= 100.0f);
+    assert(status.process.cpu > 0.0f && status.process.cpu <= 100.0f);
+    assert(status.process.residentBytes >= allocation.size());
+    assert(status.process.heapUsedBytes >= allocation.size());
+    for (const auto &memoryRegion : status.memoryRegion) {
+        assert(memoryRegion.free >= 0.0f && memoryRegion.free <= 100.0f);
+    }
+    PLT_LOGI(TAG, "Status update took %ld us", static_cast<long>(elapsed));
+    OperatingSystem::Instance().printStatus();
+
+    return EXIT_SUCCESS;
+}
+
+static int threadStatusTest() {
+    constexpr Bytes stackSize = 256 * 1024;
+    Id threadId;
+    assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, {"threadStats"}, nullptr, stackSize, testThreadStatsStartFunction, threadId));
+    while (!threadStatsReady);
+
+    const OperatingSystemTypes::Status &status = OperatingSystem::Instance().status(true);
+    auto thread = std::find_if(status.threads.begin(), status.threads.end(), [threadId](const auto &thread) { return thread.id == threadId; });
+    assert(status.threads.end() != thread);
+    assert(thread->stackSize >= stackSize);
+    assert(thread->stackHighWaterMark >= threadStatsStackUsage && thread->stackHighWaterMark < thread->stackSize);
+    assert(thread->cpuTime >= 10000);
+    assert(thread->voluntaryContextSwitches >= 1);
+    auto stackRegion = std::find_if(status.memoryRegion.begin(), status.memoryRegion.end(), [](const auto &region) { return 0 == strncmp(region.name.data(), "threadStats", OperatingSystemTypes::MaxMemoryRegionNameLength); });
+    assert(status.memoryRegion.end() != stackRegion);
+    assert(stackRegion->free > 0.0f && stackRegion->free < 75.0f);
+    OperatingSystem::Instance().printStatus();
+
+    OperatingSystem::Instance().unblock(threadId);
+    assert(ErrorType::Success == OperatingSystem::Instance().joinThread({"threadStats"}));
+    //Statistics from before the thread exited are kept.
+    OperatingSystemTypes::ThreadInfo exitedThread = *thread;
+    assert(ErrorType::Success == OperatingSystem::Instance().threadUsage(exitedThread));
+    assert(exitedThread.cpuTime == thread->cpuTime);
+
+    return EXIT_SUCCESS;
+}
+
+#if defined(__linux__)
+//Measures the wake up latency of a thread using the real-time options. Run on an isolated core to see what a control loop can expect.
+static int realTimeJitterBenchmark() {
+    OperatingSystem::RealTimeOptions options;
+    options.policy = OperatingSystem::RealTimeOptions::Policy::Fifo;
+    options.lockStack = true;
+    //Pin to the last CPU we are allowed to run on since isolated cores are usually the highest numbered ones.
+    cpu_set_t allowed;
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+    for (int cpu = CPU_SETSIZE - 1; cpu >= 0; cpu--) {
+        if (CPU_ISSET(cpu, &allowed)) {
+            CPU_SET(cpu, &options.affinity);
+            break;
+        }
+    }
+
+    const bool memoryIsLocked = (ErrorType::Success == OperatingSystem::Instance().lockMemory());
+    Id threadId;
+    ErrorType error = OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Highest, {"jitter"}, nullptr, 16384, testJitterStartFunction, threadId, options);
+    if (ErrorType::Success != error) {
+        //Real-time scheduling needs privileges so measure without it rather than fail.
+        PLT_LOGW(TAG, "Could not create a real-time thread (error %u). Measuring jitter without real-time options.", static_cast<unsigned>(error));
+        error = OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Highest, {"jitter"}, nullptr, 16384, testJitterStartFunction, threadId);
+    }
     assert(ErrorType::Success == error);
+    assert(ErrorType::Success == OperatingSystem::Instance().joinThread({"jitter"}));
+    if (memoryIsLocked) {
+        OperatingSystem::Instance().unlockMemory();
+    }
+
+    std::sort(wakeUpLatencies.begin(), wakeUpLatencies.end());
+    auto percentile = [](const double p) { return static_cast<unsigned long long>(wakeUpLatencies[static_cast<size_t>(p * (wakeUpLatencies.size() - 1))]); };
+    PLT_LOGI(TAG, "Wake up latency (us) over %u %lluus periods. Memory locked: %s. p50:%llu, p99:%llu, p99.9:%llu, max:%llu",
+    jitterBenchmarkIterations, static_cast<unsigned long long>(jitterBenchmarkInterval), memoryIsLocked ? "yes" : "no", percentile(0.5), percentile(0.99), percentile(0.999), percentile(1.0));
+
+    return EXIT_SUCCESS;
+}
+
+//Compares the time it takes to wake a thread that always sleeps in the kernel with one that spins first.
+static int wakeLatencyBenchmark() {
+    struct Mode {
+        const char *description;
+        Microseconds spinBudget;
+        std::array<char, OperatingSystemTypes::MaxThreadNameLength> pingName;
+        std::array<char, OperatingSystemTypes::MaxThreadNameLength> pongName;
+    };
+    const std::array<Mode, 2> modes = {{
+        {"park", 0, {"parkPing"}, {"parkPong"}},
+        {"adaptive", OperatingSystem::DefaultSpinBudget, {"spinPing"}, {"spinPong"}}
+    }};
+
+    for (const auto &mode : modes) {
+        Id threadId;
+        wakeBenchmarkSpinBudget = mode.spinBudget;
+        wakePings = 0;
+        wakePongs = 0;
+
+        const auto startTime = std::chrono::steady_clock::now();
+        assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, mode.pongName, nullptr, 16384, testWakePongStartFunction, threadId));
+        wakePongThreadId = threadId;
+        assert(ErrorType::Success == OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal, mode.pingName, nullptr, 16384, testWakePingStartFunction, threadId));
+        assert(ErrorType::Success == OperatingSystem::Instance().joinThread(mode.pingName));
+        assert(ErrorType::Success == OperatingSystem::Instance().joinThread(mode.pongName));
+        const double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - startTime).count();
+
+        //Each round trip is two wake ups.
+        PLT_LOGI(TAG, "Wake latency (%s, %lluus spin budget): %.2f us", mode.description, static_cast<unsigned long long>(mode.spinBudget), elapsed / (2 * wakeBenchmarkRoundTrips));
+    }
 
     return EXIT_SUCCESS;
 }
+#endif
 
 static int runAllTests() {
     std::vector<std::function<int(void)>> tests = {
         createThreadTest,
-        semaphoreTest
+        semaphoreTest,
+        queueTest,
+        queueBenchmark,
+        timerTest,
+        semaphoreHandleTest,
+        semaphoreBenchmark,
+        blockTest,
+        blockUntilTest,
+        criticalSectionTest,
+        mutexTest,
+        readWriteLockTest,
+        seqLockTest,
+        periodicTaskTest,
+        timeTest,
+        statusTest,
+        threadStatusTest,
+#if defined(__linux__)
+        realTimeJitterBenchmark,
+        wakeLatencyBenchmark,
+#endif
     };
 
     for (auto test : tests) {
@@ -103,7 +894,6 @@ int main() {
     OperatingSystem::Instance().idlePercentage(idlePercent);
 
     int result = runAllTests();
-    toPlatformError(result);
 
     return result;
 }
@@ -10,8 +10,7 @@ static const char TAG[] = "storageTest";
 
 static void *startStorageThread(void *arg) {
     while (true) {
-        OperatingSystem::Instance().delay(1000);
-        Storage::Instance().mainLoop();
+        Storage::Instance().mainLoop(EventQueue::LoopMode::Drain);
     }
     return nullptr;
 }
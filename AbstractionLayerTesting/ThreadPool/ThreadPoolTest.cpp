@@ -0,0 +1,173 @@
+//C++
+#include <vector>
+#include <functional>
+#include <chrono>
+#include <atomic>
+#include <cassert>
+//AbstractionLayer
+#include "Log.hpp"
+#include "OperatingSystemModule.hpp"
+#include "ThreadPool.hpp"
+
+static const char TAG[] = "threadPool";
+static constexpr Count submitTestTasks = 1000;
+static constexpr size_t parallelForTestSize = 1000000;
+static constexpr size_t checksumBenchmarkSize = 16 * 1024 * 1024;
+
+static int submitTest() {
+    ThreadPool pool;
+    ThreadPoolTypes::Handle handle;
+
+    assert(ErrorType::NoData == pool.submit([]() {}, handle));
+
+    assert(ErrorType::Success == pool.start(0));
+    Count cores;
+    assert(ErrorType::Success == OperatingSystem::Instance().onlineCores(cores));
+    assert(pool.workers() == cores);
+    assert(ErrorType::InvalidParameter == pool.start(0));
+
+    std::atomic<Count> tasksRun = 0;
+    std::vector<ThreadPoolTypes::Handle> handles(submitTestTasks);
+    for (auto &taskHandle : handles) {
+        assert(ErrorType::Success == pool.submit([&tasksRun]() { tasksRun++; }, taskHandle));
+    }
+
+    for (auto &taskHandle : handles) {
+        assert(ErrorType::Success == taskHandle->wait());
+        assert(taskHandle->isDone());
+    }
+    assert(submitTestTasks == tasksRun);
+
+    //Dropping the handle does not cancel the work.
+    std::atomic<bool> ran = false;
+    assert(ErrorType::Success == pool.submit([&ran]() { ran = true; }, handle));
+    handle.reset();
+    while (!ran);
+
+    PLT_LOGI(TAG, "%u workers ran %u tasks, %u stolen, %u parks", pool.status().workers, pool.status().tasksExecuted, pool.status().tasksStolen, pool.status().parks);
+
+    //Work still queued when the pool stops is run before stop returns.
+    for (auto &taskHandle : handles) {
+        assert(ErrorType::Success == pool.submit([&tasksRun]() { tasksRun++; }, taskHandle));
+    }
+    assert(ErrorType::Success == pool.stop());
+    assert(2 * submitTestTasks == tasksRun);
+    assert(ErrorType::NoData == pool.submit([]() {}, handle));
+
+    return EXIT_SUCCESS;
+}
+
+static int parallelForTest() {
+    ThreadPool pool;
+    assert(ErrorType::Success == pool.start(4));
+
+    std::vector<uint32_t> values(parallelForTestSize, 0);
+    assert(ErrorType::Success == pool.parallelFor({0, values.size()}, 1000, [&values](const ThreadPoolTypes::Range &range) {
+        for (size_t i = range.begin; i < range.end; i++) {
+            values[i] += i;
+        }
+    }));
+
+    for (size_t i = 0; i < values.size(); i++) {
+        assert(values[i] == i);
+    }
+
+    //Empty ranges and a zero grain are allowed.
+    std::atomic<Count> calls = 0;
+    assert(ErrorType::Success == pool.parallelFor({10, 10}, 1, [&calls](const ThreadPoolTypes::Range &) { calls++; }));
+    assert(0 == calls);
+    assert(ErrorType::Success == pool.parallelFor({0, 100}, 0, [&calls](const ThreadPoolTypes::Range &range) { calls += range.end - range.begin; }));
+    assert(100 == calls);
+
+    //Tasks can wait on work of their own without running out of workers.
+    std::atomic<Count> innerIterations = 0;
+    assert(ErrorType::Success == pool.parallelFor({0, 64}, 1, [&pool, &innerIterations](const ThreadPoolTypes::Range &) {
+        pool.parallelFor({0, 64}, 1, [&innerIterations](const ThreadPoolTypes::Range &) { innerIterations++; });
+    }));
+    assert(64 * 64 == innerIterations);
+
+    return EXIT_SUCCESS;
+}
+
+static int parallelReduceTest() {
+    ThreadPool pool;
+    assert(ErrorType::Success == pool.start(0));
+
+    uint64_t sum = 1;
+    assert(ErrorType::Success == pool.parallelReduce({0, parallelForTestSize}, 4096, uint64_t(0),
+        [](const ThreadPoolTypes::Range &range) {
+            uint64_t partial = 0;
+            for (size_t i = range.begin; i < range.end; i++) {
+                partial += i;
+            }
+            return partial;
+        },
+        [](const uint64_t a, const uint64_t b) { return a + b; },
+        sum));
+    assert(sum == (static_cast<uint64_t>(parallelForTestSize) * (parallelForTestSize - 1)) / 2);
+
+    assert(ErrorType::Success == pool.parallelReduce({5, 5}, 1, uint64_t(0), [](const ThreadPoolTypes::Range &) { return uint64_t(1); }, [](const uint64_t a, const uint64_t b) { return a + b; }, sum));
+    assert(0 == sum);
+
+    return EXIT_SUCCESS;
+}
+
+static int checksumBenchmark() {
+    std::vector<uint8_t> data(checksumBenchmarkSize);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = static_cast<uint8_t>(i * 31);
+    }
+
+    auto checksum = [&data](const ThreadPoolTypes::Range &range) {
+        uint32_t sum = 0;
+        for (size_t i = range.begin; i < range.end; i++) {
+            sum += data[i];
+        }
+        return sum;
+    };
+
+    auto startTime = std::chrono::steady_clock::now();
+    const uint32_t expected = checksum({0, data.size()});
+    const double singleThreaded = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+    ThreadPool pool;
+    assert(ErrorType::Success == pool.start(0));
+
+    uint32_t result = 0;
+    startTime = std::chrono::steady_clock::now();
+    assert(ErrorType::Success == pool.parallelReduce({0, data.size()}, 64 * 1024, uint32_t(0), checksum, [](const uint32_t a, const uint32_t b) { return a + b; }, result));
+    const double parallel = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    assert(expected == result);
+
+    PLT_LOGI(TAG, "Checksum of %u MiB: %.2f ms on one thread, %.2f ms on %u workers (%.2fx)",
+             static_cast<unsigned>(checksumBenchmarkSize / (1024 * 1024)), singleThreaded, parallel, pool.workers(), singleThreaded / parallel);
+
+    return EXIT_SUCCESS;
+}
+
+static int runAllTests() {
+    std::vector<std::function<int(void)>> tests = {
+        submitTest,
+        parallelForTest,
+        parallelReduceTest,
+        checksumBenchmark,
+    };
+
+    for (auto test : tests) {
+        if (EXIT_SUCCESS != test()) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int main() {
+
+    OperatingSystem::Init();
+    Logger::Init();
+
+    int result = runAllTests();
+
+    return result;
+}
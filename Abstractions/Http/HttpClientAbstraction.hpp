@@ -10,6 +10,7 @@
 //AbstractionLayer
 #include "HttpTypes.hpp"
 #include "NetworkAbstraction.hpp"
+#include "Coroutine.hpp"
 //C++
 #include <memory>
 
@@ -70,6 +71,29 @@ class HttpClientAbstraction {
      *            each time a segment of the message body is received.
      */
     virtual ErrorType receiveBlocking(HttpTypes::Response &response, const Milliseconds timeout) = 0;
+    /**
+     * @brief Send a request from a coroutine.
+     * @details co_await the result to get what sendBlocking would return. The request is sent by the thread running the network's events
+     *          while the coroutine's thread runs other events.
+     * @param[in] request The request to send. Must stay valid until the send has finished.
+     * @param[in] timeout The timeout
+     * @pre The network has been set.
+     * @sa sendBlocking
+     */
+    auto sendAwaitable(const HttpTypes::Request &request, const Milliseconds timeout) {
+        return _network->awaitEvent([this, &request, timeout]() -> ErrorType { return sendBlocking(request, timeout); });
+    }
+    /**
+     * @brief Receive a response from a coroutine.
+     * @details co_await the result to get what receiveBlocking would return.
+     * @param[out] response The response. Must stay valid until the receive has finished.
+     * @param[in] timeout The timeout
+     * @pre The network has been set.
+     * @sa receiveBlocking
+     */
+    auto receiveAwaitable(HttpTypes::Response &response, const Milliseconds timeout) {
+        return _network->awaitEvent([this, &response, timeout]() -> ErrorType { return receiveBlocking(response, timeout); });
+    }
     /**
      * @brief Send a request
      * @param[in] request The data to send
@@ -47,6 +47,12 @@ class OperatingSystemAbstraction {
             PLT_LOGI(TAG, "<Memory Region:%s> <Free (%%):%.1f> <Line>",
             memoryRegion.name.data(), memoryRegion.free);
         }
+        PLT_LOGI(TAG, "<ProcessStatus> <CPU (%%):%.1f, Resident (KiB):%llu, Heap Used (KiB):%llu> <Line, Line, Line>",
+        status().process.cpu, static_cast<unsigned long long>(status().process.residentBytes / 1024), static_cast<unsigned long long>(status().process.heapUsedBytes / 1024));
+        for (const auto &thread : status().threads) {
+            PLT_LOGI(TAG, "<Thread:%s> <CPU Time (ms):%llu, Voluntary Context Switches:%u, Involuntary Context Switches:%u, Stack High Water Mark (B):%u, Stack Size (B):%u> <Line, Line, Line, Line, Omit>",
+            thread.name.data(), static_cast<unsigned long long>(thread.cpuTime / 1000), thread.voluntaryContextSwitches, thread.involuntaryContextSwitches, thread.stackHighWaterMark, thread.stackSize);
+        }
     }
 
     /**
@@ -164,6 +170,144 @@ class OperatingSystemAbstraction {
      * @returns ErrorType::NoData if the semaphore does not exist.
     */
     virtual ErrorType decrementSemaphore(const std::array<char, OperatingSystemTypes::MaxSemaphoreNameLength> &name) = 0;
+    /**
+     * @brief creates a semaphore and returns a handle to it.
+     * @details The handle can be used in place of the name to skip looking up the semaphore by name on every call.
+     * @param[in] max The maximum value of the semaphore.
+     * @param[in] initial The initial value of the semaphore.
+     * @param[in] name The name of the semaphore.
+     * @param[out] semaphore The handle to the semaphore.
+     * @returns ErrorType::Success if the semaphore was created.
+     * @returns ErrorType::InvalidParameter if initial is greater than max or max is zero.
+     * @returns ErrorType::LimitReached if no more semaphores can be created.
+     * @returns ErrorType::NotImplemented if handles to semaphores are not implemented.
+    */
+    virtual ErrorType createSemaphore(const Count max, const Count initial, const std::array<char, OperatingSystemTypes::MaxSemaphoreNameLength> &name, Id &semaphore) = 0;
+    /**
+     * @brief deletes a semaphore.
+     * @param[in] semaphore The handle to the semaphore.
+     * @returns ErrorType::Success if the semaphore was deleted.
+     * @returns ErrorType::NoData if the semaphore does not exist.
+     * @returns ErrorType::NotImplemented if handles to semaphores are not implemented.
+    */
+    virtual ErrorType deleteSemaphore(const Id semaphore) = 0;
+    /**
+     * @brief waits for a semaphore.
+     * @param[in] semaphore The handle to the semaphore.
+     * @param[in] timeout The amount of time to wait for the semaphore.
+     * @returns ErrorType::Timeout if the semaphore couldn't be decremented within the timeout likely because the value is already zero.
+     * @returns ErrorType::Success if the was decremented.
+     * @returns ErrorType::NoData if the semaphore does not exist.
+     * @returns ErrorType::NotImplemented if handles to semaphores are not implemented.
+    */
+    virtual ErrorType waitSemaphore(const Id semaphore, const Milliseconds timeout) = 0;
+    /**
+     * @brief increments a semaphore.
+     * @param[in] semaphore The handle to the semaphore.
+     * @returns ErrorType::Success if the semaphore was incremented
+     * @returns ErrorType::LimitReached if the semaphore is already at its maximum value.
+     * @returns ErrorType::NoData if the semaphore does not exist.
+     * @returns ErrorType::NotImplemented if handles to semaphores are not implemented.
+    */
+    virtual ErrorType incrementSemaphore(const Id semaphore) = 0;
+    /**
+     * @brief decrements a semaphore without waiting.
+     * @param[in] semaphore The handle to the semaphore.
+     * @returns ErrorType::Success if the semaphore was decremented
+     * @returns ErrorType::Timeout if the semaphore is already zero.
+     * @returns ErrorType::NoData if the semaphore does not exist.
+     * @returns ErrorType::NotImplemented if handles to semaphores are not implemented.
+    */
+    virtual ErrorType decrementSemaphore(const Id semaphore) = 0;
+    /**
+     * @brief Create a mutex.
+     * @param[out] mutex The handle to the mutex.
+     * @param[in] priorityInheritance If true, a thread holding the mutex runs at the priority of the highest priority thread waiting for it.
+     * @returns ErrorType::Success if the mutex was created.
+     * @returns ErrorType::LimitReached if no more mutexes can be created.
+     * @returns ErrorType::NotImplemented if mutexes are not implemented.
+     * @returns ErrorType::Failure otherwise.
+    */
+    virtual ErrorType createMutex(Id &mutex, const bool priorityInheritance) = 0;
+    /**
+     * @brief Delete a mutex.
+     * @pre The mutex is not locked.
+     * @param[in] mutex The handle to the mutex.
+     * @returns ErrorType::Success if the mutex was deleted.
+     * @returns ErrorType::NoData if the mutex does not exist.
+     * @returns ErrorType::PrerequisitesNotMet if the mutex is locked. The mutex is not deleted.
+     * @returns ErrorType::NotImplemented if mutexes are not implemented.
+    */
+    virtual ErrorType deleteMutex(const Id mutex) = 0;
+    /**
+     * @brief Lock a mutex.
+     * @param[in] mutex The handle to the mutex.
+     * @param[in] timeout The amount of time to wait for the mutex. 0 returns straight away if the mutex is locked.
+     * @returns ErrorType::Success if the mutex was locked.
+     * @returns ErrorType::Timeout if the mutex could not be locked within the timeout.
+     * @returns ErrorType::PrerequisitesNotMet if the calling thread already holds the mutex.
+     * @returns ErrorType::NoData if the mutex does not exist.
+     * @returns ErrorType::NotImplemented if mutexes are not implemented.
+    */
+    virtual ErrorType lockMutex(const Id mutex, const Milliseconds timeout) = 0;
+    /**
+     * @brief Unlock a mutex.
+     * @param[in] mutex The handle to the mutex.
+     * @returns ErrorType::Success if the mutex was unlocked.
+     * @returns ErrorType::PrerequisitesNotMet if the calling thread does not hold the mutex.
+     * @returns ErrorType::NoData if the mutex does not exist.
+     * @returns ErrorType::NotImplemented if mutexes are not implemented.
+    */
+    virtual ErrorType unlockMutex(const Id mutex) = 0;
+    /**
+     * @brief Create a reader-writer lock.
+     * @details Any number of readers can hold the lock at once, or a single writer.
+     * @param[out] lock The handle to the lock.
+     * @returns ErrorType::Success if the lock was created.
+     * @returns ErrorType::LimitReached if no more locks can be created.
+     * @returns ErrorType::NotImplemented if reader-writer locks are not implemented.
+     * @returns ErrorType::Failure otherwise.
+    */
+    virtual ErrorType createReadWriteLock(Id &lock) = 0;
+    /**
+     * @brief Delete a reader-writer lock.
+     * @pre The lock is not held.
+     * @param[in] lock The handle to the lock.
+     * @returns ErrorType::Success if the lock was deleted.
+     * @returns ErrorType::NoData if the lock does not exist.
+     * @returns ErrorType::PrerequisitesNotMet if the lock is held. The lock is not deleted.
+     * @returns ErrorType::NotImplemented if reader-writer locks are not implemented.
+    */
+    virtual ErrorType deleteReadWriteLock(const Id lock) = 0;
+    /**
+     * @brief Take a reader-writer lock for reading.
+     * @param[in] lock The handle to the lock.
+     * @param[in] timeout The amount of time to wait for the lock. 0 returns straight away if a writer holds the lock.
+     * @returns ErrorType::Success if the lock was taken.
+     * @returns ErrorType::Timeout if the lock could not be taken within the timeout.
+     * @returns ErrorType::NoData if the lock does not exist.
+     * @returns ErrorType::NotImplemented if reader-writer locks are not implemented.
+    */
+    virtual ErrorType lockRead(const Id lock, const Milliseconds timeout) = 0;
+    /**
+     * @brief Take a reader-writer lock for writing.
+     * @param[in] lock The handle to the lock.
+     * @param[in] timeout The amount of time to wait for the lock. 0 returns straight away if the lock is held.
+     * @returns ErrorType::Success if the lock was taken.
+     * @returns ErrorType::Timeout if the lock could not be taken within the timeout.
+     * @returns ErrorType::NoData if the lock does not exist.
+     * @returns ErrorType::NotImplemented if reader-writer locks are not implemented.
+    */
+    virtual ErrorType lockWrite(const Id lock, const Milliseconds timeout) = 0;
+    /**
+     * @brief Release a reader-writer lock taken with lockRead() or lockWrite().
+     * @param[in] lock The handle to the lock.
+     * @returns ErrorType::Success if the lock was released.
+     * @returns ErrorType::PrerequisitesNotMet if the calling thread does not hold the lock.
+     * @returns ErrorType::NoData if the lock does not exist.
+     * @returns ErrorType::NotImplemented if reader-writer locks are not implemented.
+    */
+    virtual ErrorType unlockReadWriteLock(const Id lock) = 0;
     /**
      * @brief Create a timer.
      * @param[out] timer The id of the timer.
@@ -171,6 +315,7 @@ class OperatingSystemAbstraction {
      * @param[in] autoReload Whether the timer should start again automatically after it's timed out.
      * @param[in] callback The function to call when the timer times out.
      * @returns ErrorType::Success if the timer is successfully created.
+     * @returns ErrorType::InvalidParameter if autoReload is true and the period is 0.
      * @returns ErrorType::Failure if the timer could not be created.
     */
     virtual ErrorType createTimer(Id &timer, const Milliseconds period, const bool autoReload, std::function<void(void)> callback) = 0;
@@ -198,6 +343,48 @@ class OperatingSystemAbstraction {
      * @returns ErrorType::Timeout if the timer could not be stopped within the time specified.
     */
     virtual ErrorType stopTimer(const Id timer, const Milliseconds timeout) = 0;
+    /**
+     * @brief Create a periodic task for the calling thread to run at a fixed rate.
+     * @details Unlike calling delay() at the end of every loop, the time spent doing the work of each period does not push
+     *          back the start of the next one, so the task does not drift. The first period starts when the task is created.
+     * @param[out] task The id of the periodic task.
+     * @param[in] period The time between the start of each period.
+     * @param[in] spin How long before the start of each period to stop sleeping and spin instead. Trades CPU time for less jitter. 0 never spins.
+     * @returns ErrorType::Success if the periodic task was created.
+     * @returns ErrorType::InvalidParameter if the period is 0 or the spin is not less than the period.
+     * @returns ErrorType::LimitReached if no more periodic tasks can be created.
+     * @returns ErrorType::NotImplemented if periodic tasks are not implemented.
+    */
+    virtual ErrorType createPeriodicTask(Id &task, const Microseconds period, const Microseconds spin) = 0;
+    /**
+     * @brief Delete a periodic task.
+     * @param[in] task The id of the periodic task.
+     * @returns ErrorType::Success if the periodic task was deleted.
+     * @returns ErrorType::NoData if the periodic task does not exist.
+     * @returns ErrorType::NotImplemented if periodic tasks are not implemented.
+    */
+    virtual ErrorType deletePeriodicTask(const Id task) = 0;
+    /**
+     * @brief Block until the start of the next period.
+     * @details If the next period has already started, every period that started while the work was still being done is
+     *          counted as a missed deadline and the task waits for the next period that has not started yet instead of
+     *          running back to back to catch up.
+     * @param[in] task The id of the periodic task.
+     * @returns ErrorType::Success if the task woke up for the next period on time.
+     * @returns ErrorType::Timeout if one or more deadlines were missed.
+     * @returns ErrorType::NoData if the periodic task does not exist.
+     * @returns ErrorType::NotImplemented if periodic tasks are not implemented.
+    */
+    virtual ErrorType waitUntilNextPeriod(const Id task) = 0;
+    /**
+     * @brief Get the statistics for a periodic task.
+     * @param[in] task The id of the periodic task.
+     * @param[out] statistics The statistics.
+     * @returns ErrorType::Success if the statistics were retrieved.
+     * @returns ErrorType::NoData if the periodic task does not exist.
+     * @returns ErrorType::NotImplemented if periodic tasks are not implemented.
+    */
+    virtual ErrorType periodicTaskStatistics(const Id task, OperatingSystemTypes::PeriodicTaskStatistics &statistics) = 0;
     /**
      * @brief Create a queue to safely send and receive information between threads
      * @param[in] name The name of the queue which you can use to reference the queue
@@ -249,6 +436,24 @@ class OperatingSystemAbstraction {
      * @returns ErrorType::NotImplemented if getting the system time is not implemented
     */
     virtual ErrorType getSystemTime(UnixTime &currentSystemUnixTime) = 0;
+    /**
+     * @brief Get the current system time with sub-second resolution.
+     * @details The resolution depends on the platform. Platforms without a sub-second clock return whole seconds.
+     * @param[out] currentSystemTime The number of microseconds since the unix epoch in UTC.
+     * @returns ErrorType::Success if the system time was obtained
+     * @returns ErrorType::NotImplemented if getting the system time is not implemented
+    */
+    virtual ErrorType getSystemTime(Microseconds &currentSystemTime) = 0;
+    /**
+     * @brief Get the time on a clock that only ever moves forward.
+     * @details Use this to measure how long something took or to work out timeouts. Unlike the system time, it is not changed by
+     *          setting the time of day. The resolution depends on the platform. Platforms without a high resolution timer count
+     *          in system ticks.
+     * @param[out] time The number of nanoseconds since an arbitrary point in the past, usually when the system started.
+     * @returns ErrorType::Success if the time was obtained
+     * @returns ErrorType::NotImplemented if getting the monotonic time is not implemented
+    */
+    virtual ErrorType monotonicTime(Nanoseconds &time) = 0;
     /**
      * @brief Get the current system tick value
      * @param[out] currentSystemTicks The current tick value of the system.
@@ -335,6 +540,31 @@ class OperatingSystemAbstraction {
      * @returns ErrorType::Failure otherwise
      */
     virtual ErrorType memoryRegionUsage(OperatingSystemTypes::MemoryRegionInfo &region) = 0;
+    /**
+     * @brief Get the resources used by this process.
+     * @details CPU usage is measured over the time since the last call.
+     * @param[out] usage The resources used by this process.
+     * @returns ErrorType::Success if the usage was obtained.
+     * @returns ErrorType::NotImplemented if getting the process usage is not implemented.
+     * @returns ErrorType::Failure otherwise
+     */
+    virtual ErrorType processUsage(OperatingSystemTypes::ProcessUsage &usage) = 0;
+    /**
+     * @brief Get the statistics for a thread.
+     * @param[in,out] thread The thread to get statistics for (id should be set, the statistics will be updated)
+     * @returns ErrorType::Success if the statistics were obtained.
+     * @returns ErrorType::NoData if the thread does not exist.
+     * @returns ErrorType::NotImplemented if getting thread statistics is not implemented.
+     * @returns ErrorType::Failure otherwise
+     */
+    virtual ErrorType threadUsage(OperatingSystemTypes::ThreadInfo &thread) = 0;
+    /**
+     * @brief The number of processor cores that are currently online and able to run threads.
+     * @param[out] cores The number of online cores.
+     * @returns ErrorType::Success if the number of cores was obtained.
+     * @returns ErrorType::Failure otherwise.
+     */
+    virtual ErrorType onlineCores(Count &cores) = 0;
     /**
      * @brief The amount of time the system has been running for since the last reset.
      * @returns ErrorType::Success if the uptime was obtained.
@@ -370,6 +600,17 @@ class OperatingSystemAbstraction {
      * @endcode
      */
     virtual ErrorType block() = 0;
+    /**
+     * @brief Block the task who calls this function until it is unblocked or a time is reached.
+     * @details Thread safe but not interrupt safe. Should only be called by the task who wants to block itself.
+     * @param[in] time The time to stop blocking at, on the same clock as monotonicTime. Returns right away if the time has passed.
+     * @returns ErrorType::Success if the task was unblocked
+     * @returns ErrorType::Timeout if the time was reached without the task being unblocked.
+     * @returns ErrorType::LimitReached If the task was previously unblocked before it called blockUntil.
+     * @returns ErrorType::NoData if the calling task was not created by the operating system.
+     * @sa block
+     */
+    virtual ErrorType blockUntil(const Nanoseconds time) = 0;
     /**
      * @brief Unblock a task
      * @details Interrupt and thread safe.
@@ -389,11 +630,16 @@ class OperatingSystemAbstraction {
             getSystemTime(_status.systemTime);
             idlePercentage(_status.idle);
             uptime(_status.upTime);
+            processUsage(_status.process);
             
             // Update memory region usage
             for (auto &memoryRegion : _status.memoryRegion) {
                 memoryRegionUsage(memoryRegion);
             }
+
+            for (auto &thread : _status.threads) {
+                threadUsage(thread);
+            }
         }
 
         return _status;
@@ -440,7 +686,13 @@ class OperatingSystemAbstraction {
         .idle = -1,
         .upTime = 0,
         .memoryRegion = {},
-        .systemTime = 0
+        .systemTime = 0,
+        .process = {
+            .cpu = -1,
+            .residentBytes = 0,
+            .heapUsedBytes = 0
+        },
+        .threads = {}
     };
 
 };
@@ -90,6 +90,41 @@ namespace OperatingSystemTypes {
     };
 
 
+    /**
+     * @struct ProcessUsage
+     * @brief The resources used by this process.
+     */
+    struct ProcessUsage {
+        Percent cpu;            ///< The percent of all CPU time that was spent running this process since the last time usage was sampled.
+        uint64_t residentBytes; ///< The amount of physical memory used by this process.
+        uint64_t heapUsedBytes; ///< The amount of heap memory currently allocated by this process.
+    };
+
+    /**
+     * @struct ThreadInfo
+     * @brief Statistics for a thread.
+     */
+    struct ThreadInfo {
+        std::array<char, MaxThreadNameLength> name; ///< The name of the thread.
+        Id id;                                      ///< The Id of the thread.
+        Microseconds cpuTime;                       ///< The total amount of CPU time the thread has used.
+        Count voluntaryContextSwitches;             ///< The number of times the thread gave up the CPU because it blocked.
+        Count involuntaryContextSwitches;           ///< The number of times the thread was preempted.
+        Bytes stackSize;                            ///< The size of the thread's stack.
+        Bytes stackHighWaterMark;                   ///< The most stack the thread has used at once.
+    };
+
+    /**
+     * @struct PeriodicTaskStatistics
+     * @brief How well a periodic task has kept to its period.
+     */
+    struct PeriodicTaskStatistics {
+        Count periods;              ///< The number of periods the task has woken up for.
+        Count missedDeadlines;      ///< The number of periods that started before the task finished the work of the previous one.
+        Microseconds maxJitter;     ///< The longest the task has woken up after the start of a period.
+        Microseconds averageJitter; ///< The average amount of time the task woke up after the start of a period.
+    };
+
     /**
      * @struct Status
      * @brief The status of the operating system
@@ -100,6 +135,8 @@ namespace OperatingSystemTypes {
         Seconds upTime;                             ///< The amount of time since the system was last reset.
         std::vector<MemoryRegionInfo> memoryRegion; ///< Free memory on the system.
         UnixTime systemTime;                        ///< The current system time.
+        ProcessUsage process;                       ///< The resources used by this process.
+        std::vector<ThreadInfo> threads;            ///< Statistics for each thread that was created.
     };
 }
 
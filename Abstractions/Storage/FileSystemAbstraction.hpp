@@ -12,6 +12,7 @@
 #include "StaticString.hpp"
 #include "MemoryPool.hpp"
 #include "StorageAbstraction.hpp"
+#include "Coroutine.hpp"
 
 namespace {
     MemoryPool<StaticString::Container, APP_MAX_QUEUEABLE_EVENTS> ReadWritePool;
@@ -311,6 +312,27 @@ class FileSystemAbstraction {
     }
     /// @copydoc ErrorType writeBlocking(FileSystemTypes::File &file, std::string_view data)
     virtual ErrorType writeBlocking(FileSystemTypes::File &file, std::string_view data) = 0;
+    /**
+     * @brief Reads data from a file from a coroutine.
+     * @details co_await the result to get what readBlocking would return. The file is read by the thread running the storage's events
+     *          while the coroutine's thread runs other events.
+     * @param[in] file The file to read from.
+     * @param[out] buffer The buffer to read into. Must stay valid until the read has finished.
+     * @sa readBlocking
+     */
+    auto readAwaitable(FileSystemTypes::File &file, std::string &buffer) {
+        return _storage.awaitEvent([this, &file, &buffer]() -> ErrorType { return readBlocking(file, buffer); });
+    }
+    /**
+     * @brief Writes data to a file from a coroutine.
+     * @details co_await the result to get what writeBlocking would return.
+     * @param[in] file The file to write to.
+     * @param[in] data The data to write. Must stay valid until the write has finished.
+     * @sa writeBlocking
+     */
+    auto writeAwaitable(FileSystemTypes::File &file, std::string_view data) {
+        return _storage.awaitEvent([this, &file, data]() -> ErrorType { return writeBlocking(file, data); });
+    }
     /**
      * @brief Writes data to a file.
      * This is a non-blocking operating. Control will return as soon as the required data is passed to the calling thread
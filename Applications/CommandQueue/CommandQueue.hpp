@@ -13,7 +13,10 @@
 #include "Math.hpp"
 #include "OperatingSystemModule.hpp"
 //C++
+#include <array>
 #include <atomic>
+#include <bit>
+#include <span>
 
 #ifndef APP_MAX_NUMBER_OF_THREADS
 #error APP_MAX_NUMBER_OF_THREADS must be defined so that the list of waiting threads is properly sized.
@@ -44,6 +47,8 @@ namespace CommandQueueTypes {
 
     /// @brief The list of threads waiting for commands to be added.
     using WaitingThreads = std::array<Id, APP_MAX_NUMBER_OF_THREADS>;
+    /// @brief The list of threads waiting for commands to be added to an InstanceCommandQueue. NullId marks a free entry.
+    using WaitList = std::array<std::atomic<Id>, APP_MAX_NUMBER_OF_THREADS>;
 }
 
 /**
@@ -229,15 +234,336 @@ class CommandQueue {
     inline static CommandQueueTypes::WaitingThreads _WaitingThreads = {OperatingSystemTypes::NullId};
 
     bool addCommandIfNotFull() {
-        //The only other thing that can happen to _eventsClaimed in the time after we load it is that it could be decremented by runNextEvent() so if we pass
-        //this guard we will not overflow the queue.
-        const Count commandsClaimed = _CommandsClaimed.load();
-        if (commandsClaimed < _Commands.max_size()) {
-            _CommandsClaimed.fetch_add(1, std::memory_order_relaxed);
-            return true;
+        //Claimed with a compare and exchange so that producers racing for the last slot can't both pass the guard. One slot is always left
+        //empty because the first and last indicies are equal both when the queue is empty and when it is full.
+        Count commandsClaimed = _CommandsClaimed.load();
+        do {
+            if (commandsClaimed >= _Commands.max_size() - 1) {
+                return false;
+            }
+        } while (!_CommandsClaimed.compare_exchange_weak(commandsClaimed, commandsClaimed + 1, std::memory_order_relaxed));
+
+        return true;
+    }
+};
+
+/**
+ * @class InstanceCommandQueue
+ * @brief A command queue whose storage belongs to the object, so two queues of the same type don't share commands.
+ * @details Any number of threads can add and take commands without a lock. Threads waiting for commands push themselves onto a wait list
+ *          and each command added pops one of them to wake, instead of waking every waiting thread for every command.
+ * @tparam T The type of data that the command can store.
+ * @tparam Capacity The most commands that can be queued at once. Rounded up to a power of two.
+ * @code
+ * InstanceCommandQueue<uint32_t> commandQueue;
+ * uint32_t commandData = 42;
+ * commandQueue.addToQueue(commandData);
+ *
+ * //On the thread processing the commands
+ * while (true) {
+ *     uint32_t commandData;
+ *     if (ErrorType::Success == commandQueue.getNextInQueue(commandData)) {
+ *         //Process the command
+ *     }
+ *     else {
+ *         commandQueue.waitForCommands();
+ *     }
+ * }
+ * @endcode
+ * @sa EventQueue which uses the same ring with a single consumer.
+ */
+template<typename T, Count Capacity = CommandQueueTypes::MaxCommandQueueSize>
+class InstanceCommandQueue {
+
+    public:
+    /// @brief Constructor.
+    InstanceCommandQueue() {
+        for (Count i = 0; i < _commands.size(); i++) {
+            _commands[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    InstanceCommandQueue(const InstanceCommandQueue &) = delete;
+    InstanceCommandQueue &operator=(const InstanceCommandQueue &) = delete;
+
+    /**
+     * @brief Add a command to the queue and wake one of the threads waiting for commands.
+     * @details Interrupt and thread safe.
+     * @param commandData The command data to be added to the queue. Moved from if it was added.
+     * @returns ErrorType::Success if the command was added to the queue
+     * @returns ErrorType::LimitReached if the queue is full
+     */
+    ErrorType addToQueue(T &commandData) {
+        Count position = _enqueuePosition.load(std::memory_order_relaxed);
+        Slot *slot;
+
+        while (true) {
+            slot = &_commands[position & (_Size - 1)];
+            //Signed so that the comparison still works once the positions wrap around.
+            const int32_t lap = static_cast<int32_t>(slot->sequence.load(std::memory_order_acquire) - position);
+
+            if (0 == lap) {
+                if (_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+            else if (lap < 0) {
+                return ErrorType::LimitReached;
+            }
+            else {
+                position = _enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->command = std::move(commandData);
+        //Sequentially consistent so that it can't be reordered with the check for waiting threads that follows.
+        slot->sequence.store(position + 1, std::memory_order_seq_cst);
+
+        wakeWaitingThreads(1);
+
+        return ErrorType::Success;
+    }
+
+    /**
+     * @brief Add as many commands as there is room for with a single claim on the queue.
+     * @details Interrupt and thread safe. Cheaper than adding the commands one at a time since the range is claimed with one atomic
+     *          operation and the waiting threads are looked through once. The commands that are added stay together in the queue.
+     * @param commandData The commands to add, first to last. The ones that were added are moved from.
+     * @param added The number of commands from the front of commandData that were added.
+     * @returns ErrorType::Success if every command was added.
+     * @returns ErrorType::LimitReached if there was only room for some or none of them.
+     */
+    ErrorType addToQueueBatch(std::span<T> commandData, Count &added) {
+        added = 0;
+        if (commandData.empty()) {
+            return ErrorType::Success;
         }
 
-        return false;
+        Count position = _enqueuePosition.load(std::memory_order_relaxed);
+
+        while (true) {
+            //Free slots can only be filled by whoever claims them so they are still free if the claim succeeds.
+            added = 0;
+            while (added < commandData.size() && added < _Size && _commands[(position + added) & (_Size - 1)].sequence.load(std::memory_order_acquire) == position + added) {
+                added++;
+            }
+
+            if (0 == added) {
+                const int32_t lap = static_cast<int32_t>(_commands[position & (_Size - 1)].sequence.load(std::memory_order_acquire) - position);
+                if (lap < 0) {
+                    return ErrorType::LimitReached;
+                }
+
+                //Another producer claimed this position first.
+                position = _enqueuePosition.load(std::memory_order_relaxed);
+            }
+            else if (_enqueuePosition.compare_exchange_weak(position, position + added, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+
+        for (Count i = 0; i < added; i++) {
+            Slot &slot = _commands[(position + i) & (_Size - 1)];
+            slot.command = std::move(commandData[i]);
+            slot.sequence.store(position + i + 1, std::memory_order_release);
+        }
+        //Keeps the commands from being reordered with the check for waiting threads that follows. See waitForCommands.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        wakeWaitingThreads(added);
+
+        return added == commandData.size() ? ErrorType::Success : ErrorType::LimitReached;
+    }
+
+    /**
+     * @brief Return and remove the next command in the queue.
+     * @details Interrupt and thread safe.
+     * @param commandData The command data to be returned.
+     * @returns ErrorType::Success if there is a command in the queue
+     * @returns ErrorType::NoData if there are no commands in the queue
+     */
+    ErrorType getNextInQueue(T &commandData) {
+        Count position = _dequeuePosition.load(std::memory_order_relaxed);
+
+        while (true) {
+            Slot &slot = _commands[position & (_Size - 1)];
+            const int32_t lap = static_cast<int32_t>(slot.sequence.load(std::memory_order_acquire) - (position + 1));
+
+            if (0 == lap) {
+                if (_dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    commandData = std::move(slot.command);
+                    //Frees the slot for the next lap of the ring.
+                    slot.sequence.store(position + _Size, std::memory_order_release);
+                    return ErrorType::Success;
+                }
+            }
+            else if (lap < 0) {
+                return ErrorType::NoData;
+            }
+            else {
+                //Another thread took this command first.
+                position = _dequeuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Return and remove as many commands as are in the queue, up to the size of commandData, with a single claim on the queue.
+     * @details Interrupt and thread safe. The commands taken are the ones that were next in the queue, in order.
+     * @param commandData Where to put the commands. Its size is the most that are taken.
+     * @param taken The number of commands put at the front of commandData.
+     * @returns ErrorType::Success if at least one command was taken.
+     * @returns ErrorType::NoData if there are no commands in the queue
+     */
+    ErrorType getNextInQueueBatch(std::span<T> commandData, Count &taken) {
+        taken = 0;
+        if (commandData.empty()) {
+            return ErrorType::NoData;
+        }
+
+        Count position = _dequeuePosition.load(std::memory_order_relaxed);
+
+        while (true) {
+            //Published commands can only be taken by whoever claims them so they are still there if the claim succeeds.
+            taken = 0;
+            while (taken < commandData.size() && taken < _Size && _commands[(position + taken) & (_Size - 1)].sequence.load(std::memory_order_acquire) == position + taken + 1) {
+                taken++;
+            }
+
+            if (0 == taken) {
+                const int32_t lap = static_cast<int32_t>(_commands[position & (_Size - 1)].sequence.load(std::memory_order_acquire) - (position + 1));
+                if (lap < 0) {
+                    return ErrorType::NoData;
+                }
+
+                //Another thread took this command first.
+                position = _dequeuePosition.load(std::memory_order_relaxed);
+            }
+            else if (_dequeuePosition.compare_exchange_weak(position, position + taken, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+
+        for (Count i = 0; i < taken; i++) {
+            Slot &slot = _commands[(position + i) & (_Size - 1)];
+            commandData[i] = std::move(slot.command);
+            //Frees the slot for the next lap of the ring.
+            slot.sequence.store(position + i + _Size, std::memory_order_release);
+        }
+
+        return ErrorType::Success;
+    }
+
+    /**
+     * @brief Check if there are commands ready.
+     * @returns true if there are commands in the queue
+     * @returns false otherwise.
+     */
+    bool commandsReady() const {
+        const Count position = _dequeuePosition.load();
+        return _commands[position & (_Size - 1)].sequence.load() == position + 1;
+    }
+
+    /**
+     * @brief Block until there is a command in the queue.
+     * @details Returns right away if there already is one. Another thread may take the command first so check for NoData from
+     *          getNextInQueue and wait again.
+     * @returns ErrorType::Success when commands are ready.
+     * @returns ErrorType::LimitReached if APP_MAX_NUMBER_OF_THREADS threads are already waiting.
+     * @returns Any errors returned by OperatingSystem::currentThreadId()
+     * @returns Any errors returned by OperatingSystem::block()
+     */
+    ErrorType waitForCommands() {
+        if (commandsReady()) {
+            return ErrorType::Success;
+        }
+
+        Id thread = OperatingSystemTypes::NullId;
+        ErrorType error = OperatingSystem::Instance().currentThreadId(thread);
+        if (ErrorType::Success != error) {
+            return error;
+        }
+
+        for (auto &waitingThread : _waitList) {
+            Id free = OperatingSystemTypes::NullId;
+
+            if (waitingThread.compare_exchange_strong(free, thread)) {
+                _waiting.fetch_add(1);
+                //Either we see the command that was just added or the thread adding it sees us waiting and wakes us. Both sides are
+                //sequentially consistent so it can't be neither.
+                if (!commandsReady()) {
+                    error = OperatingSystem::Instance().block();
+                }
+
+                //Still on the list if we weren't the one that was woken.
+                Id self = thread;
+                if (waitingThread.compare_exchange_strong(self, OperatingSystemTypes::NullId)) {
+                    _waiting.fetch_sub(1, std::memory_order_relaxed);
+                }
+
+                return error;
+            }
+        }
+
+        return ErrorType::LimitReached;
+    }
+
+    /// @brief Get the status as a constant reference
+    const CommandQueueTypes::Status &status() const {
+        //The dequeue position is loaded first so that it can't be ahead of the enqueue position.
+        const Count dequeuePosition = _dequeuePosition.load(std::memory_order_relaxed);
+        _status.commandsQueued = _enqueuePosition.load(std::memory_order_relaxed) - dequeuePosition;
+        return _status;
+    }
+
+    private:
+    /// @brief The number of slots in the ring. A power of two so that positions can wrap around.
+    static constexpr Count _Size = std::bit_ceil(Capacity);
+    /// @brief Size of a cache line. Keeps the positions written by producers and consumers off each other's lines.
+    static constexpr Bytes _CacheLineSize = 64;
+    /**
+     * @struct Slot
+     * @brief A command in the queue and the sequence number that says whose turn it is to use it.
+     * @details For the slot at position p, sequence == p means it is free for a producer, and sequence == p + 1 means it holds a command.
+     */
+    struct Slot {
+        std::atomic<Count> sequence; ///< Whose turn it is to use the slot.
+        T command;                   ///< The command. Only touched by whoever the sequence says owns the slot.
+    };
+
+    /// @brief The ring buffer of commands.
+    alignas(_CacheLineSize) std::array<Slot, _Size> _commands;
+    /// @brief The position of the next command to add. Claimed by producers.
+    alignas(_CacheLineSize) std::atomic<Count> _enqueuePosition = 0;
+    /// @brief The position of the next command to take. Claimed by consumers.
+    alignas(_CacheLineSize) std::atomic<Count> _dequeuePosition = 0;
+    /// @brief The threads waiting for commands.
+    alignas(_CacheLineSize) CommandQueueTypes::WaitList _waitList = {OperatingSystemTypes::NullId};
+    /// @brief The number of threads on the wait list. Lets producers skip looking through it.
+    std::atomic<Count> _waiting = 0;
+    /// @brief The status of the queue.
+    mutable CommandQueueTypes::Status _status = {
+        0
+    };
+
+    /// @brief Wake one waiting thread for each command that was added, or every waiting thread if there are fewer of them.
+    void wakeWaitingThreads(Count commands) {
+        if (0 == _waiting.load()) {
+            return;
+        }
+
+        for (auto &waitingThread : _waitList) {
+            Id thread = waitingThread.load(std::memory_order_relaxed);
+
+            //Taking the thread off the list is what makes this the only command that wakes it.
+            if (OperatingSystemTypes::NullId != thread && waitingThread.compare_exchange_strong(thread, OperatingSystemTypes::NullId)) {
+                _waiting.fetch_sub(1, std::memory_order_relaxed);
+                OperatingSystem::Instance().unblock(thread);
+
+                if (0 == --commands) {
+                    return;
+                }
+            }
+        }
     }
 };
 
@@ -0,0 +1,291 @@
+/**************************************************************************//**
+* @author Ben Haubrich
+* @file   Coroutine.hpp
+* @details Coroutines that run on an event queue.
+* @ingroup Applications
+*******************************************************************************/
+#ifndef __COROUTINE_HPP__
+#define __COROUTINE_HPP__
+
+//AbstractionLayer
+#include "EventQueue.hpp"
+//C++
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#ifndef APP_MAX_COROUTINES
+///@brief The most coroutines that can exist at once. Their frames are allocated from a pool of this many instead of from the heap.
+#define APP_MAX_COROUTINES APP_MAX_QUEUEABLE_EVENTS
+#endif
+
+#ifndef APP_COROUTINE_FRAME_SIZE
+///@brief The most bytes a coroutine frame can take up. Creating a coroutine with a bigger frame fails with ErrorType::NoMemory.
+#define APP_COROUTINE_FRAME_SIZE (64 * sizeof(void *))
+#endif
+
+/**
+ * @class EventQueue::Task
+ * @brief A coroutine that runs on the thread of an event queue and returns an ErrorType.
+ * @details A task doesn't run until it is started with EventQueue::start or awaited by another task. While it waits for an operation the
+ *          thread of its event queue is free to run other events, so one thread can have any number of operations in flight at once.
+ *          Frames are allocated from a pool of APP_MAX_COROUTINES so creating a task never touches the heap.
+ * @code{.cpp}
+ * EventQueue::Task copyFile(FileSystemAbstraction &from, FileSystemAbstraction &to, FileSystemTypes::File &source, FileSystemTypes::File &destination, std::string &buffer) {
+ *     ErrorType error = co_await from.readAwaitable(source, buffer);
+ *     if (ErrorType::Success == error) {
+ *         error = co_await to.writeAwaitable(destination, buffer);
+ *     }
+ *
+ *     co_return error;
+ * }
+ *
+ * eventQueue.start(copyFile(from, to, source, destination, buffer));
+ * @endcode
+ */
+class EventQueue::Task {
+
+    public:
+    /**
+     * @class promise_type
+     * @brief The state of the coroutine that is kept in its frame.
+     */
+    class promise_type {
+
+        public:
+        /// @brief Called by the compiler to create the task returned to the caller of the coroutine.
+        Task get_return_object() noexcept { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        /// @brief Called by the compiler instead of get_return_object when the frame could not be allocated.
+        static Task get_return_object_on_allocation_failure() noexcept { return Task(); }
+        /// @brief Tasks don't run until they are started or awaited.
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        /**
+         * @struct FinalSuspend
+         * @brief Resumes the task awaiting this one, or frees the frame if nothing is.
+         */
+        struct FinalSuspend {
+            bool await_ready() const noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> coroutine) noexcept {
+                promise_type &promise = coroutine.promise();
+
+                if (promise._continuation) {
+                    //The awaiting task carries on from wherever this one finished.
+                    promise._continuation.promise()._queue = promise._queue;
+                    return promise._continuation;
+                }
+
+                //Started by EventQueue::start so nothing else owns the frame.
+                const std::optional<Future<>::Promise> done = promise._done;
+                const ErrorType result = promise._result;
+                coroutine.destroy();
+                if (done.has_value()) {
+                    done->complete(result);
+                }
+
+                return std::noop_coroutine();
+            }
+            void await_resume() const noexcept {}
+        };
+        /// @brief Called by the compiler when the coroutine finishes.
+        FinalSuspend final_suspend() noexcept { return {}; }
+        /// @brief Called by the compiler for co_return.
+        void return_value(const ErrorType result) noexcept { _result = result; }
+        /// @brief Called by the compiler if an exception escapes the coroutine.
+        void unhandled_exception() noexcept { std::terminate(); }
+
+        /**
+         * @brief Allocate a frame from the pool.
+         * @returns nullptr if the frame is bigger than APP_COROUTINE_FRAME_SIZE or every frame is in use.
+         */
+        static void *operator new(const size_t size) noexcept;
+        /// @brief Return a frame to the pool.
+        static void operator delete(void *frame) noexcept;
+
+        /// @brief The event queue the coroutine is resumed on. nullptr if it resumes on whichever thread finished what it was waiting for.
+        EventQueue *queue() const { return _queue; }
+        /// @brief Move the coroutine to another event queue.
+        void setQueue(EventQueue *queue) { _queue = queue; }
+        /// @brief Where the coroutine waits to be resumed when its event queue is full.
+        Resumption &resumption() { return _resumption; }
+
+        private:
+        friend class Task;
+        friend class EventQueue;
+        /// @brief The event queue the coroutine is resumed on.
+        EventQueue *_queue = nullptr;
+        /// @brief The task awaiting this one.
+        std::coroutine_handle<promise_type> _continuation;
+        /// @brief The value given to co_return.
+        ErrorType _result = ErrorType::Failure;
+        /// @brief Completed with the result when a started task finishes.
+        std::optional<Future<>::Promise> _done;
+        /// @brief Where the coroutine waits to be resumed when its event queue is full.
+        Resumption _resumption;
+    };
+
+    /// @brief Constructor. Holds no coroutine.
+    Task() = default;
+    /// @brief Move constructor. Leaves other empty.
+    Task(Task &&other) noexcept : _coroutine(std::exchange(other._coroutine, nullptr)) {}
+    /// @brief Move assignment. Leaves other empty.
+    Task &operator=(Task &&other) noexcept {
+        if (this != &other) {
+            reset();
+            _coroutine = std::exchange(other._coroutine, nullptr);
+        }
+
+        return *this;
+    }
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+    /// @brief Destructor. Destroys the coroutine if it hasn't been started.
+    ~Task() {
+        reset();
+    }
+
+    /// @brief False if the frame of the coroutine could not be allocated.
+    explicit operator bool() const { return static_cast<bool>(_coroutine); }
+
+    /// @brief Run this task from another and resume the other with the result once this one finishes. Runs on the other's event queue.
+    bool await_ready() const noexcept { return !_coroutine; }
+    /// @copydoc await_ready
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> awaiting) noexcept {
+        _coroutine.promise()._queue = awaiting.promise()._queue;
+        _coroutine.promise()._continuation = awaiting;
+        return _coroutine;
+    }
+    /**
+     * @brief The result of the awaited task.
+     * @returns The value given to co_return.
+     * @returns ErrorType::NoMemory if the frame of the task could not be allocated.
+     */
+    ErrorType await_resume() const noexcept {
+        return _coroutine ? _coroutine.promise()._result : ErrorType::NoMemory;
+    }
+
+    /// @brief The number of frames left in the pool.
+    static Count framesAvailable();
+
+    private:
+    friend class EventQueue;
+    /// @brief Constructor.
+    explicit Task(std::coroutine_handle<promise_type> coroutine) : _coroutine(coroutine) {}
+    /// @brief The coroutine. nullptr if the frame could not be allocated or it has been started.
+    std::coroutine_handle<promise_type> _coroutine;
+
+    void reset() {
+        if (_coroutine) {
+            _coroutine.destroy();
+            _coroutine = nullptr;
+        }
+    }
+};
+
+/**
+ * @class EventQueue::Schedule
+ * @brief Moves the awaiting task onto the thread of an event queue.
+ * @details Also yields to the events already waiting when the task is on that thread already.
+ * @code{.cpp}
+ * if (ErrorType::Success == co_await otherQueue.schedule()) {
+ *     //Running on the thread of otherQueue.
+ * }
+ * @endcode
+ */
+class EventQueue::Schedule {
+
+    public:
+    /// @brief Constructor.
+    Schedule(EventQueue &queue, const Priority priority) : _queue(queue), _priority(priority) {}
+
+    bool await_ready() const noexcept { return false; }
+    /// @brief Adds an event that resumes the task. Doesn't suspend if it could not be added.
+    bool await_suspend(std::coroutine_handle<Task::promise_type> coroutine) noexcept;
+    /**
+     * @returns ErrorType::Success if the task moved to the event queue.
+     * @returns ErrorType::LimitReached if the lane is full. The task is still on the event queue it was on.
+     * @returns ErrorType::PrerequisitesNotMet if the thread that runs the event queue is not known to the operating system.
+     */
+    ErrorType await_resume() const noexcept { return _error; }
+
+    private:
+    /// @brief The event queue to move to.
+    EventQueue &_queue;
+    /// @brief The lane the task waits in.
+    Priority _priority;
+    /// @brief Why the task could not be moved.
+    ErrorType _error = ErrorType::Success;
+};
+
+/**
+ * @class EventQueue::Awaitable
+ * @brief Runs an operation on the thread of an event queue and resumes the awaiting task with its result on the task's own event queue.
+ * @details Lets a task call the blocking functions of classes that run their work on an event queue. The operation runs on the thread that
+ *          owns that queue so it never has to block, and the task's thread runs other events in the meantime. If the task is already on that
+ *          thread the operation is just called.
+ * @tparam Operation Callable with no arguments that returns ErrorType. Kept in the awaiting coroutine's frame.
+ */
+template <typename Operation>
+class EventQueue::Awaitable {
+
+    public:
+    /// @brief Constructor.
+    Awaitable(EventQueue &queue, Operation operation) : _queue(queue), _operation(std::move(operation)) {}
+
+    bool await_ready() const noexcept { return _queue.currentThreadIsOwner(); }
+    /// @brief Adds an event that runs the operation. Doesn't suspend if it could not be added.
+    bool await_suspend(std::coroutine_handle<Task::promise_type> coroutine) noexcept {
+        _coroutine = coroutine;
+
+        Event event([this]() -> ErrorType {
+            const ErrorType result = _operation();
+            _result = result;
+            //The awaitable is in the coroutine's frame, which may be gone once the coroutine is resumed.
+            EventQueue::resume(_coroutine.promise().queue(), _coroutine, _coroutine.promise().resumption());
+            return result;
+        });
+
+        //Set first because the coroutine may be resumed on another thread before addEvent returns.
+        _ran = true;
+        const ErrorType error = _queue.addPinnedEvent(event);
+        if (ErrorType::Success != error) {
+            _ran = false;
+            _result = error;
+            return false;
+        }
+
+        return true;
+    }
+    /**
+     * @returns The result of the operation.
+     * @returns The error adding the event if the operation could not be run.
+     */
+    ErrorType await_resume() {
+        if (!_ran && ErrorType::Success == _result) {
+            return _operation();
+        }
+
+        return _result;
+    }
+
+    private:
+    /// @brief The event queue whose thread runs the operation.
+    EventQueue &_queue;
+    /// @brief The operation.
+    Operation _operation;
+    /// @brief The awaiting coroutine.
+    std::coroutine_handle<Task::promise_type> _coroutine;
+    /// @brief The result of the operation, or the error adding it.
+    ErrorType _result = ErrorType::Success;
+    /// @brief True once the operation has been handed to the event queue.
+    bool _ran = false;
+};
+
+template <typename Operation>
+EventQueue::Awaitable<std::decay_t<Operation>> EventQueue::awaitEvent(Operation &&operation) {
+    return Awaitable<std::decay_t<Operation>>(*this, std::forward<Operation>(operation));
+}
+
+#endif //__COROUTINE_HPP__
@@ -1,55 +1,469 @@
 //AbsractionLayer
 #include "EventQueue.hpp"
+#include "Coroutine.hpp"
 #include "OperatingSystemModule.hpp"
+//C++
+#include <algorithm>
+#include <limits>
+#include <cstdio>
+#include <cerrno>
+#ifdef __linux__
+//Posix
+#include <sys/eventfd.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    /**
+     * @class FramePool
+     * @brief Coroutine frames that any thread can allocate and free without taking a lock.
+     * @details The free frames form a stack linked by index. The top of the stack is kept with a count of the times it has changed so that
+     *          a frame being freed and allocated again while another thread is popping it can't be mistaken for the stack not changing.
+     */
+    class FramePool {
+
+        public:
+        FramePool() {
+            for (Count i = 0; i < APP_MAX_COROUTINES; i++) {
+                //Indicies are stored plus one so that 0 can mark the bottom of the stack.
+                _next[i].store(i + 1 < APP_MAX_COROUTINES ? i + 2 : 0, std::memory_order_relaxed);
+            }
+            _top.store(APP_MAX_COROUTINES > 0 ? 1 : 0, std::memory_order_relaxed);
+        }
+
+        void *allocate() {
+            uint64_t top = _top.load(std::memory_order_acquire);
+
+            while (true) {
+                const uint32_t index = static_cast<uint32_t>(top);
+                if (0 == index) {
+                    return nullptr;
+                }
+
+                const uint64_t next = ((top >> 32) + 1) << 32 | _next[index - 1].load(std::memory_order_relaxed);
+                if (_top.compare_exchange_weak(top, next, std::memory_order_acquire, std::memory_order_acquire)) {
+                    _available.fetch_sub(1, std::memory_order_relaxed);
+                    return &_frames[index - 1];
+                }
+            }
+        }
+
+        void deallocate(void *frame) {
+            const uint32_t index = static_cast<uint32_t>(static_cast<Frame *>(frame) - _frames.data()) + 1;
+            uint64_t top = _top.load(std::memory_order_relaxed);
+            uint64_t next;
+
+            do {
+                _next[index - 1].store(static_cast<uint32_t>(top), std::memory_order_relaxed);
+                next = ((top >> 32) + 1) << 32 | index;
+            } while (!_top.compare_exchange_weak(top, next, std::memory_order_release, std::memory_order_relaxed));
+
+            _available.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        Count available() const { return _available.load(std::memory_order_relaxed); }
+
+        private:
+        /// @brief Storage for one coroutine frame.
+        struct alignas(std::max_align_t) Frame {
+            unsigned char bytes[APP_COROUTINE_FRAME_SIZE];
+        };
+
+        std::array<Frame, APP_MAX_COROUTINES> _frames;
+        /// @brief The frame below each free frame on the stack, plus one.
+        std::array<std::atomic<uint32_t>, APP_MAX_COROUTINES> _next;
+        /// @brief The free frame on top of the stack, plus one, in the low half. The number of times the top has changed in the high half.
+        std::atomic<uint64_t> _top;
+        /// @brief The number of free frames.
+        std::atomic<Count> _available = APP_MAX_COROUTINES;
+    };
+
+    FramePool &framePool() {
+        static FramePool pool;
+        return pool;
+    }
+
+    /// @brief The event queue that the calling thread is a worker of, or nullptr if it is not a worker of any.
+    thread_local EventQueue *CurrentWorkerQueue = nullptr;
+    /// @brief Used to give the workers of each queue unique thread names.
+    std::atomic<Count> WorkerGroupsCreated = 0;
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static void *EventQueueWorker(void *arguments) {
+    static_cast<EventQueue *>(arguments)->workerLoop();
+
+    return nullptr;
+}
+
+#ifdef __cplusplus
+}
+#endif
 
 EventQueue::EventQueue() {
     _ownerThreadId = OperatingSystemTypes::NullId;
     //If the optimizations are disabled, the thread is not known to the OperatingSystem. It only knows about threads that it explicitely creates.
     //e.g. You create an event queue in main.cpp. This thread is not known to the OperatingSystem.
     _addEventOptimizationsEnabled = (ErrorType::Success == OperatingSystem::Instance().currentThreadId(_ownerThreadId));
+
+    for (auto &lane : _lanes) {
+        for (Count i = 0; i < lane.events.size(); i++) {
+            lane.events[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    for (Count i = 0; i < _freeTimedEvents.size(); i++) {
+        _freeTimedEvents[i] = i;
+    }
+
+    for (auto &watch : _watches) {
+        watch.descriptor = -1;
+    }
+
+#ifdef __linux__
+    _wakeDescriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+}
+
+EventQueue::~EventQueue() {
+#ifdef __linux__
+    if (-1 != _pollDescriptor) {
+        close(_pollDescriptor);
+    }
+    if (-1 != _wakeDescriptor) {
+        close(_wakeDescriptor);
+    }
+#endif
+}
+
+ErrorType EventQueue::addEvent(Event &event, const Priority priority) {
+    if (runsInline()) {
+        return event.run();
+    }
+
+    if (0 != event._coalescingKey && _Pinned != event._coalescingKey && coalesce(event, _lanes[laneOf(priority)])) {
+        _eventsCoalesced.fetch_add(1, std::memory_order_relaxed);
+        return ErrorType::Success;
+    }
+
+    const ErrorType error = enqueue(event, priority, true);
+    if (ErrorType::LimitReached == error) {
+        return overflow(event, priority);
+    }
+
+    return error;
+}
+
+ErrorType EventQueue::addPinnedEvent(Event &event) {
+    if (runsInline()) {
+        return event.run();
+    }
+
+    return enqueue(event, Priority::Normal);
 }
 
-ErrorType EventQueue::addEvent(Event &event) {
+bool EventQueue::runsInline() const {
     Id currentThreadId = 0;
-    ErrorType error = OperatingSystem::Instance().currentThreadId(currentThreadId);
+    OperatingSystem::Instance().currentThreadId(currentThreadId);
+
+    if (_multipleConsumers.load(std::memory_order_relaxed)) {
+        //Lets an event make blocking calls that add events of their own, as it could when run by the owner.
+        return OperatingSystemTypes::NullId == currentThreadId || this == CurrentWorkerQueue;
+    }
 
     //The event is being run from the same context as the thread that runs the mainLoop so we can skip the queue and run it immediately.
     if (_ownerThreadId == currentThreadId && _addEventOptimizationsEnabled) {
-        error = event.run();
+        return true;
     }
+
     //Either the caller or the owner of the event queue are not known to the operating system. Queuing would result in the event waiting in the queue forever
     //and the caller can not be blocked. Run the event immediately.
-    else if (OperatingSystemTypes::NullId == currentThreadId || OperatingSystemTypes::NullId == _ownerThreadId) {
-        error = event.run();
+    return OperatingSystemTypes::NullId == currentThreadId || OperatingSystemTypes::NullId == _ownerThreadId;
+}
+
+bool EventQueue::hasConsumer() const {
+    return OperatingSystemTypes::NullId != _ownerThreadId || _multipleConsumers.load(std::memory_order_relaxed);
+}
+
+ErrorType EventQueue::addEventAt(const Nanoseconds time, Event &event) {
+    if constexpr (0 == _MaxTimedEvents) {
+        return ErrorType::NotSupported;
     }
-    else if (addEventIfNotFull()) {
-        Count currentEventQueueIndexLast = _currentEventQueueIndexLast.load();
 
-        //https://youtu.be/kPh8pod0-gk?list=PLc1ANd9mG2dwG-kovSjkjuWq8CpskvEye&t=1128
-        while (!(_currentEventQueueIndexLast.compare_exchange_weak(currentEventQueueIndexLast, (currentEventQueueIndexLast + 1) % _events.max_size())));
+    if (!hasConsumer()) {
+        return ErrorType::PrerequisitesNotMet;
+    }
 
-        //If the last index is the size of the array, then we know that what is stored in memory is now zero.
-        _events[currentEventQueueIndexLast] = std::move(event);
-        //_eventsReady is not a function because it needs to be evaluated at specific points in the code. We can't let runNextEvent try to run an
-        //event while we are still in the middle of adding an event to the queue.
-        _eventsReady = true;
+    //Reserve room on the timer heap now so that the thread running the events never finds it full.
+    if (_timedEventsReserved.fetch_add(1, std::memory_order_relaxed) >= _MaxTimedEvents) {
+        _timedEventsReserved.fetch_sub(1, std::memory_order_relaxed);
+        return ErrorType::LimitReached;
+    }
 
-        for (auto &waitingThread : _waitingThreads) {
-            if (waitingThread != OperatingSystemTypes::NullId) {
-                OperatingSystem::Instance().unblock(waitingThread);
+    //0 means the event isn't timed. A time of 0 has long passed anyway.
+    event._runAt = std::max<Nanoseconds>(time, 1);
+    //The lane only carries the event to the thread running the events so use the one that is looked at first.
+    const ErrorType error = enqueue(event, Priority::High);
+    if (ErrorType::Success != error) {
+        event._runAt = 0;
+        _timedEventsReserved.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    return error;
+}
+
+ErrorType EventQueue::addEventAfter(const Microseconds delay, Event &event) {
+    Nanoseconds now = 0;
+    const ErrorType error = OperatingSystem::Instance().monotonicTime(now);
+    if (ErrorType::Success != error) {
+        return error;
+    }
+
+    return addEventAt(now + delay * 1000, event);
+}
+
+ErrorType EventQueue::enqueue(Event &event, const Priority priority, const bool replaceable) {
+    Lane &lane = _lanes[laneOf(priority)];
+    Count position = lane.enqueuePosition.load(std::memory_order_relaxed);
+    Slot *slot;
+
+    while (true) {
+        slot = &lane.events[position & (_MaxEvents - 1)];
+        //Signed so that the comparison still works once the positions wrap around.
+        const int32_t lap = static_cast<int32_t>(slot->sequence.load(std::memory_order_acquire) - position);
+
+        if (0 == lap) {
+            //The slot is free. Claiming the position gives us sole ownership of it until we publish the event.
+            if (lane.enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        else if (lap < 0) {
+            //The consumer hasn't run the event left here on the previous lap.
+            return ErrorType::LimitReached;
+        }
+        else {
+            //Another producer claimed this position first.
+            position = lane.enqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->event = std::move(event);
+    slot->order.store(position, std::memory_order_relaxed);
+    //Timed events leave the slot before they run so there would be nothing left to replace.
+    slot->key.store(replaceable && 0 == slot->event._runAt ? slot->event._coalescingKey : _Pinned, std::memory_order_relaxed);
+    //Publishes the event. Sequentially consistent so that it can't be reordered with the check for waiting threads that follows.
+    slot->sequence.store(position + 1, std::memory_order_seq_cst);
+
+    wakeWaitingThreads();
+
+    return ErrorType::Success;
+}
+
+ErrorType EventQueue::overflow(Event &event, const Priority priority) {
+    switch (_overflowPolicy.load(std::memory_order_relaxed)) {
+        case OverflowPolicy::DropNewest:
+            event = Event();
+            _eventsDropped.fetch_add(1, std::memory_order_relaxed);
+            return ErrorType::Success;
+        case OverflowPolicy::DropOldest:
+            return dropOldest(event, priority);
+        case OverflowPolicy::Block: {
+            const Microseconds timeout = _overflowTimeout.load(std::memory_order_relaxed);
+            Nanoseconds deadline = 0;
+            ErrorType error;
+            if (0 != timeout) {
+                if (ErrorType::Success != (error = OperatingSystem::Instance().monotonicTime(deadline))) {
+                    return error;
+                }
+                deadline += timeout * 1000;
+            }
+
+            do {
+                if (ErrorType::Success != (error = waitForRoom(_lanes[laneOf(priority)], deadline))) {
+                    return error;
+                }
+            } while (ErrorType::LimitReached == (error = enqueue(event, priority, true)));
+
+            return error;
+        }
+        case OverflowPolicy::Reject:
+        default:
+            return ErrorType::LimitReached;
+    }
+}
+
+bool EventQueue::coalesce(Event &event, Lane &lane) {
+    const Id key = event._coalescingKey;
+    const Count end = lane.enqueuePosition.load(std::memory_order_acquire);
+
+    //Oldest first so that the replacement runs as soon as the first event with the key would have.
+    for (Count position = end - _MaxEvents; position != end; position++) {
+        Slot &slot = lane.events[position & (_MaxEvents - 1)];
+
+        if (slot.sequence.load(std::memory_order_acquire) == position + 1 && slot.key.load(std::memory_order_relaxed) == key) {
+            if (replaceEvent(slot, position, key, event)) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+ErrorType EventQueue::dropOldest(Event &event, const Priority priority) {
+    Lane &lane = _lanes[laneOf(priority)];
+
+    while (true) {
+        //Events that were added in place of a dropped one sort at the tail so the oldest isn't always in the slot the next producer is waiting for.
+        const Count end = lane.enqueuePosition.load(std::memory_order_acquire);
+        Count oldest = end;
+        Count oldestOrder = 0;
+        for (Count position = end - _MaxEvents; position != end; position++) {
+            const Slot &slot = lane.events[position & (_MaxEvents - 1)];
+            const Count sequence = slot.sequence.load(std::memory_order_acquire);
+            //Claimed by a producer that hasn't published it yet. It sorts where it was claimed.
+            const Count order = sequence == position + 1 ? slot.order.load(std::memory_order_relaxed) : position;
+
+            //Signed so that the comparison still works once the orders wrap around.
+            if ((sequence == position || sequence == position + 1) && (end == oldest || static_cast<int32_t>(oldestOrder - order) > 0)) {
+                oldest = position;
+                oldestOrder = order;
+            }
+        }
+
+        if (end != oldest) {
+            Slot &slot = lane.events[oldest & (_MaxEvents - 1)];
+            if (slot.sequence.load(std::memory_order_acquire) != oldest + 1 || _Pinned == slot.key.load(std::memory_order_relaxed)) {
+                //Either there is nothing to drop yet or the oldest event can't be dropped.
+                return ErrorType::LimitReached;
+            }
+
+            if (requeueEvent(lane, slot, oldest, oldestOrder, event)) {
+                _eventsDropped.fetch_add(1, std::memory_order_relaxed);
+                return ErrorType::Success;
             }
         }
 
-        error = ErrorType::Success;
+        //The oldest event was taken or replaced while we looked at it, so there may be room now.
+        const ErrorType error = enqueue(event, priority, true);
+        if (ErrorType::LimitReached != error) {
+            return error;
+        }
     }
-    else {
-        error = ErrorType::LimitReached;
+}
+
+bool EventQueue::replaceEvent(Slot &slot, const Count position, const Id key, Event &event) {
+    if (slot.busy.exchange(true, std::memory_order_acquire)) {
+        return false;
+    }
+
+    //Checked again now that nobody else can take or replace the event.
+    const bool replaceable = slot.sequence.load(std::memory_order_acquire) == position + 1 && slot.key.load(std::memory_order_relaxed) == key &&
+                             slot.event._deadline == event._deadline && slot.event._affinityKey == event._affinityKey;
+    if (replaceable) {
+        //Only the callback is replaced. Everything the thread running the events sorted the event by stays the same.
+        slot.event._eventCallback = std::move(event._eventCallback);
+        slot.key.store(event._coalescingKey, std::memory_order_relaxed);
     }
 
+    slot.busy.store(false, std::memory_order_release);
+
+    return replaceable;
+}
+
+bool EventQueue::requeueEvent(Lane &lane, Slot &slot, const Count position, const Count order, Event &event) {
+    if (slot.busy.exchange(true, std::memory_order_acquire)) {
+        return false;
+    }
+
+    const bool droppable = slot.sequence.load(std::memory_order_acquire) == position + 1 && slot.order.load(std::memory_order_relaxed) == order &&
+                           _Pinned != slot.key.load(std::memory_order_relaxed);
+    if (droppable) {
+        slot.event = std::move(event);
+        slot.key.store(slot.event._coalescingKey, std::memory_order_relaxed);
+        //Behind every event added so far, the same as if it had found room.
+        slot.order.store(lane.enqueuePosition.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+
+    slot.busy.store(false, std::memory_order_release);
+
+    if (droppable) {
+        //The thread running the events may have sorted the dropped event already.
+        lane.reordered.store(true, std::memory_order_release);
+    }
+
+    return droppable;
+}
+
+ErrorType EventQueue::waitForRoom(const Lane &lane, const Nanoseconds deadline) {
+    Id thread = OperatingSystemTypes::NullId;
+    if (ErrorType::Success != OperatingSystem::Instance().currentThreadId(thread)) {
+        return ErrorType::PrerequisitesNotMet;
+    }
+
+    ErrorType error = ErrorType::LimitReached;
+    //Sequentially consistent so that either we see the slot that was just freed or the thread running the events sees us waiting.
+    _blockedProducerCount.fetch_add(1, std::memory_order_seq_cst);
+
+    for (auto &blockedProducer : _blockedProducers) {
+        Id free = OperatingSystemTypes::NullId;
+
+        if (blockedProducer.compare_exchange_strong(free, thread)) {
+            const Count position = lane.enqueuePosition.load(std::memory_order_seq_cst);
+
+            if (static_cast<int32_t>(lane.events[position & (_MaxEvents - 1)].sequence.load(std::memory_order_seq_cst) - position) >= 0) {
+                error = ErrorType::Success;
+            }
+            else {
+                error = 0 == deadline ? OperatingSystem::Instance().block() : OperatingSystem::Instance().blockUntil(deadline);
+                //Anything but the deadline passing is worth another try.
+                if (ErrorType::Timeout != error) {
+                    error = ErrorType::Success;
+                }
+            }
+
+            blockedProducer.store(OperatingSystemTypes::NullId, std::memory_order_relaxed);
+            break;
+        }
+    }
+
+    _blockedProducerCount.fetch_sub(1, std::memory_order_relaxed);
+
     return error;
 }
 
-ErrorType EventQueue::waitForEvents() {
+void EventQueue::wakeBlockedProducers() {
+    //Pairs with waitForRoom so that the slots freed before this can't be missed by a producer we don't see.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (0 == _blockedProducerCount.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    for (auto &blockedProducer : _blockedProducers) {
+        const Id thread = blockedProducer.load(std::memory_order_relaxed);
+        if (thread != OperatingSystemTypes::NullId) {
+            OperatingSystem::Instance().unblock(thread);
+        }
+    }
+}
+
+void EventQueue::wakeWaitingThreads() {
+    signalWakeDescriptor();
+
+    for (auto &waitingThread : _waitingThreads) {
+        const Id thread = waitingThread.load();
+        if (thread != OperatingSystemTypes::NullId) {
+            OperatingSystem::Instance().unblock(thread);
+        }
+    }
+}
+
+ErrorType EventQueue::waitForEvents(const Idle &idle) {
     Id thread = OperatingSystemTypes::NullId;
     ErrorType threadIdError = OperatingSystem::Instance().currentThreadId(thread);
     ErrorType error = ErrorType::LimitReached;
@@ -57,11 +471,22 @@ ErrorType EventQueue::waitForEvents() {
     if (ErrorType::Success == threadIdError) {
 
         for (auto &waitingThread : _waitingThreads) {
+            Id free = OperatingSystemTypes::NullId;
 
-            if (waitingThread == OperatingSystemTypes::NullId) {
-                waitingThread = thread;
-                error = OperatingSystem::Instance().block();
-                waitingThread = OperatingSystemTypes::NullId;
+            if (waitingThread.compare_exchange_strong(free, thread)) {
+                //Either we see the event that was just added or the thread adding it sees us waiting and unblocks us. Both sides
+                //are sequentially consistent so it can't be neither.
+                if (eventsArrived(idle)) {
+                    error = ErrorType::Success;
+                }
+                else if (0 == idle.wakeAt) {
+                    error = OperatingSystem::Instance().block();
+                }
+                else if (ErrorType::Timeout == (error = OperatingSystem::Instance().blockUntil(idle.wakeAt))) {
+                    //The next timed event is due.
+                    error = ErrorType::Success;
+                }
+                waitingThread.store(OperatingSystemTypes::NullId, std::memory_order_relaxed);
                 break;
             }
         }
@@ -71,39 +496,847 @@ ErrorType EventQueue::waitForEvents() {
 }
 
 ErrorType EventQueue::runNextEvent(const LoopMode loopMode) {
-    ErrorType error = ErrorType::NoData;
+    Count eventsRun;
+    return runEvents(loopMode, eventsRun);
+}
+
+bool EventQueue::eventsArrived(const Idle &idle) const {
+    return _multipleConsumers.load(std::memory_order_relaxed) ? workAvailable(idle) : eventsReady();
+}
+
+bool EventQueue::workAvailable(const Idle &idle) const {
+    if (_stopWorkers.load() || nullptr != _resumptions.load()) {
+        return true;
+    }
+
+    for (const auto &lane : _lanes) {
+        //Loaded before the changes so that if another worker has already seen a new event, we see that it changed them.
+        const Count scanPosition = lane.scanPosition.load();
+
+        if (lane.events[scanPosition & (_MaxEvents - 1)].sequence.load() == scanPosition + 1) {
+            return true;
+        }
+    }
+
+    return idle.changes != _consumerChanges.load();
+}
 
-    if (_eventsReady) {
-        error = _events[_currentEventQueueIndexFirst].run();
+ErrorType EventQueue::runEvents(const LoopMode loopMode, Count &eventsRun) {
+    Event event;
+    Idle idle;
+    Count handlersRun = 0;
+    ErrorType error = ErrorType::Success;
+    eventsRun = 0;
+    bool taken = takeNextEvent(event, idle);
 
-        //https://youtu.be/ZQFzMfHIxng?t=3888
-        _eventsClaimed.fetch_sub(1, std::memory_order_relaxed);
+    if (LoopMode::Descriptors == loopMode) {
+        //Checked even when there are events to run so that a busy queue can't starve the descriptors.
+        error = waitForDescriptors(taken ? nullptr : &idle, handlersRun);
+        if (!taken && !(taken = takeNextEvent(event, idle))) {
+            wakeBlockedProducers();
+            eventsRun = handlersRun;
+            return error;
+        }
+    }
+
+    while (!taken) {
+        //Timed events moved onto the timer heap may have made room.
+        wakeBlockedProducers();
+
+        if (LoopMode::Polling == loopMode) {
+            //An event added while the wake descriptor was still signalled didn't signal it again so look once more.
+            if (!clearWakeDescriptor() || !eventsArrived(idle)) {
+                return ErrorType::NoData;
+            }
+        }
+        else {
+            const ErrorType waitError = waitForEvents(idle);
+            //Blocking leaves the event that woke us up for the next call. Draining keeps waiting if it was only a timed event being added.
+            if (LoopMode::Blocking == loopMode || ErrorType::Success != waitError) {
+                return waitError;
+            }
+        }
 
-        //_currentEventQueueIndexFirst is not atomic since it is not needed to insert anything into the queue. There is a chance that addEvent() could be trying
-        //to add to the queue while runNextEvent() is attempting to decrement the amount of events queued. addEvent() would see the queue as full and fail with LimitReached,
-        //missing the update by microseconds.
-        _currentEventQueueIndexFirst = (_currentEventQueueIndexFirst + 1) % _events.max_size();
+        taken = takeNextEvent(event, idle);
+    }
 
-        //There is no race condition between us and addEvent() because _currentEventQueueIndexLast will have already had it's value updated by the time
-        //addEvent() is trying to update _eventsReady. We can either keep _eventsReady set to true, or set it to false and disable ourselves from running
-        //attempting to run more events.
-        _eventsReady = _currentEventQueueIndexFirst != _currentEventQueueIndexLast.load();
+    if (LoopMode::Polling == loopMode || LoopMode::Blocking == loopMode) {
+        eventsRun = 1;
+        error = runEvent(event);
+        wakeBlockedProducers();
+        return error;
     }
-    else if (loopMode == LoopMode::Blocking) {
-        error = waitForEvents();
+
+    //Without a clock only the event budget applies.
+    Nanoseconds deadline = 0;
+    if (0 != _drainTimeBudget && ErrorType::Success == OperatingSystem::Instance().monotonicTime(deadline)) {
+        deadline += _drainTimeBudget * 1000;
     }
 
+    do {
+        const ErrorType eventError = runEvent(event);
+        if (ErrorType::Success != eventError) {
+            error = eventError;
+        }
+        eventsRun++;
+
+        if (0 != _drainMaxEvents && eventsRun >= _drainMaxEvents) {
+            break;
+        }
+        if (0 != deadline) {
+            Nanoseconds now = 0;
+            if (ErrorType::Success != OperatingSystem::Instance().monotonicTime(now) || now >= deadline) {
+                break;
+            }
+        }
+    } while (takeNextEvent(event, idle));
+
+    wakeBlockedProducers();
+    eventsRun += handlersRun;
+
     return error;
 }
 
-bool EventQueue::addEventIfNotFull() {
-    //The only other thing that can happen to _eventsClaimed in the time after we load it is that it could be decremented by runNextEvent() so if we pass
-    //this guard we will not overflow the queue.
-    const Count eventsClaimed = _eventsClaimed.load();
-    if (eventsClaimed < _events.max_size()) {
-        _eventsClaimed.fetch_add(1, std::memory_order_relaxed);
+ErrorType EventQueue::watchDescriptor(const int descriptor, const uint32_t events, DescriptorHandler handler) {
+#ifdef __linux__
+    if (descriptor < 0 || !handler) {
+        return ErrorType::InvalidParameter;
+    }
+
+    ErrorType error = openPollDescriptor();
+    if (ErrorType::Success != error) {
+        return error;
+    }
+
+    auto watch = std::find_if(_watches.begin(), _watches.end(), [descriptor](const Watch &watch) { return descriptor == watch.descriptor; });
+    int operation = EPOLL_CTL_MOD;
+    if (_watches.end() == watch) {
+        watch = std::find_if(_watches.begin(), _watches.end(), [](const Watch &watch) { return -1 == watch.descriptor; });
+        operation = EPOLL_CTL_ADD;
+        if (_watches.end() == watch) {
+            return ErrorType::LimitReached;
+        }
+    }
+
+    epoll_event interest = {};
+    interest.events = events;
+    //The descriptor goes along with the index so that a handler that reuses the entry of one it unwatched isn't run for the old one.
+    interest.data.u64 = static_cast<uint64_t>(descriptor) << 32 | static_cast<uint64_t>(watch - _watches.begin());
+    if (-1 == epoll_ctl(_pollDescriptor, operation, descriptor, &interest)) {
+        return fromPlatformError(errno);
+    }
+
+    watch->descriptor = descriptor;
+    watch->handler = std::move(handler);
+
+    return ErrorType::Success;
+#else
+    return ErrorType::NotImplemented;
+#endif
+}
+
+ErrorType EventQueue::unwatchDescriptor(const int descriptor) {
+#ifdef __linux__
+    auto watch = std::find_if(_watches.begin(), _watches.end(), [descriptor](const Watch &watch) { return descriptor == watch.descriptor; });
+    if (_watches.end() == watch) {
+        return ErrorType::FileNotFound;
+    }
+
+    //Fails if the descriptor was already closed, which removed it from the epoll instance anyway.
+    epoll_ctl(_pollDescriptor, EPOLL_CTL_DEL, descriptor, nullptr);
+    watch->descriptor = -1;
+    watch->handler = nullptr;
+
+    return ErrorType::Success;
+#else
+    return ErrorType::NotImplemented;
+#endif
+}
+
+ErrorType EventQueue::wakeDescriptor(int &descriptor) const {
+#ifdef __linux__
+    if (-1 == _wakeDescriptor) {
+        return ErrorType::NotAvailable;
+    }
+
+    descriptor = _wakeDescriptor;
+    return ErrorType::Success;
+#else
+    return ErrorType::NotImplemented;
+#endif
+}
+
+void EventQueue::signalWakeDescriptor() {
+#ifdef __linux__
+    //Only the first event added since the queue went quiet pays for the system call.
+    if (-1 != _wakeDescriptor && !_wakeSignalled.load() && !_wakeSignalled.exchange(true)) {
+        const uint64_t one = 1;
+        [[maybe_unused]] const ssize_t written = write(_wakeDescriptor, &one, sizeof(one));
+    }
+#endif
+}
+
+bool EventQueue::clearWakeDescriptor() {
+    if (!_wakeSignalled.load()) {
+        return false;
+    }
+
+#ifdef __linux__
+    uint64_t count;
+    [[maybe_unused]] const ssize_t bytesRead = read(_wakeDescriptor, &count, sizeof(count));
+#endif
+    //Sequentially consistent so that it can't be reordered with looking for events afterwards.
+    _wakeSignalled.store(false);
+
+    return true;
+}
+
+ErrorType EventQueue::openPollDescriptor() {
+#ifdef __linux__
+    if (-1 != _pollDescriptor) {
+        return ErrorType::Success;
+    }
+    if (-1 == _wakeDescriptor) {
+        return ErrorType::NotAvailable;
+    }
+
+    const int pollDescriptor = epoll_create1(EPOLL_CLOEXEC);
+    if (-1 == pollDescriptor) {
+        return fromPlatformError(errno);
+    }
+
+    epoll_event interest = {};
+    interest.events = EPOLLIN;
+    interest.data.u64 = _MaxWatchedDescriptors;
+    if (-1 == epoll_ctl(pollDescriptor, EPOLL_CTL_ADD, _wakeDescriptor, &interest)) {
+        const ErrorType error = fromPlatformError(errno);
+        close(pollDescriptor);
+        return error;
+    }
+
+    _pollDescriptor = pollDescriptor;
+    return ErrorType::Success;
+#else
+    return ErrorType::NotImplemented;
+#endif
+}
+
+ErrorType EventQueue::waitForDescriptors(const Idle *idle, Count &handlersRun) {
+    handlersRun = 0;
+
+#ifdef __linux__
+    ErrorType error = openPollDescriptor();
+    if (ErrorType::Success != error) {
+        return error;
+    }
+
+    int timeout = 0;
+    if (nullptr != idle) {
+        clearWakeDescriptor();
+        //Either we see the event that was just added or the thread adding it sees the wake descriptor quiet and signals it.
+        if (!eventsArrived(*idle)) {
+            timeout = -1;
+
+            if (0 != idle->wakeAt) {
+                Nanoseconds now = 0;
+                if (ErrorType::Success != (error = OperatingSystem::Instance().monotonicTime(now))) {
+                    return error;
+                }
+                //Rounded up so that the next timed event is due when we wake up.
+                const Nanoseconds milliseconds = idle->wakeAt > now ? (idle->wakeAt - now + 999999) / 1000000 : 0;
+                timeout = static_cast<int>(std::min<Nanoseconds>(milliseconds, std::numeric_limits<int>::max()));
+            }
+        }
+    }
+
+    std::array<epoll_event, _MaxWatchedDescriptors + 1> ready;
+    const int readyCount = epoll_wait(_pollDescriptor, ready.data(), ready.size(), timeout);
+    if (-1 == readyCount) {
+        //Interrupted by a signal. The caller comes back around to wait again.
+        return EINTR == errno ? ErrorType::Success : fromPlatformError(errno);
+    }
+
+    for (int i = 0; i < readyCount; i++) {
+        //The wake descriptor is left signalled until there is nothing left to take.
+        const Count index = static_cast<uint32_t>(ready[i].data.u64);
+        const int descriptor = static_cast<int>(ready[i].data.u64 >> 32);
+
+        //An earlier handler may have unwatched it.
+        if (index < _MaxWatchedDescriptors && descriptor == _watches[index].descriptor) {
+            const ErrorType handlerError = _watches[index].handler(descriptor, ready[i].events);
+            if (ErrorType::Success != handlerError) {
+                error = handlerError;
+            }
+            handlersRun++;
+        }
+    }
+
+    return error;
+#else
+    return ErrorType::NotImplemented;
+#endif
+}
+
+ErrorType EventQueue::runEvent(Event &event) {
+    const Id affinity = event._affinityKey;
+    const ErrorType error = event.run();
+
+    if (0 != affinity && _multipleConsumers.load(std::memory_order_relaxed)) {
+        OperatingSystem::Instance().lockMutex(_consumerMutex, std::numeric_limits<Milliseconds>::max());
+        std::replace(_runningAffinities.begin(), _runningAffinities.end(), affinity, Id(0));
+        const bool affinityWaiting = std::exchange(_affinityWaiting, false);
+        if (affinityWaiting) {
+            _consumerChanges.fetch_add(1);
+        }
+        OperatingSystem::Instance().unlockMutex(_consumerMutex);
+
+        //The events that were passed over can run now.
+        if (affinityWaiting) {
+            wakeWaitingThreads();
+        }
+    }
+
+    return error;
+}
+
+bool EventQueue::takeNextEvent(Event &event, Idle &idle) {
+    if (!_multipleConsumers.load(std::memory_order_acquire)) {
+        return nextEvent(event, idle, false);
+    }
+
+    OperatingSystem::Instance().lockMutex(_consumerMutex, std::numeric_limits<Milliseconds>::max());
+    const bool taken = nextEvent(event, idle, true);
+    OperatingSystem::Instance().unlockMutex(_consumerMutex);
+
+    return taken;
+}
+
+bool EventQueue::nextEvent(Event &event, Idle &idle, const bool multipleConsumers) {
+    std::array<bool, PriorityLanes> ready;
+    Count chosen = PriorityLanes;
+
+    //Waited behind a full lane already.
+    if (takeResumption(event)) {
+        return true;
+    }
+
+    //Every lane is looked at so that timed events get onto the timer heap as soon as they are added.
+    for (Count i = PriorityLanes; i-- > 0;) {
+        ready[i] = collectEvents(_lanes[i]);
+        if (ready[i] && PriorityLanes == chosen) {
+            chosen = i;
+        }
+    }
+
+    idle.changes = _consumerChanges.load(std::memory_order_relaxed);
+    if (takeDueTimedEvent(event, idle.wakeAt)) {
+        return true;
+    }
+
+    if (PriorityLanes == chosen) {
+        return false;
+    }
+
+    //Give a lower lane a turn if it has been waiting too long so that a busy higher lane can't starve it.
+    for (Count i = chosen; i-- > 0;) {
+        if (ready[i] && ++_lanes[i].passedOver >= _StarvationLimit) {
+            chosen = i;
+            break;
+        }
+    }
+
+    _lanes[chosen].passedOver = 0;
+    if (takeFromLane(_lanes[chosen], event, multipleConsumers)) {
+        return true;
+    }
+
+    //Every event in the lane is waiting for its affinity key so try the others.
+    for (Count i = PriorityLanes; i-- > 0;) {
+        if (i != chosen && ready[i] && takeFromLane(_lanes[i], event, multipleConsumers)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool EventQueue::takeFromLane(Lane &lane, Event &event, const bool multipleConsumers) {
+    const Count pending = lane.pending.load(std::memory_order_relaxed);
+    Count next = 0;
+
+    if (multipleConsumers && affinityRunning(lane.heap[0].affinity)) {
+        //Look past the top of the heap for the event that would run soonest out of those that can.
+        next = pending;
+        for (Count i = 1; i < pending; i++) {
+            if (!affinityRunning(lane.heap[i].affinity) && (pending == next || runsLater(lane.heap[next], lane.heap[i]))) {
+                next = i;
+            }
+        }
+
+        _affinityWaiting = true;
+        if (pending == next) {
+            return false;
+        }
+    }
+
+    Pending taken;
+    if (0 == next) {
+        std::pop_heap(lane.heap.begin(), lane.heap.begin() + pending, runsLater);
+        taken = lane.heap[pending - 1];
+    }
+    else {
+        taken = lane.heap[next];
+        lane.heap[next] = lane.heap[pending - 1];
+        std::make_heap(lane.heap.begin(), lane.heap.begin() + pending - 1, runsLater);
+    }
+    const Count position = taken.position;
+
+    //Take the event out and free the slot before running it so that producers aren't held up by long events.
+    Slot &slot = lane.events[position & (_MaxEvents - 1)];
+    //A producer may be replacing the event. It only holds the slot long enough to move it.
+    while (slot.busy.exchange(true, std::memory_order_acquire)) {}
+    if (slot.order.load(std::memory_order_relaxed) != taken.order) {
+        //Dropped for a newer event since the heap was sorted. The newer one goes back on the heap to wait its turn.
+        lane.heap[pending - 1] = pendingOf(slot, position);
+        slot.busy.store(false, std::memory_order_release);
+        std::push_heap(lane.heap.begin(), lane.heap.begin() + pending, runsLater);
+        return takeFromLane(lane, event, multipleConsumers);
+    }
+    lane.pending.store(pending - 1, std::memory_order_relaxed);
+
+    if (multipleConsumers && 0 != taken.affinity) {
+        *std::find(_runningAffinities.begin(), _runningAffinities.end(), Id(0)) = taken.affinity;
+    }
+
+    event = std::move(slot.event);
+    slot.sequence.store(position + _MaxEvents, std::memory_order_release);
+    slot.busy.store(false, std::memory_order_release);
+
+    return true;
+}
+
+bool EventQueue::takeDueTimedEvent(Event &event, Nanoseconds &wakeAt) {
+    wakeAt = 0;
+    if (0 == _timerCount) {
+        return false;
+    }
+
+    //Never run early, even when the time can't be told.
+    Nanoseconds now = 0;
+    if (ErrorType::Success != OperatingSystem::Instance().monotonicTime(now) || _timers[0].time > now) {
+        wakeAt = _timers[0].time;
+        return false;
+    }
+
+    const bool multipleConsumers = _multipleConsumers.load(std::memory_order_relaxed);
+    const Id affinity = _timedEvents[_timers[0].index]._affinityKey;
+    if (multipleConsumers && affinityRunning(affinity)) {
+        //Left on top of the heap until the event holding the key is done.
+        _affinityWaiting = true;
+        return false;
+    }
+
+    std::pop_heap(_timers.begin(), _timers.begin() + _timerCount, firesLater);
+    const Count index = _timers[--_timerCount].index;
+    //Held the same way as an event taken from a lane so that events added later with the key wait for this one.
+    if (multipleConsumers && 0 != affinity) {
+        *std::find(_runningAffinities.begin(), _runningAffinities.end(), Id(0)) = affinity;
+    }
+    event = std::move(_timedEvents[index]);
+    event._runAt = 0;
+    _freeTimedEvents[_freeTimedEventCount++] = index;
+    _timedEventsReserved.fetch_sub(1, std::memory_order_relaxed);
+
+    return true;
+}
+
+bool EventQueue::affinityRunning(const Id key) const {
+    if (0 == key) {
+        return false;
+    }
+
+    //With nowhere to keep the key it has to wait for a running event to finish.
+    return _runningAffinities.end() != std::find(_runningAffinities.begin(), _runningAffinities.end(), key) ||
+           _runningAffinities.end() == std::find(_runningAffinities.begin(), _runningAffinities.end(), Id(0));
+}
+
+bool EventQueue::firesLater(const Timer &a, const Timer &b) {
+    if (a.time != b.time) {
+        return a.time > b.time;
+    }
+
+    return static_cast<int32_t>(a.order - b.order) > 0;
+}
+
+EventQueue::Pending EventQueue::pendingOf(const Slot &slot, const Count position) {
+    const Nanoseconds deadline = slot.event.deadline();
+    return {0 == deadline ? std::numeric_limits<Nanoseconds>::max() : deadline, position, slot.order.load(std::memory_order_relaxed), slot.event._affinityKey};
+}
+
+bool EventQueue::runsLater(const Pending &a, const Pending &b) {
+    if (a.deadline != b.deadline) {
+        return a.deadline > b.deadline;
+    }
+
+    //Signed so that the comparison still works once the positions wrap around.
+    if (a.order != b.order) {
+        return static_cast<int32_t>(a.order - b.order) > 0;
+    }
+
+    //An event added in place of a dropped one shares its order with the next event to find room, which was added after it.
+    return static_cast<int32_t>(a.position - b.position) > 0;
+}
+
+bool EventQueue::collectEvents(Lane &lane) {
+    Count position = lane.scanPosition.load(std::memory_order_relaxed);
+    Count pending = lane.pending.load(std::memory_order_relaxed);
+    Nanoseconds now = 0;
+
+    if (lane.reordered.exchange(false, std::memory_order_acquire)) {
+        for (Count i = 0; i < pending; i++) {
+            Slot &slot = lane.events[lane.heap[i].position & (_MaxEvents - 1)];
+            while (slot.busy.exchange(true, std::memory_order_acquire)) {}
+            lane.heap[i] = pendingOf(slot, lane.heap[i].position);
+            slot.busy.store(false, std::memory_order_release);
+        }
+        std::make_heap(lane.heap.begin(), lane.heap.begin() + pending, runsLater);
+    }
+
+    while (true) {
+        Slot &slot = lane.events[position & (_MaxEvents - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != position + 1) {
+            break;
+        }
+
+        //A producer may be dropping the event for a newer one.
+        while (slot.busy.exchange(true, std::memory_order_acquire)) {}
+        if (0 != slot.event._runAt) {
+            //Left at 0 if the time can't be told so that the event waits on the timer heap rather than running early.
+            if (0 == now && ErrorType::Success != OperatingSystem::Instance().monotonicTime(now)) {
+                now = 0;
+            }
+
+            if (slot.event._runAt > now) {
+                //There is always a free index because room was reserved when the event was added.
+                const Count index = _freeTimedEvents[--_freeTimedEventCount];
+                _timers[_timerCount++] = {slot.event._runAt, _timerOrder++, index};
+                std::push_heap(_timers.begin(), _timers.begin() + _timerCount, firesLater);
+                _timedEvents[index] = std::move(slot.event);
+                slot.sequence.store(position + _MaxEvents, std::memory_order_release);
+                slot.busy.store(false, std::memory_order_release);
+                position++;
+                continue;
+            }
+
+            //Already due so it runs like any other event.
+            slot.event._runAt = 0;
+            _timedEventsReserved.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        lane.heap[pending] = pendingOf(slot, position);
+        slot.busy.store(false, std::memory_order_release);
+        pending++;
+        std::push_heap(lane.heap.begin(), lane.heap.begin() + pending, runsLater);
+        position++;
+    }
+
+    if (_multipleConsumers.load(std::memory_order_relaxed) && position != lane.scanPosition.load(std::memory_order_relaxed)) {
+        //Before the scan position moves so that a worker who sees it move also sees this. See workAvailable.
+        _consumerChanges.fetch_add(1);
+        lane.scanPosition.store(position, std::memory_order_release);
+    }
+    else {
+        lane.scanPosition.store(position, std::memory_order_relaxed);
+    }
+    lane.pending.store(pending, std::memory_order_relaxed);
+
+    return pending > 0;
+}
+
+bool EventQueue::eventsReady() const {
+    if (nullptr != _resumptions.load()) {
         return true;
     }
 
+    for (const auto &lane : _lanes) {
+        const Count scanPosition = lane.scanPosition.load(std::memory_order_relaxed);
+
+        if (lane.pending.load(std::memory_order_relaxed) > 0 || lane.events[scanPosition & (_MaxEvents - 1)].sequence.load() == scanPosition + 1) {
+            return true;
+        }
+    }
+
     return false;
 }
+
+EventQueue::Status EventQueue::queueStatus() const {
+    Status status;
+
+    for (Count i = 0; i < PriorityLanes; i++) {
+        const Lane &lane = _lanes[i];
+        //The scan position is loaded first so that it can't be ahead of the enqueue position. Includes events whose position has been
+        //claimed but that haven't been published yet.
+        const Count pending = lane.pending.load(std::memory_order_relaxed);
+        const Count scanPosition = lane.scanPosition.load(std::memory_order_relaxed);
+        status.laneDepth[i] = lane.enqueuePosition.load(std::memory_order_relaxed) - scanPosition + pending;
+    }
+    status.timedEvents = _timedEventsReserved.load(std::memory_order_relaxed);
+    status.eventsDropped = _eventsDropped.load(std::memory_order_relaxed);
+    status.eventsCoalesced = _eventsCoalesced.load(std::memory_order_relaxed);
+
+    return status;
+}
+
+ErrorType EventQueue::Completion::waitUntil(const Nanoseconds deadline) {
+    if (ready()) {
+        return ErrorType::Success;
+    }
+
+    Id thread = OperatingSystemTypes::NullId;
+    if (ErrorType::Success != OperatingSystem::Instance().currentThreadId(thread)) {
+        return ErrorType::PrerequisitesNotMet;
+    }
+
+    Id expected = OperatingSystemTypes::NullId;
+    if (!_state.compare_exchange_strong(expected, thread, std::memory_order_acquire)) {
+        return Ready == expected ? ErrorType::Success : ErrorType::PrerequisitesNotMet;
+    }
+
+    while (true) {
+        const ErrorType error = 0 == deadline ? OperatingSystem::Instance().block() : OperatingSystem::Instance().blockUntil(deadline);
+
+        //Being unblocked doesn't mean it was by the operation. Someone else may have unblocked us or it could be left over from earlier.
+        if (ready()) {
+            return ErrorType::Success;
+        }
+
+        if (ErrorType::Success != error && ErrorType::LimitReached != error) {
+            expected = thread;
+            //If this fails the operation finished as we were giving up so it still counts.
+            if (_state.compare_exchange_strong(expected, OperatingSystemTypes::NullId, std::memory_order_acquire)) {
+                return error;
+            }
+
+            return ErrorType::Success;
+        }
+    }
+}
+
+ErrorType EventQueue::Completion::waitFor(const Microseconds timeout) {
+    Nanoseconds now = 0;
+    const ErrorType error = OperatingSystem::Instance().monotonicTime(now);
+    if (ErrorType::Success != error) {
+        return error;
+    }
+
+    return waitUntil(now + timeout * 1000);
+}
+
+void EventQueue::Completion::complete() {
+    //Nothing that belongs to this completion can be touched after the exchange.
+    const Id waitingThread = _state.exchange(Ready, std::memory_order_acq_rel);
+
+    if (OperatingSystemTypes::NullId != waitingThread) {
+        OperatingSystem::Instance().unblock(waitingThread);
+    }
+}
+
+ErrorType EventQueue::start(Task task, Future<> *done) {
+    if (!task) {
+        return ErrorType::NoMemory;
+    }
+
+    const std::coroutine_handle<Task::promise_type> coroutine = std::exchange(task._coroutine, nullptr);
+    coroutine.promise()._queue = this;
+    if (nullptr != done) {
+        coroutine.promise()._done = done->promise();
+    }
+
+    Event event([coroutine]() -> ErrorType {
+        coroutine.resume();
+        return ErrorType::Success;
+    });
+
+    const ErrorType error = addPinnedEvent(event);
+    if (ErrorType::Success != error) {
+        coroutine.destroy();
+    }
+
+    return error;
+}
+
+EventQueue::Schedule EventQueue::schedule(const Priority priority) {
+    return Schedule(*this, priority);
+}
+
+ErrorType EventQueue::startWorkers(const Count workers, const Bytes stackSize, const OperatingSystemTypes::Priority priority) {
+    if (0 != _workerCount) {
+        return ErrorType::InvalidParameter;
+    }
+
+    Count workersToCreate = workers;
+    if (0 == workersToCreate) {
+        const ErrorType error = OperatingSystem::Instance().onlineCores(workersToCreate);
+        if (ErrorType::Success != error) {
+            return error;
+        }
+    }
+
+    if (workersToCreate > APP_MAX_EVENT_WORKERS) {
+        return ErrorType::LimitReached;
+    }
+
+    //Inheritance keeps a low priority worker taking an event from holding up a high priority one.
+    ErrorType error = OperatingSystem::Instance().createMutex(_consumerMutex, true);
+    if (ErrorType::Success != error) {
+        return error;
+    }
+
+    _workerGroup = WorkerGroupsCreated.fetch_add(1, std::memory_order_relaxed);
+    _stopWorkers.store(false);
+    _multipleConsumers.store(true);
+
+    for (Count i = 0; i < workersToCreate; i++) {
+        std::array<char, OperatingSystemTypes::MaxThreadNameLength> name = {};
+        snprintf(name.data(), name.size(), "events%u.%u", static_cast<uint8_t>(_workerGroup), static_cast<uint8_t>(i));
+
+        Id thread;
+        if (ErrorType::Success != (error = OperatingSystem::Instance().createThread(priority, name, this, stackSize, EventQueueWorker, thread))) {
+            _workerCount = i;
+            stopWorkers();
+            return error;
+        }
+    }
+    _workerCount = workersToCreate;
+
+    return ErrorType::Success;
+}
+
+ErrorType EventQueue::stopWorkers() {
+    ErrorType error = ErrorType::Success;
+
+    if (!_multipleConsumers.load()) {
+        return error;
+    }
+
+    _stopWorkers.store(true);
+    _consumerChanges.fetch_add(1);
+    wakeWaitingThreads();
+
+    for (Count i = 0; i < _workerCount; i++) {
+        std::array<char, OperatingSystemTypes::MaxThreadNameLength> name = {};
+        snprintf(name.data(), name.size(), "events%u.%u", static_cast<uint8_t>(_workerGroup), static_cast<uint8_t>(i));
+
+        const ErrorType joinError = OperatingSystem::Instance().joinThread(name);
+        if (ErrorType::Success != joinError) {
+            error = joinError;
+        }
+    }
+
+    _workerCount = 0;
+    _multipleConsumers.store(false);
+    OperatingSystem::Instance().deleteMutex(_consumerMutex);
+    _consumerMutex = 0;
+
+    return error;
+}
+
+void EventQueue::workerLoop() {
+    CurrentWorkerQueue = this;
+
+    Count eventsRun;
+    while (!_stopWorkers.load(std::memory_order_acquire)) {
+        runEvents(LoopMode::Blocking, eventsRun);
+    }
+
+    CurrentWorkerQueue = nullptr;
+}
+
+bool EventQueue::currentThreadIsOwner() const {
+    Id thread = OperatingSystemTypes::NullId;
+    return ErrorType::Success == OperatingSystem::Instance().currentThreadId(thread) && thread == _ownerThreadId;
+}
+
+void EventQueue::resume(EventQueue *queue, std::coroutine_handle<> coroutine, Resumption &resumption) {
+    if (nullptr == queue || !queue->hasConsumer()) {
+        coroutine.resume();
+        return;
+    }
+
+    Event event([coroutine]() -> ErrorType {
+        coroutine.resume();
+        return ErrorType::Success;
+    });
+
+    //High so that work that is finishing gets ahead of new work.
+    if (ErrorType::Success == queue->enqueue(event, Priority::High)) {
+        return;
+    }
+
+    //Waiting for room could deadlock if the thread running the other queue is the one we'd be waiting on.
+    resumption.coroutine = coroutine;
+    Resumption *next = queue->_resumptions.load(std::memory_order_relaxed);
+    do {
+        resumption.next = next;
+    } while (!queue->_resumptions.compare_exchange_weak(next, &resumption));
+
+    queue->wakeWaitingThreads();
+}
+
+bool EventQueue::takeResumption(Event &event) {
+    //Only ever popped by one thread at a time so the head can't be popped and pushed again under us.
+    Resumption *resumption = _resumptions.load(std::memory_order_acquire);
+    while (nullptr != resumption && !_resumptions.compare_exchange_weak(resumption, resumption->next, std::memory_order_acquire)) {}
+
+    if (nullptr == resumption) {
+        return false;
+    }
+
+    event = Event([coroutine = resumption->coroutine]() -> ErrorType {
+        coroutine.resume();
+        return ErrorType::Success;
+    });
+
+    return true;
+}
+
+bool EventQueue::Schedule::await_suspend(std::coroutine_handle<Task::promise_type> coroutine) noexcept {
+    if (!_queue.hasConsumer()) {
+        _error = ErrorType::PrerequisitesNotMet;
+        return false;
+    }
+
+    EventQueue *const previous = coroutine.promise().queue();
+    coroutine.promise().setQueue(&_queue);
+
+    Event event([coroutine]() -> ErrorType {
+        coroutine.resume();
+        return ErrorType::Success;
+    });
+
+    //Nothing that belongs to the awaitable can be touched once the event is added since the coroutine may already be running again.
+    const ErrorType error = _queue.enqueue(event, _priority);
+    if (ErrorType::Success != error) {
+        coroutine.promise().setQueue(previous);
+        _error = error;
+        return false;
+    }
+
+    return true;
+}
+
+void *EventQueue::Task::promise_type::operator new(const size_t size) noexcept {
+    if (size > APP_COROUTINE_FRAME_SIZE) {
+        return nullptr;
+    }
+
+    return framePool().allocate();
+}
+
+void EventQueue::Task::promise_type::operator delete(void *frame) noexcept {
+    framePool().deallocate(frame);
+}
+
+Count EventQueue::Task::framesAvailable() {
+    return framePool().available();
+}
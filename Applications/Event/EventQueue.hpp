@@ -13,10 +13,14 @@
 #include "Error.hpp"
 #include "Types.hpp"
 #include "OperatingSystemTypes.hpp"
+#include "InlineFunction.hpp"
 //C++
 #include <array>
 #include <functional>
 #include <atomic>
+#include <bit>
+#include <coroutine>
+#include <limits>
 
 #ifndef APP_MAX_NUMBER_OF_THREADS
 #error APP_MAX_NUMBER_OF_THREADS must be defined so that the list of waiting threads is properly sized.
@@ -26,9 +30,36 @@
 #error APP_MAX_QUEUEABLE_EVENTS must be defined so to determine the maximum number of events that can be queued simultaneously.
 #endif
 
+#ifndef APP_EVENT_CAPTURE_SIZE
+///@brief The most bytes an event callback can capture. Every slot in the queue reserves this much so keep it as small as your events allow.
+#define APP_EVENT_CAPTURE_SIZE (12 * sizeof(void *))
+#endif
+
+#ifndef APP_MAX_EVENT_WORKERS
+///@brief The most worker threads that can run the events of one queue at once.
+#define APP_MAX_EVENT_WORKERS 8
+#endif
+
+#ifndef APP_MAX_WATCHED_DESCRIPTORS
+///@brief The most file descriptors that LoopMode::Descriptors can wait on for one queue, not counting the wake descriptor.
+#define APP_MAX_WATCHED_DESCRIPTORS 8
+#endif
+
+#ifndef APP_EVENT_PRIORITY_LANES
+///@brief The number of priority lanes, from 1 to 3. Each lane holds APP_MAX_QUEUEABLE_EVENTS so every extra lane is another full queue.
+#define APP_EVENT_PRIORITY_LANES 1
+#endif
+
+#ifndef APP_MAX_TIMED_EVENTS
+///@brief The most events added with addEventAt or addEventAfter that can be waiting for their time at once. 0 disables timed events.
+#define APP_MAX_TIMED_EVENTS 0
+#endif
+
 /**
  * @class EventQueue
- * @details Queue is FIFO
+ * @details Events are run highest priority first. Within a priority, events with a deadline run earliest deadline first, ahead of events
+ *          without one, which run in FIFO order. Any number of threads can add events while a single thread runs them, or a group of worker
+ *          threads when startWorkers is used. Adding an event never takes a lock.
  * @brief Provides an interface for synchronizing calls to base classes.
  * @post The current thread on which the event queue is created is the onwer thread.
  *       When subsequent events are called from this thread, the event queue will call them immediately
@@ -41,12 +72,14 @@ class EventQueue {
     
     public:
     EventQueue();
+    /// @brief Destructor. Closes the wake descriptor and the epoll instance.
+    virtual ~EventQueue();
 
     /// @brief Tag for logging.
     static constexpr char TAG[] = "EventQueue";
 
-    /// @brief The list of threads waiting for commands to be added.
-    using WaitingThreads = std::array<Id, APP_MAX_NUMBER_OF_THREADS>;
+    /// @brief The list of threads waiting for events to be added.
+    using WaitingThreads = std::array<std::atomic<Id>, APP_MAX_NUMBER_OF_THREADS>;
     /**
      * @enum LoopMode
      * @brief The mode in which the event queue runs.
@@ -54,7 +87,61 @@ class EventQueue {
     enum class LoopMode : uint8_t {
         Unknown = 0, ///< Unknown mode
         Polling = 1, ///< The event queue polls for events and runs them if they are ready.
-        Blocking = 2 ///< The event queue blocks until an event is added and then runs it.
+        Blocking = 2, ///< The event queue blocks until an event is added and then runs it.
+        Drain = 3,    ///< The event queue blocks until an event is added and then runs events until the queue is empty or the drain budget is spent.
+        Descriptors = 4 ///< Like Drain, but also wakes up when a watched file descriptor is ready and runs its handler first. Linux only.
+    };
+
+    /**
+     * @enum Priority
+     * @brief Which lane of the queue an event waits in.
+     * @details When there are fewer than three lanes the lowest priorities share the bottom lane.
+     * @sa laneOf
+     */
+    enum class Priority : uint8_t {
+        Low = 0,    ///< Bulk work that can wait behind everything else.
+        Normal = 1, ///< Default for events added without a priority.
+        High = 2    ///< Latency critical work.
+    };
+    /**
+     * @brief Called by LoopMode::Descriptors when a watched file descriptor is ready.
+     * @details Given the descriptor and the epoll events it is ready for. Runs on the thread running the events.
+     */
+    using DescriptorHandler = InlineFunction<ErrorType(int descriptor, uint32_t readyEvents), APP_EVENT_CAPTURE_SIZE>;
+
+    /// @brief The number of priority lanes. Each lane can hold APP_MAX_QUEUEABLE_EVENTS.
+    static constexpr Count PriorityLanes = APP_EVENT_PRIORITY_LANES;
+    static_assert(PriorityLanes >= 1 && PriorityLanes <= 3, "APP_EVENT_PRIORITY_LANES must be 1, 2 or 3.");
+
+    /**
+     * @brief The lane that events of a priority wait in.
+     * @details With two lanes High keeps a lane to itself and the other priorities share the bottom one. With one lane every priority shares it.
+     */
+    static constexpr uint8_t laneOf(const Priority priority) {
+        constexpr uint8_t shared = 3 - PriorityLanes;
+        return static_cast<uint8_t>(priority) > shared ? static_cast<uint8_t>(priority) - shared : 0;
+    }
+
+    /**
+     * @enum OverflowPolicy
+     * @brief What addEvent does when the lane is full.
+     */
+    enum class OverflowPolicy : uint8_t {
+        Reject = 0,     ///< Return ErrorType::LimitReached. The default.
+        Block = 1,      ///< Block the caller until there is room or the overflow timeout expires.
+        DropNewest = 2, ///< Drop the event being added.
+        DropOldest = 3  ///< Drop the event that has been waiting in the lane the longest and add the new one behind the others.
+    };
+
+    /**
+     * @struct Status
+     * @brief The status of the event queue.
+     */
+    struct Status {
+        std::array<Count, PriorityLanes> laneDepth; ///< The number of events waiting in each lane, indexed by laneOf.
+        Count timedEvents;                          ///< The number of events waiting for the time they were added to run at.
+        Count eventsDropped;                        ///< The number of events dropped by the overflow policy.
+        Count eventsCoalesced;                      ///< The number of events that replaced a waiting event with the same coalescing key.
     };
 
     /**
@@ -66,7 +153,8 @@ class EventQueue {
         public:
         /**
          * @brief Constructor.
-         * @param eventCallback The function member to call.
+         * @param eventCallback Anything callable with no arguments that returns ErrorType. Stored inside the event so creating one never
+         *                      allocates. Fails to compile if it captures more than APP_EVENT_CAPTURE_SIZE bytes.
          * @post The eventCallback is not called.
          * @sa run
          * @code //Bind a function member. Can have any signature, any number of args.
@@ -77,26 +165,42 @@ class EventQueue {
          * ErrorType Class::addEventToEventQueue(uint8_t arg1, uint32_t arg2, ErrorType &arg3) {
          *     EventQueue::Event event = EventQueue::Event(std::bind(&Class::functionMember, this, arg1, arg2, arg3));
          *     return addEvent(event);
-         * 
-         *     return ErrorType::Success;
-         * }
-         * @endcode
-         * @code //Bind a lambda expression. Can have any signature, any number of args.
-         * ErrorType Class::lambdaEvent(uint8_t arg1, uint32_t arg2, ErrorType &arg3, std::shared_ptr<uint8_t> ptr) {
-         *     auto lambdaFunc = [](uint8_t arg1, uint32_t arg2, ErrorType &arg3, std::shared_ptr<uint8_t> ptr) -> ErrorType {
-         *         return ErrorType::Success;
-         *     };
-         *   
-         *   //Pass it off as a parameter to Event. Do not need to pass `this` as the first argument as we did in function members.
-         *   EventQueue::Event event = EventQueue::Event(std::bind(lambdaFunc, arg1, arg2, arg3, ptr));
-         * 
-         *   return ErrorType::Success;
          * }
          * @endcode
         */
-        Event(std::function<ErrorType()> eventCallback = nullptr) {
-            _eventCallback = eventCallback;
-        }
+        template <typename Callable>
+        requires (!std::is_same_v<std::remove_cvref_t<Callable>, Event>)
+        Event(Callable &&eventCallback) : _eventCallback(std::forward<Callable>(eventCallback)) {}
+        /// @brief Constructor. The event has no callback.
+        Event() = default;
+
+        /**
+         * @brief Run this event ahead of the events in the same lane that have a later deadline or no deadline.
+         * @param[in] deadline The absolute time in OperatingSystem::monotonicTime that the event should run by. 0 for no deadline.
+         */
+        void setDeadline(const Nanoseconds deadline) { _deadline = deadline; }
+        /// @brief The deadline of this event. 0 if it has none.
+        Nanoseconds deadline() const { return _deadline; }
+
+        /**
+         * @brief Replace an event with the same key that is still waiting in the lane instead of adding this one after it.
+         * @details For work where only the latest request matters, such as refreshing a status. The replacement keeps the place and
+         *          deadline of the event it replaces. Events added with addEventAt or addEventAfter are never coalesced.
+         * @param[in] key Identifies the work. 0 for none.
+         */
+        void setCoalescingKey(const Id key) { _coalescingKey = key; }
+        /// @brief The coalescing key of this event. 0 if it has none.
+        Id coalescingKey() const { return _coalescingKey; }
+
+        /**
+         * @brief Never run this event at the same time as, or ahead of, the events with the same key that were taken before it.
+         * @details Only matters when workers run the queue. Lets the events for each file or socket run in order while those for different
+         *          ones run in parallel.
+         * @param[in] key Identifies what the event works on. 0 for none.
+         */
+        void setAffinityKey(const Id key) { _affinityKey = key; }
+        /// @brief The affinity key of this event. 0 if it has none.
+        Id affinityKey() const { return _affinityKey; }
 
         /**
          * @brief Calls the function member with the parameters that were passed to the constructor.
@@ -118,7 +222,7 @@ class EventQueue {
          * @returns true if the eventCallback is valid
          * @returns false if the eventCallback is not valid
         */
-        bool eventCallbackValid() {
+        bool eventCallbackValid() const {
             if (_eventCallback) {
                 return true;
             }
@@ -128,22 +232,301 @@ class EventQueue {
         }
 
         private:
+        friend class EventQueue;
         /// @brief The callback function of this event.
-        std::function<ErrorType()> _eventCallback;
+        InlineFunction<ErrorType(), APP_EVENT_CAPTURE_SIZE> _eventCallback;
+        /// @brief When the event should run by. 0 for no deadline.
+        Nanoseconds _deadline = 0;
+        /// @brief When the event should run. 0 to run as soon as possible.
+        Nanoseconds _runAt = 0;
+        /// @brief Events with the same key replace each other while they wait. 0 for none.
+        Id _coalescingKey = 0;
+        /// @brief Events with the same key never run at the same time. 0 for none.
+        Id _affinityKey = 0;
+    };
+
+    /**
+     * @class Completion
+     * @brief Lets one thread wait for an operation running on another to finish.
+     * @details The untyped part of a Future. The thread waiting and whether the operation has finished are kept in the same atomic so that
+     *          finishing can never slip in between the waiter checking and blocking, and so that the thread finishing the operation never
+     *          touches the completion again once the waiter is free to return.
+     */
+    class Completion {
+
+        public:
+        /// @brief Constructor.
+        Completion() = default;
+        Completion(const Completion &) = delete;
+        Completion &operator=(const Completion &) = delete;
+
+        /// @brief True if the operation has finished.
+        bool ready() const { return Ready == _state.load(std::memory_order_acquire); }
+
+        /**
+         * @brief Block until the operation finishes.
+         * @returns ErrorType::Success when the operation has finished.
+         * @returns ErrorType::PrerequisitesNotMet if another thread is already waiting or this thread can not be blocked.
+         */
+        ErrorType wait() { return waitUntil(0); }
+
+        /**
+         * @brief Block until the operation finishes or the deadline passes.
+         * @param[in] deadline On the same clock as OperatingSystem::monotonicTime. 0 for no deadline.
+         * @returns ErrorType::Success when the operation has finished.
+         * @returns ErrorType::Timeout if the deadline passed first.
+         * @returns ErrorType::PrerequisitesNotMet if another thread is already waiting or this thread can not be blocked.
+         * @post If the wait fails, the operation may still finish later so anything it uses must be kept alive until ready is true.
+         */
+        ErrorType waitUntil(const Nanoseconds deadline);
+
+        /**
+         * @brief Block until the operation finishes or the timeout expires.
+         * @param[in] timeout How long to wait.
+         * @returns The error from OperatingSystem::monotonicTime if the time could not be read. Nothing is waited for.
+         * @sa waitUntil
+         */
+        ErrorType waitFor(const Microseconds timeout);
+
+        /**
+         * @brief Block until every operation finishes or the deadline passes.
+         * @details Lets a thread start several operations and then wait for them all instead of waiting for each before starting the next.
+         * @param[in] deadline On the same clock as OperatingSystem::monotonicTime. 0 for no deadline.
+         * @param[in] completions The operations to wait for.
+         * @returns ErrorType::Success when every operation has finished.
+         * @returns The error of the first wait that failed. The operations after it are not waited for.
+         * @code{.cpp}
+         * EventQueue::Future<> first, second;
+         * //...add the events that complete each promise...
+         * EventQueue::Completion::waitForAll(0, first, second);
+         * @endcode
+         */
+        template <typename... Completions>
+        static ErrorType waitForAll(const Nanoseconds deadline, Completions &...completions) {
+            ErrorType error = ErrorType::Success;
+            ((error = (ErrorType::Success == error ? completions.waitUntil(deadline) : error)), ...);
+            return error;
+        }
+
+        protected:
+        /**
+         * @brief Mark the operation as finished and unblock the thread waiting for it.
+         * @post This completion must not be touched again by the caller. The waiting thread may have returned and destroyed it.
+         */
+        void complete();
+        /**
+         * @brief Make the completion ready to be used for another operation.
+         * @pre The promise for the last operation has been completed or was never handed out.
+         */
+        void reset() { _state.store(OperatingSystemTypes::NullId, std::memory_order_relaxed); }
+
+        private:
+        /// @brief Stored in the state once the operation has finished. Can never be a thread id.
+        static constexpr Id Ready = std::numeric_limits<Id>::max();
+        /// @brief NullId when nobody is waiting, the id of the waiting thread, or Ready.
+        std::atomic<Id> _state = OperatingSystemTypes::NullId;
+    };
+
+    /**
+     * @class Future
+     * @brief The result of an operation that another thread finishes, such as an event.
+     * @details The result is stored inside the future so nothing is allocated. The future must outlive its promise and can't be moved.
+     * @tparam Result The type of the result.
+     * @code{.cpp}
+     * EventQueue::Future<> opened;
+     * EventQueue::Event event = EventQueue::Event([&, promise = opened.promise()]() -> ErrorType {
+     *     const ErrorType error = openTheFile();
+     *     promise.complete(error);
+     *     return error;
+     * });
+     *
+     * if (ErrorType::Success == addEvent(event) && ErrorType::Success == opened.wait()) {
+     *     return opened.result();
+     * }
+     * @endcode
+     */
+    template <typename Result = ErrorType>
+    class Future : public Completion {
+
+        public:
+        /**
+         * @class Promise
+         * @brief Handed to the operation so that it can set the result of the future.
+         */
+        class Promise {
+
+            public:
+            /**
+             * @brief Set the result and unblock the thread waiting for it.
+             * @param[in] result The result of the operation.
+             * @pre Called at most once per call to Future::promise.
+             * @post Nothing captured by reference from the waiting thread may be touched after this call since it may have already returned.
+             */
+            void complete(Result result) const {
+                _future->_result = std::move(result);
+                _future->Completion::complete();
+            }
+
+            private:
+            friend class Future;
+            /// @brief Constructor.
+            explicit Promise(Future &future) : _future(&future) {}
+            /// @brief The future to complete.
+            Future *_future;
+        };
+
+        /// @brief Constructor.
+        Future() = default;
+
+        /**
+         * @brief Get the promise that completes this future.
+         * @post Any result from a previous operation is forgotten and the future is no longer ready.
+         */
+        Promise promise() {
+            reset();
+            return Promise(*this);
+        }
+
+        /**
+         * @brief The result of the operation.
+         * @pre ready is true.
+         */
+        Result &result() { return _result; }
+        /// @copydoc result()
+        const Result &result() const { return _result; }
+
+        private:
+        /// @brief The result of the operation. Only valid once the future is ready.
+        Result _result = Result();
     };
 
     /**
      * @brief Adds an event to the to the queue.
      * @details Interrupt and thread safe.
      * @param[in] event The event to add.
-     * @returns ErrorType::Success if the event was added
-     * @returns ErrorType::LimitReached if the maximum number of events has been reached.
+     * @param[in] priority The lane to add the event to.
+     * @returns ErrorType::Success if the event was added, replaced a waiting event with the same coalescing key, or was dropped by the
+     *          overflow policy.
+     * @returns ErrorType::LimitReached if the lane is full and the overflow policy is OverflowPolicy::Reject, or if there was nothing the
+     *          policy could drop.
+     * @returns ErrorType::Timeout if the lane stayed full for the overflow timeout under OverflowPolicy::Block.
+     * @returns The error from OperatingSystem::monotonicTime if the overflow timeout could not be worked out under OverflowPolicy::Block.
      * @returns the result of the event callback if the event is being added to from the same thread in which the event queue is run.
      * @post The event is added to a FIFO queue and will be executed when it reaches the first position in the queue and this thread
      *       is running.
      * @post If the owner of the event queue is blocked when the event is added, it will become unblocked after this call.
+     * @sa setOverflowPolicy
+     * @sa Event::setCoalescingKey
     */
-    ErrorType addEvent(Event &event);
+    ErrorType addEvent(Event &event, const Priority priority = Priority::Normal);
+
+    /**
+     * @brief Choose what addEvent does when the lane is full.
+     * @details Lets a queue that gets bursts degrade gracefully instead of failing. Only applies to addEvent. Events the queue adds for itself,
+     *          such as those of coroutines and timed events, are never dropped and get ErrorType::LimitReached as under OverflowPolicy::Reject.
+     * @param[in] policy The policy.
+     * @param[in] timeout How long OverflowPolicy::Block waits for room. 0 to wait as long as it takes.
+     * @note Don't use the dropping policies on a queue that has events someone waits on, such as those that complete a Future, since a
+     *       dropped event never completes it.
+     */
+    void setOverflowPolicy(const OverflowPolicy policy, const Microseconds timeout = 0) {
+        _overflowTimeout.store(timeout, std::memory_order_relaxed);
+        _overflowPolicy.store(policy, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Adds an event to run at a time in the future.
+     * @details Interrupt and thread safe. The event is kept on a timer heap by the event queue itself so no operating system timer is needed.
+     *          When it is due it runs ahead of the events waiting in the lanes.
+     * @param[in] time When to run the event, on the same clock as OperatingSystem::monotonicTime.
+     * @param[in] event The event to add.
+     * @returns ErrorType::Success if the event was added
+     * @returns ErrorType::LimitReached if APP_MAX_TIMED_EVENTS are already waiting or the lane that carries them to the event queue is full.
+     * @returns ErrorType::PrerequisitesNotMet if the thread that runs the event queue is not known to the operating system.
+     * @returns ErrorType::NotSupported if APP_MAX_TIMED_EVENTS is 0.
+     * @post The event is never run right away, even when added from the thread that runs the event queue.
+     */
+    ErrorType addEventAt(const Nanoseconds time, Event &event);
+
+    /**
+     * @brief Adds an event to run after a delay.
+     * @param[in] delay How long from now to run the event.
+     * @param[in] event The event to add.
+     * @returns The error from OperatingSystem::monotonicTime if the time could not be read. The event is not added.
+     * @sa addEventAt
+     */
+    ErrorType addEventAfter(const Microseconds delay, Event &event);
+
+    class Task;
+    class Schedule;
+    template <typename Operation>
+    class Awaitable;
+
+    /**
+     * @brief Run a coroutine on the thread of this event queue.
+     * @details Include Coroutine.hpp to use. The task runs until its first co_await as an event of this queue, and is resumed as one after
+     *          each co_await until it finishes.
+     * @param[in] task The coroutine to run. The event queue frees its frame once it finishes.
+     * @param[out] done Completed with the value the coroutine gives to co_return. nullptr if it isn't needed.
+     * @returns ErrorType::Success if the task was started.
+     * @returns ErrorType::NoMemory if the frame of the task could not be allocated.
+     * @returns The error codes of addEvent if the task could not be started.
+     * @sa Task
+     */
+    ErrorType start(Task task, Future<> *done = nullptr);
+
+    /**
+     * @brief Move the awaiting coroutine onto the thread of this event queue.
+     * @details Include Coroutine.hpp to use. co_await the result.
+     * @param[in] priority The lane the coroutine waits in.
+     * @sa Schedule
+     */
+    Schedule schedule(const Priority priority = Priority::Normal);
+
+    /**
+     * @brief Run an operation on the thread of this event queue from a coroutine without blocking the coroutine's thread.
+     * @details Include Coroutine.hpp to use. co_await the result to get the ErrorType returned by the operation.
+     * @param[in] operation Callable with no arguments that returns ErrorType.
+     * @sa Awaitable
+     */
+    template <typename Operation>
+    Awaitable<std::decay_t<Operation>> awaitEvent(Operation &&operation);
+
+    /// @brief True if called from the thread that runs the events.
+    bool currentThreadIsOwner() const;
+
+    /**
+     * @brief Create threads that run the events of this queue alongside each other.
+     * @details Events are still taken in order of priority and deadline but run in parallel, except for those that share an affinity key.
+     *          While the workers run, addEvent only runs an event right away when it is called from one of them or from a thread unknown to
+     *          the operating system, so that blocking calls made from inside an event still work.
+     * @param[in] workers The number of threads to create. 0 creates one per online core.
+     * @param[in] stackSize The stack size of each worker.
+     * @param[in] priority The priority of each worker.
+     * @returns ErrorType::Success if the workers were created.
+     * @returns ErrorType::InvalidParameter if the workers have already been started.
+     * @returns ErrorType::LimitReached if there would be more than APP_MAX_EVENT_WORKERS.
+     * @returns Any errors returned by OperatingSystem::onlineCores, OperatingSystem::createMutex or OperatingSystem::createThread.
+     * @pre Nothing else is running the events of the queue while the workers are started.
+     * @post If a worker could not be created, any workers that were created are stopped.
+     * @sa Event::setAffinityKey
+     */
+    ErrorType startWorkers(const Count workers, const Bytes stackSize, const OperatingSystemTypes::Priority priority = OperatingSystemTypes::Priority::Normal);
+
+    /**
+     * @brief Stop and join the worker threads.
+     * @details Events still in the queue are left for whoever runs it next.
+     * @returns ErrorType::Success if the workers were stopped or were never started.
+     * @returns Any errors returned by OperatingSystem::joinThread.
+     * @pre Must be called before the queue is destroyed.
+     */
+    ErrorType stopWorkers();
+
+    /**
+     * @brief The body of each worker thread.
+     * @details Only public so that it can be called from the thread start function.
+     */
+    void workerLoop();
 
     /**
      * @brief The main loop for the eventQueue which can be used to continually check for and run events.
@@ -155,12 +538,78 @@ class EventQueue {
     */
     virtual ErrorType mainLoop(const LoopMode loopMode) { return runNextEvent(loopMode); }
 
+    /**
+     * @brief Run the events in the queue and report how many were run.
+     * @details Same as mainLoop except for the count. Must only be called by the thread that runs the event queue.
+     * @param[in] loopMode The mode in which to run the event queue. Polling and Blocking run at most one event.
+     * @param[out] eventsRun The number of events that were run, including the descriptor handlers run by LoopMode::Descriptors.
+     * @returns ErrorType::NoData if loopMode is Polling and there are no events to process.
+     * @returns ErrorType::Success if every event that was run succeeded.
+     * @returns The error code of the last event or descriptor handler that failed. The events after it are still run.
+     * @returns The error codes of waitForEvents if no events were run because the wait for them failed.
+     * @sa setDrainBudget
+     */
+    ErrorType runEvents(const LoopMode loopMode, Count &eventsRun);
+
+    /**
+     * @brief Limit how much LoopMode::Drain can run before it returns so that the thread can get to other work.
+     * @details Checked after each event so an event that runs long can overrun the time budget.
+     * @param[in] maxEvents The most events to run. 0 for no limit.
+     * @param[in] timeBudget The longest to keep running events for. 0 for no limit.
+     * @post Takes effect on the next call to mainLoop or runEvents.
+     */
+    void setDrainBudget(const Count maxEvents, const Microseconds timeBudget) {
+        _drainMaxEvents = maxEvents;
+        _drainTimeBudget = timeBudget;
+    }
+
+    /**
+     * @brief Have LoopMode::Descriptors wake up when a file descriptor is ready.
+     * @details Lets one thread sleep on its events and on socket or UART readiness at the same time. The handler is called until whatever
+     *          made the descriptor ready has been dealt with so it should read or write until it would block.
+     * @param[in] descriptor The file descriptor to wait on. Watching it again replaces the events and the handler.
+     * @param[in] events The epoll events to wait for. e.g. EPOLLIN.
+     * @param[in] handler Called with the descriptor and the events it is ready for.
+     * @returns ErrorType::Success if the descriptor is being watched.
+     * @returns ErrorType::InvalidParameter if the descriptor is negative or the handler is empty.
+     * @returns ErrorType::LimitReached if APP_MAX_WATCHED_DESCRIPTORS are already being watched.
+     * @returns ErrorType::NotImplemented if the platform has no epoll.
+     * @returns The error from epoll if it would not take the descriptor.
+     * @pre Must be called by the thread that runs the event queue, so add an event that calls it from any other thread.
+     */
+    ErrorType watchDescriptor(const int descriptor, const uint32_t events, DescriptorHandler handler);
+
+    /**
+     * @brief Stop waiting on a file descriptor.
+     * @param[in] descriptor The file descriptor given to watchDescriptor.
+     * @returns ErrorType::Success if the descriptor is no longer watched.
+     * @returns ErrorType::FileNotFound if the descriptor was not being watched.
+     * @returns ErrorType::NotImplemented if the platform has no epoll.
+     * @pre Must be called by the thread that runs the event queue. Call it before closing the descriptor.
+     */
+    ErrorType unwatchDescriptor(const int descriptor);
+
+    /**
+     * @brief Get the file descriptor that becomes readable when an event is added.
+     * @details For loops that wait on their own poll or epoll set. Once it is readable, run LoopMode::Polling until it returns
+     *          ErrorType::NoData, which also makes the descriptor quiet again. Only the first event added after that signals it so adding
+     *          events stays cheap while the queue is busy.
+     * @param[out] descriptor The wake descriptor.
+     * @returns ErrorType::Success if the descriptor was returned.
+     * @returns ErrorType::NotAvailable if it could not be created.
+     * @returns ErrorType::NotImplemented if the platform has no eventfd.
+     */
+    ErrorType wakeDescriptor(int &descriptor) const;
+
     /**
      * @brief true if there are events ready, false otherwise
      * @returns true if there are events ready
      * @returns false otherwise
      */
-    bool eventsReady() { return _eventsReady; }
+    bool eventsReady() const;
+
+    /// @brief Get the status of the event queue.
+    Status queueStatus() const;
 
     protected: 
     /**
@@ -172,6 +621,7 @@ class EventQueue {
      *       there is never a guarentee on whether the event will block or not.
      * @post If loopMode is Blocking and there are no events in the queue, the calling thread will be blocked until an event is added.
      *       If loopMode is Polling and there are no events in the queue, ErrorType::NoData is returned immediately.
+     *       If loopMode is Drain, events are run as they would be by runEvents.
      * @sa OperatingSystemAbstraction::block
     */
     ErrorType runNextEvent(const LoopMode loopMode);
@@ -184,20 +634,92 @@ class EventQueue {
     void changeOwner(const Id newOwnerThreadId) { _ownerThreadId = newOwnerThreadId; }
 
     private:
-    /// @brief The maximum number of events that can be queued.
-    static constexpr Count _MaxEvents = APP_MAX_QUEUEABLE_EVENTS;
-    /// @brief The ring buffer queue of events to run. 
-    std::array<Event, _MaxEvents> _events;
-    /// @brief The index of the next event to run.
-    Count _currentEventQueueIndexFirst = 0;
-    /// @brief The index of the last event to run.
-    std::atomic<Count> _currentEventQueueIndexLast = 0;
-    /// @brief The current number of of events claimed, but not saved to the queue.
-    std::atomic<Count> _eventsClaimed = 0;
+    /// @brief The maximum number of events that can be queued. Rounded up to a power of two so that positions can wrap around.
+    static constexpr Count _MaxEvents = std::bit_ceil(static_cast<Count>(APP_MAX_QUEUEABLE_EVENTS));
+    /// @brief Size of a cache line. Keeps the position written by producers and the one written by the consumer off the same line.
+    static constexpr Bytes _CacheLineSize = 64;
+    /// @brief How many times in a row a lane with events can be passed over for a higher one before it gets to run one.
+    static constexpr Count _StarvationLimit = 8;
+    /**
+     * @struct Slot
+     * @brief An event in the queue and the sequence number that says whose turn it is to use it.
+     * @details For the slot at position p, sequence == p means it is free for a producer, and sequence == p + 1 means it holds an event for
+     *          the consumer. The consumer sets it to p + _MaxEvents when it takes the event, which frees it for the next lap of the ring.
+     *          Once the event is published, producers can still replace it to coalesce or drop it, so the event and its order are only
+     *          touched while holding busy.
+     * @see https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+     */
+    struct Slot {
+        std::atomic<Count> sequence; ///< Whose turn it is to use the slot.
+        std::atomic<Id> key;         ///< The coalescing key of the event. _Pinned if the event can't be replaced.
+        std::atomic<bool> busy;      ///< Held while a published event is being replaced or taken.
+        std::atomic<Count> order;    ///< Where the event sorts. The position it was added at, or the tail of the lane if it replaced a dropped event.
+        Event event;                 ///< The event. Only touched by whoever the sequence says owns the slot.
+    };
+    /// @brief The key of slots whose events can't be coalesced or dropped.
+    static constexpr Id _Pinned = std::numeric_limits<Id>::max();
+    /**
+     * @struct Pending
+     * @brief An event that the consumer has seen in a lane but not run yet.
+     */
+    struct Pending {
+        Nanoseconds deadline; ///< The deadline of the event. The maximum for events without one so that they sort last.
+        Count position;       ///< The position of the slot holding the event in the lane.
+        Count order;          ///< The order of the slot when it was seen. Breaks ties so that events without a deadline stay FIFO.
+        Id affinity;          ///< The affinity key of the event.
+    };
+    /**
+     * @struct Lane
+     * @brief A ring of events of one priority.
+     * @details Producers fill slots in order. The consumer looks at every published event and keeps them in a min-heap by deadline so that it
+     *          can run them out of order. Slots are freed as their events run, and a producer can't pass a slot that is still in use, so
+     *          running out of order never lets an event be overwritten.
+     */
+    struct Lane {
+        /// @brief The ring buffer of events.
+        std::array<Slot, _MaxEvents> events;
+        /// @brief The position of the next event to add. Claimed by producers.
+        alignas(_CacheLineSize) std::atomic<Count> enqueuePosition = 0;
+        /// @brief The position of the next event the consumer hasn't seen. Only written by the thread running the events.
+        alignas(_CacheLineSize) std::atomic<Count> scanPosition = 0;
+        /// @brief The number of events that have been seen but not run. Only written by the thread running the events.
+        std::atomic<Count> pending = 0;
+        /// @brief Min-heap of the events that have been seen but not run.
+        std::array<Pending, _MaxEvents> heap;
+        /// @brief Set when an event that may be on the heap was dropped for a newer one so that the heap is sorted again.
+        std::atomic<bool> reordered = false;
+        /// @brief The number of times in a row this lane had events but a higher lane was run.
+        Count passedOver = 0;
+    };
+    /// @brief The lanes of the queue, indexed by Priority.
+    std::array<Lane, PriorityLanes> _lanes;
+    /// @brief The maximum number of events that can wait for their time to run.
+    static constexpr Count _MaxTimedEvents = APP_MAX_TIMED_EVENTS;
+    /**
+     * @struct Timer
+     * @brief An event waiting for its time to run.
+     */
+    struct Timer {
+        Nanoseconds time; ///< When the event should run.
+        Count order;      ///< The order the event was added in. Breaks ties so that events due at the same time run FIFO.
+        Count index;      ///< Where the event is in _timedEvents.
+    };
+    /// @brief The events waiting for their time to run. Only touched by the thread running the events.
+    std::array<Event, _MaxTimedEvents> _timedEvents;
+    /// @brief Min-heap of the events in _timedEvents, soonest first. Only touched by the thread running the events.
+    std::array<Timer, _MaxTimedEvents> _timers;
+    /// @brief The number of timers in the heap.
+    Count _timerCount = 0;
+    /// @brief Stack of the unused indicies of _timedEvents.
+    std::array<Count, _MaxTimedEvents> _freeTimedEvents;
+    /// @brief The number of unused indicies of _timedEvents.
+    Count _freeTimedEventCount = _MaxTimedEvents;
+    /// @brief Incremented each time an event is put on the timer heap.
+    Count _timerOrder = 0;
+    /// @brief Timed events that have been added but not run. Reserved when they are added so that there is always room for them on the heap.
+    std::atomic<Count> _timedEventsReserved = 0;
     /// @brief The thread id of the owner of the event queue. Used to determine if we can skip event queuing.
-    Id _ownerThreadId;
-    /// @brief True when there are events ready to read
-    bool _eventsReady = false;
+    alignas(_CacheLineSize) Id _ownerThreadId;
     /**
      * @brief True when optimizations for addEvents to your own event queue are enabled.
      * @details Optimization for when you add an event from the same thread that owns the event queue
@@ -206,23 +728,273 @@ class EventQueue {
     bool _addEventOptimizationsEnabled = false;
     /// @brief The list of threads waiting for events to be added.
     WaitingThreads _waitingThreads = {OperatingSystemTypes::NullId};
+    /// @brief The most events LoopMode::Drain runs before returning. 0 for no limit. One lap of the queue by default.
+    Count _drainMaxEvents = _MaxEvents;
+    /// @brief The longest LoopMode::Drain runs events for before returning. 0 for no limit.
+    Microseconds _drainTimeBudget = 0;
+    /// @brief What addEvent does when the lane is full.
+    std::atomic<OverflowPolicy> _overflowPolicy = OverflowPolicy::Reject;
+    /// @brief How long OverflowPolicy::Block waits for room. 0 for no limit.
+    std::atomic<Microseconds> _overflowTimeout = 0;
+    /// @brief The list of threads waiting for room in a lane.
+    WaitingThreads _blockedProducers = {OperatingSystemTypes::NullId};
+    /// @brief The number of threads waiting for room in a lane. Lets the thread running the events skip looking through the list.
+    std::atomic<Count> _blockedProducerCount = 0;
+    /// @brief The number of events dropped by the overflow policy.
+    std::atomic<Count> _eventsDropped = 0;
+    /// @brief The number of events that replaced a waiting event with the same coalescing key.
+    std::atomic<Count> _eventsCoalesced = 0;
+    /// @brief The most threads that can be running events with an affinity key at once. One for each worker and one for the owner.
+    static constexpr Count _MaxConsumers = APP_MAX_EVENT_WORKERS + 1;
+    /// @brief True while workers run the events. Every thread taking events holds the consumer mutex while it does.
+    std::atomic<bool> _multipleConsumers = false;
+    /// @brief Serializes taking events between the threads that run them while there are workers.
+    Id _consumerMutex = 0;
+    /// @brief Set to tell the workers to return.
+    std::atomic<bool> _stopWorkers = false;
+    /// @brief The number of worker threads.
+    Count _workerCount = 0;
+    /// @brief Makes the names of the worker threads unique.
+    Count _workerGroup = 0;
+    /// @brief The affinity keys of the events being run. 0 for none. Only touched while holding the consumer mutex.
+    std::array<Id, _MaxConsumers> _runningAffinities = {};
+    /// @brief True if an event was passed over because one with the same affinity key was running. Only touched while holding the consumer mutex.
+    bool _affinityWaiting = false;
+    /// @brief Incremented whenever an event may have become possible to take for a worker that found none. Lets it know not to block.
+    std::atomic<Count> _consumerChanges = 0;
+    /**
+     * @struct Idle
+     * @brief What a thread that found no event to take has to wait for.
+     */
+    struct Idle {
+        Nanoseconds wakeAt; ///< When the next timed event is due. 0 to wait for an event to be added.
+        Count changes;      ///< _consumerChanges when no event could be taken.
+    };
+
+    /// @brief The most file descriptors that can be watched.
+    static constexpr Count _MaxWatchedDescriptors = APP_MAX_WATCHED_DESCRIPTORS;
+    /**
+     * @struct Watch
+     * @brief A file descriptor watched by LoopMode::Descriptors.
+     */
+    struct Watch {
+        int descriptor;            ///< The file descriptor. -1 if the entry is free.
+        DescriptorHandler handler; ///< Called when the descriptor is ready.
+    };
+    /// @brief The watched file descriptors. Their index is what epoll gives back. Only touched by the thread running the events.
+    std::array<Watch, _MaxWatchedDescriptors> _watches;
+    /// @brief Signalled when an event is added to a queue that has gone quiet. -1 if there isn't one.
+    int _wakeDescriptor = -1;
+    /// @brief The epoll instance that waits on the wake descriptor and the watched ones. -1 until LoopMode::Descriptors first needs it.
+    int _pollDescriptor = -1;
+    /// @brief True once the wake descriptor has been signalled. Cleared when the thread running the events finds none left to take.
+    std::atomic<bool> _wakeSignalled = false;
+    /**
+     * @struct Resumption
+     * @brief A coroutine that could not be resumed through its lane because the lane was full.
+     * @details Kept in the coroutine's frame. A suspended coroutine is resumed once per suspension so it never needs more than one.
+     */
+    struct Resumption {
+        std::coroutine_handle<> coroutine; ///< The coroutine to resume.
+        Resumption *next = nullptr;        ///< The coroutine pushed before this one.
+    };
+    /// @brief Stack of coroutines waiting to be resumed. Pushed by any thread. Only popped by the thread taking the next event.
+    std::atomic<Resumption *> _resumptions = nullptr;
+
+    /// @brief Unblock every thread waiting for events.
+    void wakeWaitingThreads();
+    /// @brief Signal the wake descriptor if it isn't already.
+    void signalWakeDescriptor();
+    /**
+     * @brief Make the wake descriptor quiet again.
+     * @returns true if it had been signalled, in which case an event added since may not have signalled it again.
+     */
+    bool clearWakeDescriptor();
+    /**
+     * @brief Create the epoll instance and have it wait on the wake descriptor.
+     * @returns ErrorType::Success if it exists.
+     * @returns ErrorType::NotAvailable if there is no wake descriptor.
+     * @returns ErrorType::NotImplemented if the platform has no epoll.
+     * @returns The error from epoll if it could not be created.
+     */
+    ErrorType openPollDescriptor();
+    /// @brief True if an event may be possible to take since no event could be taken.
+    bool eventsArrived(const Idle &idle) const;
+    /**
+     * @brief Wait on the wake descriptor and the watched ones and run the handlers of those that are ready.
+     * @param[in] idle What to wait for. Doesn't wait at all if nullptr.
+     * @param[out] handlersRun The number of handlers that were run.
+     * @returns ErrorType::Success if every handler that was run succeeded or the wait ended without any descriptor being ready.
+     * @returns The error code of the last handler that failed.
+     * @returns ErrorType::NotImplemented if the platform has no epoll.
+     * @returns The error from epoll if the wait failed.
+     * @returns The error from OperatingSystem::monotonicTime if the time until the next timed event could not be worked out.
+     */
+    ErrorType waitForDescriptors(const Idle *idle, Count &handlersRun);
+    /// @brief Unblock every thread waiting for room in a lane. Called by the thread running the events after it has freed slots.
+    void wakeBlockedProducers();
+
+    /// @brief True if addEvent should run the event right away instead of queuing it.
+    bool runsInline() const;
+    /// @brief True if a thread known to the operating system runs the events.
+    bool hasConsumer() const;
+
+    /**
+     * @brief Adds an event that must not be dropped or replaced.
+     * @details Same as addEvent but ignores the overflow policy. Used for events that resume coroutines.
+     */
+    ErrorType addPinnedEvent(Event &event);
+
+    /**
+     * @brief Resume a coroutine on the thread of an event queue.
+     * @details Never blocks. If the lane is full the coroutine is pushed onto _resumptions instead, since dropping it would leave the
+     *          coroutine suspended forever.
+     * @param[in] queue The event queue. The coroutine is resumed right away if nullptr or nothing runs its events.
+     * @param[in] coroutine The coroutine to resume.
+     * @param[in] resumption Storage in the coroutine's frame for when the lane is full.
+     */
+    static void resume(EventQueue *queue, std::coroutine_handle<> coroutine, Resumption &resumption);
+    /**
+     * @brief Take a coroutine that is waiting on _resumptions.
+     * @pre Called by the thread taking the next event, with the consumer mutex held if there are workers.
+     * @returns true if event was set to resume a coroutine.
+     */
+    bool takeResumption(Event &event);
+
+    /**
+     * @brief Put an event in a lane for the thread running the events.
+     * @param[in] event The event.
+     * @param[in] priority The lane.
+     * @param[in] replaceable True if the event can be coalesced or dropped by the overflow policy once it is in the lane.
+     * @returns ErrorType::Success if the event was added
+     * @returns ErrorType::LimitReached if the lane is full.
+     */
+    ErrorType enqueue(Event &event, const Priority priority, const bool replaceable = false);
+
+    /**
+     * @brief Do what the overflow policy says with an event that didn't fit in its lane.
+     * @sa addEvent
+     */
+    ErrorType overflow(Event &event, const Priority priority);
+
+    /**
+     * @brief Replace the waiting event with the same coalescing key as the one given.
+     * @returns true if an event was replaced.
+     */
+    bool coalesce(Event &event, Lane &lane);
+
+    /**
+     * @brief Drop the event that has been waiting in a full lane the longest and add the new one behind the others.
+     * @details The slot of the dropped event is reused for the new one since a full lane has no other.
+     * @returns ErrorType::Success if the event was added, either in place of the oldest or because room was made.
+     * @returns ErrorType::LimitReached if the oldest event can't be dropped.
+     */
+    ErrorType dropOldest(Event &event, const Priority priority);
+
+    /**
+     * @brief Replace the callback of an event that has been published to a slot.
+     * @details Only done when the deadline and affinity key match since the thread running the events may already have sorted the event by them.
+     * @param[in] slot The slot.
+     * @param[in] position The position the event was published at.
+     * @param[in] key The coalescing key the slot must still have.
+     * @param[in] event The event whose callback replaces the one in the slot.
+     * @returns true if the callback was replaced. false if the event was taken, is being replaced by someone else or doesn't match.
+     */
+    bool replaceEvent(Slot &slot, const Count position, const Id key, Event &event);
+
+    /**
+     * @brief Replace an event that has been published to a slot with a new one that sorts behind every event in the lane.
+     * @param[in] lane The lane the slot is in.
+     * @param[in] slot The slot.
+     * @param[in] position The position the slot was published at.
+     * @param[in] order The order the slot must still have.
+     * @param[in] event The event that replaces the one in the slot.
+     * @returns true if the event was replaced. false if the event was taken or is being replaced by someone else.
+     */
+    bool requeueEvent(Lane &lane, Slot &slot, const Count position, const Count order, Event &event);
+
+    /**
+     * @brief Block until a lane might have room.
+     * @param[in] lane The lane.
+     * @param[in] deadline On the same clock as OperatingSystem::monotonicTime. 0 for no deadline.
+     * @returns ErrorType::Success if the lane should be tried again.
+     * @returns ErrorType::Timeout if the deadline passed.
+     * @returns ErrorType::LimitReached if there are too many threads waiting.
+     */
+    ErrorType waitForRoom(const Lane &lane, const Nanoseconds deadline);
+
+    /**
+     * @brief Take the timed event that is due soonest if its time has come.
+     * @param[out] event The event that was taken.
+     * @param[out] wakeAt When the next timed event is due. 0 if there are none or it is due but waiting for its affinity key.
+     * @returns true if an event was taken.
+     */
+    bool takeDueTimedEvent(Event &event, Nanoseconds &wakeAt);
+
+    /**
+     * @brief Take the next event off of the queue.
+     * @details Holds the consumer mutex while workers are running.
+     * @param[out] event The event that was taken.
+     * @param[out] idle What to wait for if no event was taken.
+     * @returns true if an event was taken
+     * @returns false if the queue is empty or every event is waiting for its affinity key.
+     */
+    bool takeNextEvent(Event &event, Idle &idle);
 
     /**
-     * @brief If the event queue is not full, atomically increments the number of events queued.
-     * @returns true if the event was added to the queue.
-     * @returns false if the event queue is full.
+     * @brief Take the next event off of the queue.
+     * @details The highest lane with events is chosen unless a lower one has been passed over _StarvationLimit times in a row.
+     * @sa takeNextEvent
      */
-    bool addEventIfNotFull();
+    bool nextEvent(Event &event, Idle &idle, const bool multipleConsumers);
 
     /**
-     * @brief Wait for the next event to be added to the queue.
+     * @brief Take the event from a lane that should run next.
+     * @param[in] lane The lane. Must have pending events.
+     * @param[out] event The event that was taken.
+     * @param[in] multipleConsumers True to pass over events whose affinity key is running.
+     * @returns true if an event was taken.
+     */
+    bool takeFromLane(Lane &lane, Event &event, const bool multipleConsumers);
+
+    /// @brief True if an event with the affinity key can't run yet.
+    bool affinityRunning(const Id key) const;
+
+    /// @brief Run an event and let the events with the same affinity key run once it is done.
+    ErrorType runEvent(Event &event);
+
+    /**
+     * @brief Move the events that have been published to a lane since it was last looked at onto its heap.
+     * @details Timed events that are not due yet are moved onto the timer heap instead.
+     * @param[in] lane The lane to look at.
+     * @returns true if the lane has events to run.
+     */
+    bool collectEvents(Lane &lane);
+
+    /**
+     * @brief How the event in a slot sorts on the heap of its lane.
+     * @pre busy is held for the slot.
+     */
+    static Pending pendingOf(const Slot &slot, const Count position);
+
+    /// @brief Orders the heap of pending events so that the earliest deadline, then the earliest order, is on top.
+    static bool runsLater(const Pending &a, const Pending &b);
+    /// @brief Orders the timer heap so that the soonest time, then the earliest added, is on top.
+    static bool firesLater(const Timer &a, const Timer &b);
+
+    /**
+     * @brief Wait for the next event to be added to the queue or for the next timed event to be due.
      * @details Blocking call. Not interrupt safe.
-     * @returns ErrorType::Success if one or more events are in the queue.
+     * @param[in] idle What to wait for.
+     * @returns ErrorType::Success if one or more events are in the queue or a timed event is due.
      * @returns ErrorType::Failure if an error occurred while waiting.
      * @returns ErrorType::LimitReached if the wait could not be performed because there are too many waiting threads.
      * @returns ErrorType::LimitReached because the thread was previously unblocked.
      */
-    ErrorType waitForEvents();
+    ErrorType waitForEvents(const Idle &idle);
+
+    /// @brief True if an event was published that hasn't been seen yet, or something else happened that may let a worker take an event.
+    bool workAvailable(const Idle &idle) const;
 };
 
 #endif //__EVENT_QUEUE_HPP__
\ No newline at end of file
@@ -7,31 +7,25 @@ namespace {
 }
 
 ErrorType IpClient::connectTo(std::string_view hostname, const Port port, const IpTypes::Protocol protocol, const IpTypes::Version version, const Milliseconds timeout) {
-    volatile bool doneConnecting = false;
-    ErrorType callbackError = ErrorType::Failure;
-    Id thread;
-    OperatingSystem::Instance().currentThreadId(thread);
+    EventQueue::Future<> connected;
 
-    auto connectCb = [&, thread]() -> ErrorType {
+    auto connectCb = [&, promise = connected.promise()]() -> ErrorType {
         // Ensure any existing connection is properly closed
         disconnect();
 
-        callbackError = network().connectTo(hostname, port, protocol, version, _socket, timeout);
+        const ErrorType error = network().connectTo(hostname, port, protocol, version, _socket, timeout);
 
-        doneConnecting = true;
-        OperatingSystem::Instance().unblock(thread);
-        return callbackError;
+        promise.complete(error);
+        return error;
     };
 
     ErrorType error = ErrorType::Failure;
     EventQueue::Event event = EventQueue::Event(connectCb);
-    if (ErrorType::Success != (error = network().addEvent(event))) {
+    if (ErrorType::Success != (error = network().addEvent(event)) || ErrorType::Success != (error = connected.wait())) {
         return error;
     }
 
-    while (!doneConnecting && ErrorType::LimitReached == OperatingSystem::Instance().block());
-
-    return callbackError;
+    return connected.result();
 }
 
 ErrorType IpClient::disconnect() {
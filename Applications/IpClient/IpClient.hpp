@@ -10,6 +10,7 @@
 //AbstractionLayer
 #include "NetworkAbstraction.hpp"
 #include "OperatingSystemModule.hpp"
+#include "Coroutine.hpp"
 //C++
 #include <memory>
 
@@ -73,6 +74,35 @@ class IpClient {
     ErrorType receiveBlocking(StaticString::Container &buffer, const Milliseconds timeout) {
         return receiveBlockingImplementation(buffer,  timeout);
     }
+    /**
+     * @brief Sends data from a coroutine.
+     * @details co_await the result to get what sendBlocking would return. The data is sent by the thread running the network's events
+     *          while the coroutine's thread runs other events.
+     * @param[in] data The data to send. Must stay valid until the send has finished.
+     * @param[in] timeout The timeout in milliseconds.
+     * @sa sendBlocking
+     */
+    auto sendAwaitable(std::string_view data, const Milliseconds timeout) {
+        return network().awaitEvent([this, data, timeout]() -> ErrorType { return sendBlocking(data, timeout); });
+    }
+    /// @copydoc sendAwaitable(std::string_view data, const Milliseconds timeout)
+    auto sendAwaitable(const StaticString::Container &data, const Milliseconds timeout) {
+        return network().awaitEvent([this, &data, timeout]() -> ErrorType { return sendBlocking(data, timeout); });
+    }
+    /**
+     * @brief Receives data from a coroutine.
+     * @details co_await the result to get what receiveBlocking would return.
+     * @param[out] buffer The data to receive. Must stay valid until the receive has finished.
+     * @param[in] timeout The timeout in milliseconds.
+     * @sa receiveBlocking
+     */
+    auto receiveAwaitable(std::string &buffer, const Milliseconds timeout) {
+        return network().awaitEvent([this, &buffer, timeout]() -> ErrorType { return receiveBlocking(buffer, timeout); });
+    }
+    /// @copydoc receiveAwaitable(std::string &buffer, const Milliseconds timeout)
+    auto receiveAwaitable(StaticString::Container &buffer, const Milliseconds timeout) {
+        return network().awaitEvent([this, &buffer, timeout]() -> ErrorType { return receiveBlocking(buffer, timeout); });
+    }
     /**
      * @brief Sends data.
      * @pre The amount of data to send is equal to the size of data. See std::string::resize()
@@ -175,55 +205,42 @@ class IpClient {
     /// @copydoc sendBlocking(const std::string &data, const Milliseconds timeout)
     template <typename Data>
     ErrorType sendBlockingImplementation(const Data &data, const Milliseconds timeout) {
-        volatile bool doneSending = false;
-        ErrorType callbackError = ErrorType::Failure;
-        Id thread;
-        OperatingSystem::Instance().currentThreadId(thread);
+        EventQueue::Future<> sent;
 
-        auto tx = [&, thread]() -> ErrorType {
-            callbackError = network().transmit(data, _socket, timeout);
+        auto tx = [&, promise = sent.promise()]() -> ErrorType {
+            const ErrorType error = network().transmit(data, _socket, timeout);
 
-            doneSending = true;
-            OperatingSystem::Instance().unblock(thread);
-            return callbackError;
+            promise.complete(error);
+            return error;
         };
 
         EventQueue::Event event = EventQueue::Event(tx);
         ErrorType error = network().addEvent(event);
-        if (ErrorType::Success != error) {
+        if (ErrorType::Success != error || ErrorType::Success != (error = sent.wait())) {
             return error;
         }
 
-        while (!doneSending && ErrorType::LimitReached == OperatingSystem::Instance().block());
-
-        return callbackError;
+        return sent.result();
     }
     /// @copydoc ErrorType receiveBlocking(std::string &buffer, const Milliseconds timeout)
     template <typename Buffer>
     ErrorType receiveBlockingImplementation(Buffer &buffer, const Milliseconds timeout) {
-        volatile bool doneReceiving = false;
-        ErrorType callbackError = ErrorType::Failure;
-        Id thread;
-        OperatingSystem::Instance().currentThreadId(thread);
+        EventQueue::Future<> received;
 
-        auto rx = [&, thread]() -> ErrorType {
+        auto rx = [&, promise = received.promise()]() -> ErrorType {
+            const ErrorType error = network().receive(buffer, _socket, timeout);
 
-            callbackError = network().receive(buffer, _socket, timeout);
-
-            doneReceiving = true;
-            OperatingSystem::Instance().unblock(thread);
-            return callbackError;
+            promise.complete(error);
+            return error;
         };
 
         EventQueue::Event event = EventQueue::Event(rx);
         ErrorType error = network().addEvent(event);
-        if (ErrorType::Success != error) {
+        if (ErrorType::Success != error || ErrorType::Success != (error = received.wait())) {
             return error;
         }
 
-        while (!doneReceiving && ErrorType::LimitReached == OperatingSystem::Instance().block());
-
-        return callbackError;
+        return received.result();
     }
 };
 
@@ -1,106 +1,109 @@
 //AbstractionLayer
 #include "IpServer.hpp"
 
+IpServer::IpServer() {
+    //Left at 0 if it can't be created. The server still works from a single network thread.
+    if (ErrorType::Success != OperatingSystem::Instance().createReadWriteLock(_connectedSocketsLock)) {
+        _connectedSocketsLock = 0;
+    }
+}
+
+IpServer::~IpServer() {
+    if (0 != _connectedSocketsLock) {
+        OperatingSystem::Instance().deleteReadWriteLock(_connectedSocketsLock);
+    }
+}
+
 ErrorType IpServer::listenTo(const IpTypes::Protocol protocol, const IpTypes::Version version, const Port port) {
-    volatile bool doneListening = false;
-    ErrorType callbackError = ErrorType::Failure;
-    Id thread;
-    OperatingSystem::Instance().currentThreadId(thread);
+    EventQueue::Future<> listened;
 
     closeConnection(_listenerSocket);
 
-    auto listenCb = [&, thread]() -> ErrorType {
-        callbackError = network().listenTo(protocol, version, port, _listenerSocket);
-        if (ErrorType::Success == callbackError) {
+    auto listenCb = [&, promise = listened.promise()]() -> ErrorType {
+        const ErrorType error = network().listenTo(protocol, version, port, _listenerSocket);
+        if (ErrorType::Success == error) {
             _protocol = protocol;
             _version = version;
             _port = port;
         }
 
-        _status.listening = callbackError == ErrorType::Success;
-        doneListening = true;
-        OperatingSystem::Instance().unblock(thread);
+        OperatingSystem::Instance().lockWrite(_connectedSocketsLock, std::numeric_limits<Milliseconds>::max());
+        _status.update([&](IpServerTypes::Status &status) { status.listening = error == ErrorType::Success; });
+        OperatingSystem::Instance().unlockReadWriteLock(_connectedSocketsLock);
+        promise.complete(error);
 
-        return callbackError;
+        return error;
     };
 
     EventQueue::Event event = EventQueue::Event(listenCb);
-    if (ErrorType::Success != network().addEvent(event)) {
+    if (ErrorType::Success != network().addEvent(event) || ErrorType::Success != listened.wait()) {
         return ErrorType::Failure;
     }
 
-    while (!doneListening && ErrorType::LimitReached == OperatingSystem::Instance().block());
-
-    return callbackError;
+    return listened.result();
 }
 
 ErrorType IpServer::acceptConnection(Socket &socket, const Milliseconds timeout) {
-    volatile bool acceptConnectionDone = false;
-    ErrorType callbackError = ErrorType::Failure;
+    EventQueue::Future<> accepted;
     socket = -1;
-    Id thread;
-    OperatingSystem::Instance().currentThreadId(thread);
 
-    auto acceptConnectionCallback = [&, thread]() -> ErrorType {
-        callbackError = network().acceptConnection(_listenerSocket, socket, timeout);
+    auto acceptConnectionCallback = [&, promise = accepted.promise()]() -> ErrorType {
+        const ErrorType error = network().acceptConnection(_listenerSocket, socket, timeout);
 
-        if (ErrorType::Success == callbackError) {
+        if (ErrorType::Success == error) {
+            OperatingSystem::Instance().lockWrite(_connectedSocketsLock, std::numeric_limits<Milliseconds>::max());
             _connectedSockets.push_back(socket);
-            _status.activeConnections = _connectedSockets.size();
+            _status.update([this](IpServerTypes::Status &status) { status.activeConnections = _connectedSockets.size(); });
+            OperatingSystem::Instance().unlockReadWriteLock(_connectedSocketsLock);
         }
 
-        acceptConnectionDone = true;
-        OperatingSystem::Instance().unblock(thread);
-        return callbackError;
+        promise.complete(error);
+        return error;
     };
 
     EventQueue::Event event = EventQueue::Event(acceptConnectionCallback);
     ErrorType error = network().addEvent(event);
-    if (ErrorType::Success != error) {
+    if (ErrorType::Success != error || ErrorType::Success != (error = accepted.wait())) {
         return error;
     }
 
-    while (!acceptConnectionDone && ErrorType::LimitReached == OperatingSystem::Instance().block());
-
-    return callbackError;
+    return accepted.result();
 }
 
 ErrorType IpServer::closeConnection(const Socket socket) {
-    volatile bool closeConnectionDone = false;
-    ErrorType callbackError = ErrorType::Failure;
-    Id thread;
-    OperatingSystem::Instance().currentThreadId(thread);
+    EventQueue::Future<> closed;
+
+    auto closeConnection = [&, promise = closed.promise()]() -> ErrorType {
+        ErrorType error = ErrorType::Failure;
 
-    auto closeConnection = [&, thread]() -> ErrorType {
         if (ErrorType::Success == network().closeConnection(socket)) {
+            OperatingSystem::Instance().lockWrite(_connectedSocketsLock, std::numeric_limits<Milliseconds>::max());
             const auto closedSocket = std::find(_connectedSockets.begin(), _connectedSockets.end(), socket);
             if (_connectedSockets.end() != closedSocket) {
                 _connectedSockets.erase(closedSocket);
-                _status.activeConnections = _connectedSockets.size();
-                callbackError = ErrorType::Success;
+                _status.update([this](IpServerTypes::Status &status) { status.activeConnections = _connectedSockets.size(); });
+                error = ErrorType::Success;
             }
             else {
-                callbackError = ErrorType::NoData;
+                error = ErrorType::NoData;
             }
+            OperatingSystem::Instance().unlockReadWriteLock(_connectedSocketsLock);
         }
         else {
-            callbackError = fromPlatformError(errno);
+            error = fromPlatformError(errno);
         }
 
-        closeConnectionDone = true;
-        OperatingSystem::Instance().unblock(thread);
-        return callbackError;
+        promise.complete(error);
+        return error;
     };
 
     EventQueue::Event event = EventQueue::Event(closeConnection);
     ErrorType error = network().addEvent(event);
-    if (ErrorType::Success != error) {
+    if (ErrorType::Success != error || ErrorType::Success != (error = closed.wait())) {
         return error;
     }
 
-    while (!closeConnectionDone && ErrorType::LimitReached == OperatingSystem::Instance().block());
-
-    return callbackError;
+    return closed.result();
 }
 
 ErrorType IpServer::sendNonBlocking(const std::shared_ptr<std::string> data, const Milliseconds timeout, const Socket socket, std::function<void(const ErrorType error, const Bytes bytesWritten)> callback) {
@@ -10,6 +10,7 @@
 //AbstractionLayer
 #include "NetworkAbstraction.hpp"
 #include "OperatingSystemModule.hpp"
+#include "SeqLock.hpp"
 //C++
 #include <memory>
 
@@ -39,15 +40,18 @@ namespace IpServerTypes {
 class IpServer {
 
     public:
+    /// @brief Constructor
+    IpServer();
     /// @brief Destructor
-    virtual ~IpServer() = default;
+    virtual ~IpServer();
 
     /// @brief The tag for logging.
     static constexpr char TAG[] =  "IpServer";
     /// @brief Print the status if the IP server.
     void printStatus() {
+        const IpServerTypes::Status snapshot = status();
         PLT_LOGI(TAG, "<IpServerStatus> <Listening:%s, Active Connections:%u> <Pie, Line>",
-            status().listening ? "true" : "false", status().activeConnections);
+            snapshot.listening ? "true" : "false", snapshot.activeConnections);
     }
 
     /**
@@ -138,9 +142,10 @@ class IpServer {
     ///@brief Set the network abstraction
     ///@param[in] network The network abstraction to set
     void setNetwork(NetworkAbstraction &network) { _network = &network; }
-    ///@brief Get a constant reference to the status of the server
-    const IpServerTypes::Status &status() const {
-        return _status;
+    ///@brief Get a copy of the status of the server
+    ///@details Safe to call from any thread. Never waits on the network thread that updates the status.
+    IpServerTypes::Status status() const {
+        return _status.read();
     }
 
     protected:
@@ -152,10 +157,12 @@ class IpServer {
     IpTypes::Version _version = IpTypes::Version::Unknown;
     /// @brief The port
     Port _port = 0;
-    /// @brief The status of the server
-    IpServerTypes::Status _status;
-    /// @brief list of all the sockets we have accepted connection for
+    /// @brief The status of the server. Only written while holding _connectedSocketsLock for writing.
+    SeqLock<IpServerTypes::Status> _status;
+    /// @brief list of all the sockets we have accepted connection for. Guarded by _connectedSocketsLock.
     std::vector<Socket> _connectedSockets = {};
+    /// @brief Guards _connectedSockets since the network may run its events on more than one thread. 0 if it couldn't be created.
+    Id _connectedSocketsLock = 0;
 
     private:
     /// @brief The network abstraction that this server communicates on.
@@ -165,69 +172,63 @@ class IpServer {
     /// @copydoc sendBlocking(const std::string &data, const Milliseconds timeout, const Socket socket)
     template <typename Data>
     ErrorType sendBlockingImplementation(const Data &data, const Milliseconds timeout, const Socket socket) {
-        volatile bool sent = false;
-        ErrorType callbackError = ErrorType::Failure;
-        Id thread;
-        OperatingSystem::Instance().currentThreadId(thread);
+        EventQueue::Future<> sent;
 
-        auto tx = [&, thread]() -> ErrorType {
-            callbackError = network().transmit(data, socket, timeout);
+        auto tx = [&, promise = sent.promise()]() -> ErrorType {
+            const ErrorType error = network().transmit(data, socket, timeout);
 
-            sent = true;
-            OperatingSystem::Instance().unblock(thread);
-            return callbackError;
+            promise.complete(error);
+            return error;
         };
 
         EventQueue::Event event = EventQueue::Event(tx);
         ErrorType error = network().addEvent(event);
 
-        if (ErrorType::Success != error) {
+        if (ErrorType::Success != error || ErrorType::Success != (error = sent.wait())) {
             return error;
         }
 
-        while (!sent && ErrorType::LimitReached == OperatingSystem::Instance().block());
-
-        return callbackError;
+        return sent.result();
     }
     /// @copydoc receiveBlocking(std::string &buffer, const Milliseconds timeout, Socket &socket)
     template <typename Buffer>
     ErrorType receiveBlockingImplementation(Buffer &buffer, const Milliseconds timeout, Socket &socket) {
-        volatile bool received = false;
-        ErrorType callbackError = ErrorType::NoData;
-        Id thread;
-        OperatingSystem::Instance().currentThreadId(thread);
+        EventQueue::Future<> received;
+
+        auto rx = [&, promise = received.promise()]() -> ErrorType {
+            ErrorType error = ErrorType::NoData;
 
-        auto rx = [&, thread]() -> ErrorType {
             if (-1 == socket) {
+                //Copied so that connections can be accepted and closed while this waits to receive.
+                OperatingSystem::Instance().lockRead(_connectedSocketsLock, std::numeric_limits<Milliseconds>::max());
+                const std::vector<Socket> connectedSockets = _connectedSockets;
+                OperatingSystem::Instance().unlockReadWriteLock(_connectedSocketsLock);
 
-                for (size_t i = 0; i < _connectedSockets.size(); i++) {
-                    callbackError = network().receive(buffer, _connectedSockets[i], timeout);
+                for (size_t i = 0; i < connectedSockets.size(); i++) {
+                    error = network().receive(buffer, connectedSockets[i], timeout);
 
-                    if (ErrorType::Success == callbackError) {
-                        socket = _connectedSockets[i];
+                    if (ErrorType::Success == error) {
+                        socket = connectedSockets[i];
                         break;
                     }
                 }
             }
             else {
-                callbackError = network().receive(buffer, socket, timeout);
+                error = network().receive(buffer, socket, timeout);
             }
 
-            received = true;
-            OperatingSystem::Instance().unblock(thread);
-            return callbackError;
+            promise.complete(error);
+            return error;
         };
 
         EventQueue::Event event = EventQueue::Event(rx);
         ErrorType error = network().addEvent(event);
 
-        if (ErrorType::Success != error) {
+        if (ErrorType::Success != error || ErrorType::Success != (error = received.wait())) {
             return error;
         }
 
-        while (!received && ErrorType::LimitReached == OperatingSystem::Instance().block());
-
-        return callbackError;
+        return received.result();
     }
 };
 
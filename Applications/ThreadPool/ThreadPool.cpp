@@ -0,0 +1,409 @@
+#include "ThreadPool.hpp"
+//C++
+#include <cstdio>
+
+namespace {
+    /// @brief The worker that the calling thread is running as, or nullptr if it is not a worker of any pool.
+    thread_local ThreadPoolTypes::Worker *CurrentWorker = nullptr;
+    /// @brief Used to give the workers of each pool unique thread names.
+    std::atomic<Count> PoolsCreated = 0;
+
+    static_assert(0 == (ThreadPoolTypes::DequeCapacity & (ThreadPoolTypes::DequeCapacity - 1)), "DequeCapacity must be a power of two");
+    static_assert(0 == (ThreadPoolTypes::InjectionQueueCapacity & (ThreadPoolTypes::InjectionQueueCapacity - 1)), "InjectionQueueCapacity must be a power of two");
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static void *ThreadPoolWorker(void *arguments) {
+    ThreadPoolTypes::Worker *worker = static_cast<ThreadPoolTypes::Worker *>(arguments);
+    worker->pool->workerLoop(*worker);
+
+    return nullptr;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+namespace ThreadPoolTypes {
+
+    void Task::run() {
+        //Take over the pool's reference so the task stays alive until we are done with it, even if every waiter lets go of its handle.
+        std::shared_ptr<Task> self = std::move(_self);
+
+        _work();
+        _done.store(true, std::memory_order_release);
+        _done.notify_all();
+    }
+
+    ErrorType Task::wait() {
+        while (!isDone()) {
+            //If there is nothing left to run then this task is already running on another thread.
+            if (!_pool.runPendingTask()) {
+                _done.wait(false, std::memory_order_acquire);
+            }
+        }
+
+        return ErrorType::Success;
+    }
+
+    ErrorType WorkStealingDeque::push(Task *task) {
+        const int64_t bottom = _bottom.load(std::memory_order_relaxed);
+        const int64_t top = _top.load(std::memory_order_acquire);
+
+        if (bottom - top >= static_cast<int64_t>(_tasks.size())) {
+            return ErrorType::LimitReached;
+        }
+
+        _tasks[bottom & (_tasks.size() - 1)].store(task, std::memory_order_relaxed);
+        _bottom.store(bottom + 1, std::memory_order_release);
+
+        return ErrorType::Success;
+    }
+
+    Task *WorkStealingDeque::pop() {
+        const int64_t bottom = _bottom.load(std::memory_order_relaxed) - 1;
+        _bottom.store(bottom, std::memory_order_relaxed);
+        //Make the reservation of the bottom task visible to thieves before checking how many tasks are left.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = _top.load(std::memory_order_relaxed);
+
+        Task *task = nullptr;
+
+        if (top <= bottom) {
+            task = _tasks[bottom & (_tasks.size() - 1)].load(std::memory_order_relaxed);
+
+            if (top == bottom) {
+                //Last task. Race any thieves for it.
+                if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                    task = nullptr;
+                }
+
+                _bottom.store(bottom + 1, std::memory_order_relaxed);
+            }
+        }
+        else {
+            _bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+
+        return task;
+    }
+
+    Task *WorkStealingDeque::steal() {
+        int64_t top = _top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t bottom = _bottom.load(std::memory_order_acquire);
+
+        if (top < bottom) {
+            Task *task = _tasks[top & (_tasks.size() - 1)].load(std::memory_order_relaxed);
+
+            if (_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                return task;
+            }
+        }
+
+        return nullptr;
+    }
+
+    InjectionQueue::InjectionQueue() {
+        for (size_t i = 0; i < _cells.size(); i++) {
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ErrorType InjectionQueue::push(Task *task) {
+        size_t position = _enqueuePosition.load(std::memory_order_relaxed);
+
+        while (true) {
+            Cell &cell = _cells[position & (_cells.size() - 1)];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+            if (0 == difference) {
+                if (_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    cell.task = task;
+                    cell.sequence.store(position + 1, std::memory_order_release);
+
+                    return ErrorType::Success;
+                }
+            }
+            else if (difference < 0) {
+                return ErrorType::LimitReached;
+            }
+            else {
+                position = _enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    Task *InjectionQueue::pop() {
+        size_t position = _dequeuePosition.load(std::memory_order_relaxed);
+
+        while (true) {
+            Cell &cell = _cells[position & (_cells.size() - 1)];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+
+            if (0 == difference) {
+                if (_dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    Task *task = cell.task;
+                    cell.sequence.store(position + _cells.size(), std::memory_order_release);
+
+                    return task;
+                }
+            }
+            else if (difference < 0) {
+                return nullptr;
+            }
+            else {
+                position = _dequeuePosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+ErrorType ThreadPool::start(const Count workers, const Bytes stackSize) {
+    if (_running.load()) {
+        return ErrorType::InvalidParameter;
+    }
+
+    Count workersToCreate = workers;
+    if (0 == workersToCreate) {
+        ErrorType error = OperatingSystem::Instance().onlineCores(workersToCreate);
+        if (ErrorType::Success != error) {
+            return error;
+        }
+    }
+
+    const Count pool = PoolsCreated.fetch_add(1, std::memory_order_relaxed);
+
+    //Every worker must exist before any of them start since they all look through each other's deques for work to steal.
+    for (Count i = 0; i < workersToCreate; i++) {
+        auto worker = std::make_unique<ThreadPoolTypes::Worker>();
+        worker->pool = this;
+        worker->index = i;
+        //Any non-zero seed will do.
+        worker->victimSeed = i + 1;
+        snprintf(worker->name.data(), worker->name.size(), "pool%u.%u", static_cast<uint8_t>(pool), static_cast<uint8_t>(i));
+
+        _workers.push_back(std::move(worker));
+    }
+
+    _running.store(true);
+
+    for (auto &worker : _workers) {
+        //The worker stores its own Id once it is running so that it is never seen half written by a thread trying to wake it.
+        Id thread;
+        ErrorType error = OperatingSystem::Instance().createThread(OperatingSystemTypes::Priority::Normal,
+                                                                   worker->name,
+                                                                   worker.get(),
+                                                                   stackSize,
+                                                                   ThreadPoolWorker,
+                                                                   thread);
+
+        if (ErrorType::Success != error) {
+            stop();
+            return error;
+        }
+
+        worker->started = true;
+    }
+
+    return ErrorType::Success;
+}
+
+ErrorType ThreadPool::stop() {
+    ErrorType error = ErrorType::Success;
+    _running.store(false);
+
+    for (auto &worker : _workers) {
+        if (!worker->started) {
+            continue;
+        }
+
+        //Wait for the worker to publish its Id so that the wake up below can't be missed.
+        while (OperatingSystemTypes::NullId == worker->thread.load());
+
+        //Unblock unconditionally. If the worker is between checking _running and blocking the unblock is remembered.
+        worker->sleeping.store(false);
+        OperatingSystem::Instance().unblock(worker->thread.load());
+    }
+
+    for (auto &worker : _workers) {
+        if (!worker->started) {
+            continue;
+        }
+
+        const ErrorType joinError = OperatingSystem::Instance().joinThread(worker->name);
+        if (ErrorType::Success != joinError) {
+            error = joinError;
+        }
+    }
+
+    //Nothing else can be popping the worker deques now so run whatever was left behind.
+    while (runPendingTask());
+
+    _workers.clear();
+    _sleepingWorkers.store(0);
+
+    return error;
+}
+
+ErrorType ThreadPool::submit(std::function<void(void)> work, ThreadPoolTypes::Handle &handle) {
+    if (!_running.load(std::memory_order_relaxed)) {
+        return ErrorType::NoData;
+    }
+
+    handle = std::make_shared<ThreadPoolTypes::Task>(*this, std::move(work));
+    handle->_self = handle;
+
+    ErrorType error = enqueue(handle.get());
+    if (ErrorType::Success != error) {
+        handle->_self.reset();
+    }
+
+    return error;
+}
+
+const ThreadPoolTypes::Status &ThreadPool::status() const {
+    _status = {static_cast<Count>(_workers.size()), 0, 0, 0};
+
+    for (const auto &worker : _workers) {
+        _status.tasksExecuted += worker->tasksExecuted.load(std::memory_order_relaxed);
+        _status.tasksStolen += worker->tasksStolen.load(std::memory_order_relaxed);
+        _status.parks += worker->parks.load(std::memory_order_relaxed);
+    }
+
+    return _status;
+}
+
+void ThreadPool::workerLoop(ThreadPoolTypes::Worker &worker) {
+    Id thread = OperatingSystemTypes::NullId;
+    OperatingSystem::Instance().currentThreadId(thread);
+    worker.thread.store(thread);
+    CurrentWorker = &worker;
+
+    while (_running.load(std::memory_order_acquire)) {
+        ThreadPoolTypes::Task *task = findTask(&worker);
+
+        if (nullptr == task) {
+            //Announce that we are going to sleep and then look once more. A task queued before the announcement is found by the second
+            //look and a task queued after it will see that we are sleeping and wake us. Pairs with the fence in wakeWorker().
+            worker.sleeping.store(true);
+            _sleepingWorkers.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            task = findTask(&worker);
+
+            if (nullptr == task && _running.load()) {
+                worker.parks.fetch_add(1, std::memory_order_relaxed);
+
+                while (worker.sleeping.load() && _running.load()) {
+                    OperatingSystem::Instance().block();
+                }
+            }
+
+            //If someone else already cleared the flag they've also accounted for us in _sleepingWorkers.
+            if (worker.sleeping.exchange(false)) {
+                _sleepingWorkers.fetch_sub(1);
+            }
+        }
+
+        if (nullptr != task) {
+            task->run();
+            worker.tasksExecuted.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    CurrentWorker = nullptr;
+}
+
+ErrorType ThreadPool::enqueue(ThreadPoolTypes::Task *task) {
+    ThreadPoolTypes::Worker *self = CurrentWorker;
+    ErrorType error = ErrorType::LimitReached;
+
+    if (nullptr != self && this == self->pool) {
+        error = self->deque.push(task);
+    }
+
+    if (ErrorType::Success != error) {
+        error = _injectionQueue.push(task);
+    }
+
+    if (ErrorType::Success == error) {
+        wakeWorker();
+    }
+
+    return error;
+}
+
+ThreadPoolTypes::Task *ThreadPool::findTask(ThreadPoolTypes::Worker *self) {
+    ThreadPoolTypes::Task *task = nullptr;
+
+    if (nullptr != self && nullptr != (task = self->deque.pop())) {
+        return task;
+    }
+
+    if (nullptr != (task = _injectionQueue.pop())) {
+        return task;
+    }
+
+    const size_t workers = _workers.size();
+    if (0 == workers) {
+        return nullptr;
+    }
+
+    //Start from a different victim each time so that thieves spread out instead of all hammering the same deque.
+    size_t first = 0;
+    if (nullptr != self) {
+        self->victimSeed ^= self->victimSeed << 13;
+        self->victimSeed ^= self->victimSeed >> 17;
+        self->victimSeed ^= self->victimSeed << 5;
+        first = self->victimSeed % workers;
+    }
+
+    for (size_t i = 0; i < workers; i++) {
+        ThreadPoolTypes::Worker *victim = _workers[(first + i) % workers].get();
+
+        if (victim != self && nullptr != (task = victim->deque.steal())) {
+            if (nullptr != self) {
+                self->tasksStolen.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            return task;
+        }
+    }
+
+    return nullptr;
+}
+
+bool ThreadPool::runPendingTask() {
+    ThreadPoolTypes::Worker *self = CurrentWorker;
+    ThreadPoolTypes::Task *task = findTask(nullptr != self && this == self->pool ? self : nullptr);
+
+    if (nullptr != task) {
+        task->run();
+        return true;
+    }
+
+    return false;
+}
+
+void ThreadPool::wakeWorker() {
+    //Pairs with the fence in workerLoop(). Either we see the worker is sleeping or it sees the task we just queued.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (0 == _sleepingWorkers.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    for (auto &worker : _workers) {
+        if (worker->sleeping.load(std::memory_order_relaxed) && worker->sleeping.exchange(false)) {
+            _sleepingWorkers.fetch_sub(1);
+            OperatingSystem::Instance().unblock(worker->thread.load());
+            return;
+        }
+    }
+}
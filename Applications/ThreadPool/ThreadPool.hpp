@@ -0,0 +1,423 @@
+/**************************************************************************//**
+* @author Ben Haubrich
+* @file   ThreadPool.hpp
+* @details Work-stealing thread pool for running short, independent pieces of work in parallel.
+* @see https://www.dre.vanderbilt.edu/~schmidt/PDF/work-stealing-dequeue.pdf
+* @see https://fzn.fr/readings/ppopp13.pdf
+* @ingroup Applications
+*******************************************************************************/
+#ifndef __THREAD_POOL_HPP__
+#define __THREAD_POOL_HPP__
+
+//AbstractionLayer
+#include "Error.hpp"
+#include "Types.hpp"
+#include "OperatingSystemModule.hpp"
+//C++
+#include <atomic>
+#include <array>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <algorithm>
+
+class ThreadPool;
+
+/**
+ * @namespace ThreadPoolTypes
+ * @brief Types for the ThreadPool
+ */
+namespace ThreadPoolTypes {
+
+    /// @brief Tag for logging
+    static constexpr char TAG[] = "ThreadPool";
+    /// @brief The maximum number of tasks each worker can hold in its own deque. Must be a power of two.
+    static constexpr Count DequeCapacity = 1024;
+    /// @brief The maximum number of tasks that threads outside of the pool can have submitted at once. Must be a power of two.
+    static constexpr Count InjectionQueueCapacity = 1024;
+    /// @brief The stack size given to each worker if one is not provided to ThreadPool::start()
+    static constexpr Bytes DefaultStackSize = 256 * 1024;
+    /// @brief Size of a cache line. Used to keep data written by different workers from sharing a line.
+    static constexpr Bytes CacheLineSize = 64;
+
+    /**
+     * @struct Range
+     * @brief A half-open range of indices [begin, end)
+     */
+    struct Range {
+        size_t begin; ///< The first index in the range.
+        size_t end;   ///< One past the last index in the range.
+    };
+
+    /**
+     * @struct Status
+     * @brief The status of the ThreadPool
+     */
+    struct Status {
+        Count workers;       ///< The number of workers in the pool.
+        Count tasksExecuted; ///< The number of tasks that have been run by the workers.
+        Count tasksStolen;   ///< The number of tasks a worker took from another worker's deque.
+        Count parks;         ///< The number of times a worker ran out of work and blocked.
+    };
+
+    /**
+     * @class Task
+     * @brief A unit of work submitted to the ThreadPool.
+     * @details Tasks are only ever created by ThreadPool::submit() and are shared through a Handle so that the
+     *          submitter can wait for the work to complete.
+     */
+    class Task {
+
+        public:
+        /// @brief Constructor.
+        Task(ThreadPool &pool, std::function<void(void)> work) : _pool(pool), _work(std::move(work)) {}
+
+        /**
+         * @brief Check if the task has finished running.
+         * @returns true if the work has completed.
+         * @returns false otherwise.
+         */
+        bool isDone() const { return _done.load(std::memory_order_acquire); }
+        /**
+         * @brief Wait for the task to finish running.
+         * @details While the task is waiting to be run, the calling thread runs other queued tasks instead of sleeping.
+         *          This is what allows tasks to submit and wait on tasks of their own without running the pool out of workers.
+         *          Can be called from any thread, including threads that are not part of the pool.
+         * @returns ErrorType::Success once the task has completed.
+         */
+        ErrorType wait();
+
+        private:
+        friend class ::ThreadPool;
+
+        /// @brief The pool the task was submitted to.
+        ThreadPool &_pool;
+        /// @brief The work to run.
+        std::function<void(void)> _work;
+        /// @brief True when the work has completed.
+        std::atomic<bool> _done = false;
+        /// @brief Holds a reference to the task while it's queued so that the submitter can drop its handle without waiting.
+        std::shared_ptr<Task> _self;
+
+        /// @brief Run the work and wake anyone waiting for it.
+        void run();
+    };
+
+    /// @brief Waitable handle to a submitted task.
+    using Handle = std::shared_ptr<Task>;
+
+    /**
+     * @class WorkStealingDeque
+     * @brief Fixed capacity Chase-Lev deque.
+     * @details The owning worker pushes and pops from the bottom without contention. Any other thread may steal from the top.
+     *          Only the owner may call push() and pop().
+     * @see https://fzn.fr/readings/ppopp13.pdf for the memory orderings.
+     */
+    class WorkStealingDeque {
+
+        public:
+        /**
+         * @brief Push a task onto the bottom of the deque.
+         * @returns ErrorType::Success if the task was pushed.
+         * @returns ErrorType::LimitReached if the deque is full.
+         */
+        ErrorType push(Task *task);
+        /**
+         * @brief Pop the most recently pushed task from the bottom of the deque.
+         * @returns The task, or nullptr if the deque is empty.
+         */
+        Task *pop();
+        /**
+         * @brief Take the oldest task from the top of the deque.
+         * @returns The task, or nullptr if the deque is empty or another thread won the race for the task.
+         */
+        Task *steal();
+
+        private:
+        /// @brief The index one past the newest task. Only written by the owner.
+        alignas(CacheLineSize) std::atomic<int64_t> _bottom = 0;
+        /// @brief The index of the oldest task.
+        alignas(CacheLineSize) std::atomic<int64_t> _top = 0;
+        /// @brief The circular buffer of tasks.
+        alignas(CacheLineSize) std::array<std::atomic<Task *>, DequeCapacity> _tasks = {};
+    };
+
+    /**
+     * @class InjectionQueue
+     * @brief Bounded multi-producer, multi-consumer queue for tasks submitted from outside the pool.
+     * @see https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+     */
+    class InjectionQueue {
+
+        public:
+        /// @brief Constructor.
+        InjectionQueue();
+
+        /**
+         * @brief Add a task to the queue.
+         * @returns ErrorType::Success if the task was added.
+         * @returns ErrorType::LimitReached if the queue is full.
+         */
+        ErrorType push(Task *task);
+        /**
+         * @brief Remove the oldest task from the queue.
+         * @returns The task, or nullptr if the queue is empty.
+         */
+        Task *pop();
+
+        private:
+        /**
+         * @struct Cell
+         * @brief A slot in the queue and the sequence number that says whether it is ready to be written or read.
+         */
+        struct Cell {
+            std::atomic<size_t> sequence; ///< Equal to the position when the slot is free, position + 1 when it holds a task.
+            Task *task;                   ///< The task in the slot.
+        };
+
+        /// @brief The slots of the queue.
+        std::array<Cell, InjectionQueueCapacity> _cells;
+        /// @brief The position of the next slot to write.
+        alignas(CacheLineSize) std::atomic<size_t> _enqueuePosition = 0;
+        /// @brief The position of the next slot to read.
+        alignas(CacheLineSize) std::atomic<size_t> _dequeuePosition = 0;
+    };
+
+    /**
+     * @struct Worker
+     * @brief The state of a single worker thread.
+     */
+    struct alignas(CacheLineSize) Worker {
+        WorkStealingDeque deque;                             ///< Tasks submitted by this worker.
+        ThreadPool *pool;                                    ///< The pool the worker belongs to.
+        Count index;                                         ///< The index of the worker in the pool.
+        std::array<char, OperatingSystemTypes::MaxThreadNameLength> name; ///< The name of the worker thread.
+        std::atomic<Id> thread = OperatingSystemTypes::NullId; ///< The Id of the worker thread. Set by the worker once it starts.
+        std::atomic<bool> sleeping = false;                  ///< True when the worker has blocked waiting for work.
+        bool started = false;                                ///< True once the worker thread has been created.
+        uint32_t victimSeed;                                 ///< State for choosing which worker to steal from first.
+        std::atomic<Count> tasksExecuted = 0;                ///< The number of tasks this worker has run.
+        std::atomic<Count> tasksStolen = 0;                  ///< The number of tasks this worker has stolen.
+        std::atomic<Count> parks = 0;                        ///< The number of times this worker has blocked.
+    };
+}
+
+/**
+ * @class ThreadPool
+ * @brief Work-stealing thread pool.
+ * @details Each worker owns a Chase-Lev deque. Work submitted by a worker goes to the bottom of its own deque and is popped
+ *          newest first so that nested work stays hot in that core's cache. Work submitted by any other thread goes to a shared
+ *          injection queue. A worker that runs out of work first checks the injection queue and then steals the oldest task from
+ *          the other workers before blocking with OperatingSystem::block().
+ * @code{.cpp}
+ * ThreadPool pool;
+ * //Zero workers follows the number of online cores.
+ * pool.start(0);
+ *
+ * ThreadPoolTypes::Handle handle;
+ * pool.submit([]() { doSomething(); }, handle);
+ * handle->wait();
+ *
+ * std::vector<uint8_t> image(1920 * 1080);
+ * pool.parallelFor({0, image.size()}, 4096, [&image](const ThreadPoolTypes::Range &range) {
+ *     for (size_t i = range.begin; i < range.end; i++) {
+ *         image[i] = 255 - image[i];
+ *     }
+ * });
+ *
+ * uint32_t checksum;
+ * pool.parallelReduce({0, image.size()}, 4096, uint32_t(0),
+ *     [&image](const ThreadPoolTypes::Range &range) { return std::accumulate(&image[range.begin], &image[range.end], uint32_t(0)); },
+ *     [](const uint32_t a, const uint32_t b) { return a + b; },
+ *     checksum);
+ * @endcode
+ */
+class ThreadPool {
+
+    public:
+    /// @brief Constructor.
+    ThreadPool() = default;
+    /// @brief Destructor. Stops the pool.
+    ~ThreadPool() { stop(); }
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /**
+     * @brief Create the worker threads.
+     * @param[in] workers The number of workers to create. 0 creates one worker per online core.
+     * @param[in] stackSize The stack size of each worker.
+     * @returns ErrorType::Success if the workers were created.
+     * @returns ErrorType::InvalidParameter if the pool has already been started.
+     * @returns Any errors returned by OperatingSystem::onlineCores()
+     * @returns Any errors returned by OperatingSystem::createThread()
+     * @post If a worker could not be created, any workers that were created are stopped.
+     */
+    ErrorType start(const Count workers, const Bytes stackSize = ThreadPoolTypes::DefaultStackSize);
+    /**
+     * @brief Stop and join the worker threads.
+     * @details Any tasks still queued when the workers have stopped are run by the calling thread so that nothing waiting on
+     *          a handle is left waiting forever.
+     * @returns ErrorType::Success if the pool was stopped or was never started.
+     * @returns Any errors returned by OperatingSystem::joinThread()
+     */
+    ErrorType stop();
+    /**
+     * @brief Submit work to the pool.
+     * @details Thread safe. Can be called from inside a task.
+     * @param[in] work The work to run.
+     * @param[out] handle Handle that can be used to wait for the work to complete.
+     * @returns ErrorType::Success if the work was queued.
+     * @returns ErrorType::LimitReached if there is no room to queue the work.
+     * @returns ErrorType::NoData if the pool has not been started.
+     */
+    ErrorType submit(std::function<void(void)> work, ThreadPoolTypes::Handle &handle);
+    /**
+     * @brief Call a function for every index in range, split into chunks that are run in parallel.
+     * @details The calling thread takes part and does not return until every chunk has been run. Chunks are handed out
+     *          dynamically so uneven work per chunk is balanced across the workers.
+     * @tparam Function Callable with the signature void(const ThreadPoolTypes::Range &)
+     * @param[in] range The range of indices to run.
+     * @param[in] grain The number of indices in each chunk. Make this large enough that each chunk takes a few microseconds.
+     * @param[in] function The function to call on each chunk.
+     * @returns ErrorType::Success once the whole range has been run.
+     */
+    template <typename Function>
+    ErrorType parallelFor(const ThreadPoolTypes::Range range, const size_t grain, Function &&function) {
+        if (range.end <= range.begin) {
+            return ErrorType::Success;
+        }
+
+        const size_t chunkSize = std::max<size_t>(grain, 1);
+        std::atomic<size_t> nextChunk = range.begin;
+        auto runChunks = [&]() {
+            size_t begin;
+            while ((begin = nextChunk.fetch_add(chunkSize, std::memory_order_relaxed)) < range.end) {
+                function(ThreadPoolTypes::Range{begin, std::min(begin + chunkSize, range.end)});
+            }
+        };
+
+        const size_t helperTasks = helperCount(range, chunkSize);
+        std::vector<ThreadPoolTypes::Handle> helpers;
+        helpers.reserve(helperTasks);
+        for (size_t i = 0; i < helperTasks; i++) {
+            ThreadPoolTypes::Handle handle;
+
+            //If the pool is full the calling thread just ends up running more of the chunks.
+            if (ErrorType::Success != submit(runChunks, handle)) {
+                break;
+            }
+
+            helpers.push_back(std::move(handle));
+        }
+
+        runChunks();
+
+        for (auto &helper : helpers) {
+            helper->wait();
+        }
+
+        return ErrorType::Success;
+    }
+    /**
+     * @brief Map every chunk of a range to a value and combine the values into one result.
+     * @details Chunks are handed out dynamically so the order in which chunk results are combined is not fixed. combine must be
+     *          associative and commutative.
+     * @tparam T The type of the result.
+     * @tparam Map Callable with the signature T(const ThreadPoolTypes::Range &)
+     * @tparam Combine Callable with the signature T(const T &, const T &)
+     * @param[in] range The range of indices to reduce.
+     * @param[in] grain The number of indices in each chunk.
+     * @param[in] identity The value that leaves any other value unchanged when combined with it (e.g. 0 for a sum).
+     * @param[in] map The function that computes the value of a chunk.
+     * @param[in] combine The function that combines two values.
+     * @param[out] result The combined value of every chunk.
+     * @returns ErrorType::Success once the whole range has been reduced.
+     */
+    template <typename T, typename Map, typename Combine>
+    ErrorType parallelReduce(const ThreadPoolTypes::Range range, const size_t grain, const T &identity, Map &&map, Combine &&combine, T &result) {
+        result = identity;
+
+        if (range.end <= range.begin) {
+            return ErrorType::Success;
+        }
+
+        struct alignas(ThreadPoolTypes::CacheLineSize) Partial {
+            T value;
+        };
+
+        const size_t chunkSize = std::max<size_t>(grain, 1);
+        std::atomic<size_t> nextChunk = range.begin;
+        std::vector<Partial> partials(helperCount(range, chunkSize) + 1, Partial{identity});
+        auto runChunks = [&](Partial &partial) {
+            size_t begin;
+            while ((begin = nextChunk.fetch_add(chunkSize, std::memory_order_relaxed)) < range.end) {
+                partial.value = combine(partial.value, map(ThreadPoolTypes::Range{begin, std::min(begin + chunkSize, range.end)}));
+            }
+        };
+
+        std::vector<ThreadPoolTypes::Handle> helpers;
+        helpers.reserve(partials.size() - 1);
+        for (size_t i = 1; i < partials.size(); i++) {
+            ThreadPoolTypes::Handle handle;
+
+            if (ErrorType::Success != submit([&runChunks, &partial = partials[i]]() { runChunks(partial); }, handle)) {
+                break;
+            }
+
+            helpers.push_back(std::move(handle));
+        }
+
+        runChunks(partials[0]);
+
+        for (auto &helper : helpers) {
+            helper->wait();
+        }
+
+        for (const auto &partial : partials) {
+            result = combine(result, partial.value);
+        }
+
+        return ErrorType::Success;
+    }
+
+    /// @brief The number of workers in the pool.
+    Count workers() const { return _workers.size(); }
+    /// @brief Get the status as a constant reference
+    const ThreadPoolTypes::Status &status() const;
+
+    /**
+     * @brief The body of each worker thread.
+     * @details Only public so that it can be called from the thread start function.
+     */
+    void workerLoop(ThreadPoolTypes::Worker &worker);
+
+    private:
+    friend class ThreadPoolTypes::Task;
+
+    /// @brief The workers. Each is allocated separately so that the deques never move.
+    std::vector<std::unique_ptr<ThreadPoolTypes::Worker>> _workers;
+    /// @brief Tasks submitted by threads that are not workers of this pool.
+    ThreadPoolTypes::InjectionQueue _injectionQueue;
+    /// @brief True while the workers should keep running.
+    std::atomic<bool> _running = false;
+    /// @brief The number of workers that are blocked waiting for work.
+    std::atomic<Count> _sleepingWorkers = 0;
+    /// @brief The status of the pool.
+    mutable ThreadPoolTypes::Status _status = {0, 0, 0, 0};
+
+    /// @brief The number of tasks to submit so that every worker can take part in running a range.
+    size_t helperCount(const ThreadPoolTypes::Range &range, const size_t chunkSize) const {
+        const size_t chunks = (range.end - range.begin + chunkSize - 1) / chunkSize;
+        return std::min(chunks - 1, _workers.size());
+    }
+    /// @brief Queue a task on the calling worker's deque or the injection queue and wake a worker to run it.
+    ErrorType enqueue(ThreadPoolTypes::Task *task);
+    /// @brief Find a task to run. Checks the calling worker's own deque, then the injection queue, then steals from other workers.
+    ThreadPoolTypes::Task *findTask(ThreadPoolTypes::Worker *self);
+    /// @brief Run one queued task if there is one. Used by Task::wait() to help instead of sleeping.
+    bool runPendingTask();
+    /// @brief Wake one sleeping worker if there are any.
+    void wakeWorker();
+};
+
+#endif // __THREAD_POOL_HPP__
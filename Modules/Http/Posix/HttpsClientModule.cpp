@@ -16,12 +16,11 @@
 
 ErrorType HttpsClient::connectTo(std::string_view hostname, const Port port, const IpTypes::Protocol protocol, const IpTypes::Version version, const Milliseconds timeout) {
     assert(nullptr != _network);
-    ErrorType callbackError = ErrorType::Failure;
-    volatile bool doneConnecting = false;
-    Id thread;
-    OperatingSystem::Instance().currentThreadId(thread);
+    EventQueue::Future<> connected;
+
+    auto connectCb = [&, promise = connected.promise()]() -> ErrorType {
+        ErrorType callbackError = ErrorType::Failure;
 
-    auto connectCb = [&, thread]() -> ErrorType {
         disconnect();
 
         if (PSA_SUCCESS == psa_crypto_init()) {
@@ -77,8 +76,7 @@ ErrorType HttpsClient::connectTo(std::string_view hostname, const Port port, con
         }
 
         callbackError == ErrorType::Success ? _connected = true : _connected = false;
-        doneConnecting = true;
-        OperatingSystem::Instance().unblock(thread);
+        promise.complete(callbackError);
         return callbackError;
     };
 
@@ -88,21 +86,22 @@ ErrorType HttpsClient::connectTo(std::string_view hostname, const Port port, con
         return error;
     }
 
-    while (!doneConnecting && ErrorType::LimitReached == OperatingSystem::Instance().block());
+    if (ErrorType::Success != (error = connected.wait())) {
+        return error;
+    }
 
-    return callbackError;
+    return connected.result();
 }
 
 ErrorType HttpsClient::disconnect() {
     assert(nullptr != _network);
 
     if (_connected) {
-        ErrorType callbackError = ErrorType::Failure;
-        volatile bool doneDisconnecting = false;
-        Id thread;
-        OperatingSystem::Instance().currentThreadId(thread);
+        EventQueue::Future<> disconnected;
+
+        auto disconnectCb = [&, promise = disconnected.promise()]() -> ErrorType {
+            ErrorType callbackError = ErrorType::Failure;
 
-        auto disconnectCb = [&, thread]() -> ErrorType {
             if (0 == mbedtls_ssl_close_notify(&_ssl)) {
                 callbackError = ErrorType::Success;
             }
@@ -111,8 +110,7 @@ ErrorType HttpsClient::disconnect() {
             freeSslContexts();
 
             _connected = false;
-            OperatingSystem::Instance().unblock(thread);
-            doneDisconnecting = true;
+            promise.complete(callbackError);
             return callbackError;
         };
 
@@ -122,9 +120,11 @@ ErrorType HttpsClient::disconnect() {
             return error;
         }
 
-        while (!doneDisconnecting && ErrorType::LimitReached == OperatingSystem::Instance().block());
+        if (ErrorType::Success != (error = disconnected.wait())) {
+            return error;
+        }
 
-        return callbackError;
+        return disconnected.result();
     }
     else {
         return ErrorType::Success;
@@ -133,12 +133,11 @@ ErrorType HttpsClient::disconnect() {
 
 ErrorType HttpsClient::sendBlocking(const HttpTypes::Request &request, const Milliseconds timeout) {
     assert(nullptr != _network);
-    ErrorType callbackError = ErrorType::Failure;;
-    volatile bool doneSending = false;
-    Id thread;
-    OperatingSystem::Instance().currentThreadId(thread);
+    EventQueue::Future<> sent;
+
+    auto sendCb = [&, promise = sent.promise()]() -> ErrorType {
+        ErrorType callbackError = ErrorType::Failure;
 
-    auto sendCb = [&, thread]() -> ErrorType {
         //Big enough that hopefully the string doesn't have to reallocate.
         constexpr Bytes headerSize = 512;
         std::string frame(headerSize + request.messageBody.size(), 0);
@@ -177,8 +176,7 @@ ErrorType HttpsClient::sendBlocking(const HttpTypes::Request &request, const Mil
         } while (needToTryAgain || (noFatalErrorsOccured && frameNotFullyWritten));
 
         noFatalErrorsOccured ? callbackError = ErrorType::Success : callbackError = ErrorType::Failure;
-        OperatingSystem::Instance().unblock(thread);
-        doneSending = true;
+        promise.complete(callbackError);
         return callbackError;
     };
 
@@ -188,22 +186,23 @@ ErrorType HttpsClient::sendBlocking(const HttpTypes::Request &request, const Mil
         return error;
     }
 
-    while (!doneSending && ErrorType::LimitReached == OperatingSystem::Instance().block());
+    if (ErrorType::Success != (error = sent.wait())) {
+        return error;
+    }
 
-    return callbackError;
+    return sent.result();
 }
 
 ErrorType HttpsClient::receiveBlocking(HttpTypes::Response &response, const Milliseconds timeout) {
     assert(nullptr != _network);
     const Bytes messageBodySize = response.messageBody.size();
     assert(messageBodySize > 0);
-    ErrorType callbackError = ErrorType::Success;
     Bytes read = 0;
-    volatile bool doneReceiving = false;
-    Id thread;
-    OperatingSystem::Instance().currentThreadId(thread);
+    EventQueue::Future<> received;
+
+    auto receiveCallback = [&, promise = received.promise()]() -> ErrorType {
+        ErrorType callbackError = ErrorType::Success;
 
-    auto receiveCallback = [&, thread]() -> ErrorType {
         auto networkReceiveFunction = [&](std::string &buffer, const Milliseconds timeout) -> ErrorType {
             mbedtls_ssl_conf_read_timeout(&_conf, timeout);
             int ret = mbedtls_ssl_read(&_ssl, reinterpret_cast<uint8_t *>(&buffer[0]), buffer.size());
@@ -285,8 +284,7 @@ ErrorType HttpsClient::receiveBlocking(HttpTypes::Response &response, const Mill
             response.messageBody.resize(read);
         }
 
-        doneReceiving = true;
-        OperatingSystem::Instance().unblock(thread);
+        promise.complete(callbackError);
         return callbackError;
     };
 
@@ -296,9 +294,11 @@ ErrorType HttpsClient::receiveBlocking(HttpTypes::Response &response, const Mill
         return error;
     }
 
-    while (!doneReceiving && ErrorType::LimitReached == OperatingSystem::Instance().block());
+    if (ErrorType::Success != (error = received.wait())) {
+        return error;
+    }
 
-    return callbackError;
+    return received.result();
 }
 
 ErrorType HttpsClient::sendNonBlocking(const std::shared_ptr<HttpTypes::Request> request, const Milliseconds timeout, std::function<void(const ErrorType error, const Bytes bytesWritten)> callback) {
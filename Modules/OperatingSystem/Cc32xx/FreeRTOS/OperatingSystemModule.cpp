@@ -247,6 +247,62 @@ ErrorType OperatingSystem::decrementSemaphore(const std::array<char, OperatingSy
 #endif
 }
 
+ErrorType OperatingSystem::createSemaphore(const Count max, const Count initial, const std::array<char, OperatingSystemTypes::MaxSemaphoreNameLength> &name, Id &semaphore) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::deleteSemaphore(const Id semaphore) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::waitSemaphore(const Id semaphore, const Milliseconds timeout) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::incrementSemaphore(const Id semaphore) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::decrementSemaphore(const Id semaphore) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::createMutex(Id &mutex, const bool priorityInheritance) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::deleteMutex(const Id mutex) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::lockMutex(const Id mutex, const Milliseconds timeout) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::unlockMutex(const Id mutex) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::createReadWriteLock(Id &lock) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::deleteReadWriteLock(const Id lock) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::lockRead(const Id lock, const Milliseconds timeout) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::lockWrite(const Id lock, const Milliseconds timeout) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::unlockReadWriteLock(const Id lock) {
+    return ErrorType::NotImplemented;
+}
+
 ErrorType OperatingSystem::createTimer(Id &timer, const Milliseconds period, const bool autoReload, std::function<void(void)> callback) {
 #if configUSE_TIMERS == 1
 
@@ -329,6 +385,22 @@ ErrorType OperatingSystem::stopTimer(const Id timer, const Milliseconds timeout)
 #endif
 }
 
+ErrorType OperatingSystem::createPeriodicTask(Id &task, const Microseconds period, const Microseconds spin) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::deletePeriodicTask(const Id task) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::waitUntilNextPeriod(const Id task) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::periodicTaskStatistics(const Id task, OperatingSystemTypes::PeriodicTaskStatistics &statistics) {
+    return ErrorType::NotImplemented;
+}
+
 ErrorType OperatingSystem::createQueue(const std::array<char, OperatingSystemTypes::MaxQueueNameLength> &name, const Bytes size, const Count length) {
     QueueHandle_t handle = nullptr;
 
@@ -435,6 +507,20 @@ ErrorType OperatingSystem::getSystemTime(UnixTime &currentSystemUnixTime) {
     return ErrorType::Success;
 }
 
+ErrorType OperatingSystem::getSystemTime(Microseconds &currentSystemTime) {
+    currentSystemTime = static_cast<Microseconds>(time(nullptr)) * 1000000;
+    return ErrorType::Success;
+}
+
+ErrorType OperatingSystem::monotonicTime(Nanoseconds &time) {
+    //The time out state counts how many times the tick count has overflowed so the ticks can be extended to 64 bits.
+    TimeOut_t now;
+    vTaskSetTimeOutState(&now);
+    const uint64_t ticks = (static_cast<uint64_t>(now.xOverflowCount) << (8 * sizeof(TickType_t))) + now.xTimeOnEntering;
+    time = ticks * (1000000000 / configTICK_RATE_HZ);
+    return ErrorType::Success;
+}
+
 ErrorType OperatingSystem::getSystemTick(Ticks &currentSystemTick) {
     currentSystemTick = static_cast<Ticks>(xTaskGetTickCount());
     return ErrorType::Success;
@@ -506,6 +592,19 @@ ErrorType OperatingSystem::memoryRegionUsage(OperatingSystemTypes::MemoryRegionI
     return error;
 }
 
+ErrorType OperatingSystem::processUsage(OperatingSystemTypes::ProcessUsage &usage) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::threadUsage(OperatingSystemTypes::ThreadInfo &thread) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::onlineCores(Count &cores) {
+    cores = 1;
+    return ErrorType::Success;
+}
+
 ErrorType OperatingSystem::uptime(Seconds &uptime) {
     static Seconds sinceLastRollover = 0;
 
@@ -590,6 +689,53 @@ ErrorType OperatingSystem::block() {
     return error;
 }
 
+ErrorType OperatingSystem::blockUntil(const Nanoseconds time) {
+    Id task;
+    ErrorType error = currentThreadId(task);
+
+    if (OperatingSystemTypes::NullId != task) {
+
+        for (auto &threadStruct : threads) {
+
+            if (threadStruct.threadId == task) {
+                Nanoseconds now;
+                monotonicTime(now);
+                constexpr Nanoseconds tickPeriod = 1000000000 / configTICK_RATE_HZ;
+                //Round up so that the task doesn't wake before the time.
+                const Nanoseconds ticks = time > now ? (time - now + tickPeriod - 1) / tickPeriod : 0;
+                const TickType_t timeout = ticks < portMAX_DELAY ? static_cast<TickType_t>(ticks) : portMAX_DELAY - 1;
+
+                threadStruct.status = OperatingSystemTypes::ThreadStatus::Blocked;
+
+                auto peekBlockCount = []() -> BaseType_t {
+                    uint32_t notificationValue = 0;
+                    xTaskNotifyWait(0, 0, &notificationValue, 0);
+                    return notificationValue;
+                };
+
+                const uint32_t numberOfTimesPreviouslyUnblocked = peekBlockCount();
+                const bool threadHasBeenPreviouslyUnblocked = numberOfTimesPreviouslyUnblocked >= 1;
+
+                constexpr BaseType_t clearCountOnReturn = pdTRUE;
+                const uint32_t notifications = ulTaskNotifyTake(clearCountOnReturn, timeout);
+
+                if (threadHasBeenPreviouslyUnblocked) {
+                    error = ErrorType::LimitReached;
+                }
+                else if (0 == notifications) {
+                    error = ErrorType::Timeout;
+                }
+
+                threadStruct.status = OperatingSystemTypes::ThreadStatus::Active;
+
+                break;
+            }
+        }
+    }
+
+    return error;
+}
+
 ErrorType OperatingSystem::unblock(const Id task) {
     ErrorType error = ErrorType::NoData;
 
@@ -1,7 +1,7 @@
 //Modules
 #include "OperatingSystemModule.hpp"
 //Posix
-#include <sys/times.h> //For timesample and system tick queries
+#include <time.h> //For system time and tick queries
 #include <sys/syslimits.h> //For max semaphore name length
 
 #ifdef __cplusplus
@@ -241,6 +241,62 @@ ErrorType OperatingSystem::decrementSemaphore(const std::array<char, OperatingSy
     return ErrorType::Success;
 }
 
+ErrorType OperatingSystem::createSemaphore(const Count max, const Count initial, const std::array<char, OperatingSystemTypes::MaxSemaphoreNameLength> &name, Id &semaphore) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::deleteSemaphore(const Id semaphore) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::waitSemaphore(const Id semaphore, const Milliseconds timeout) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::incrementSemaphore(const Id semaphore) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::decrementSemaphore(const Id semaphore) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::createMutex(Id &mutex, const bool priorityInheritance) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::deleteMutex(const Id mutex) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::lockMutex(const Id mutex, const Milliseconds timeout) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::unlockMutex(const Id mutex) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::createReadWriteLock(Id &lock) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::deleteReadWriteLock(const Id lock) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::lockRead(const Id lock, const Milliseconds timeout) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::lockWrite(const Id lock, const Milliseconds timeout) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::unlockReadWriteLock(const Id lock) {
+    return ErrorType::NotImplemented;
+}
+
 ErrorType OperatingSystem::createTimer(Id &timer, const Milliseconds period, const bool autoReload, std::function<void(void)> callback) {
     dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
     dispatch_source_t dispatchTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, queue);
@@ -334,6 +390,22 @@ ErrorType OperatingSystem::stopTimer(const Id timer, const Milliseconds timeout)
     return ErrorType::Success;
 }
 
+ErrorType OperatingSystem::createPeriodicTask(Id &task, const Microseconds period, const Microseconds spin) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::deletePeriodicTask(const Id task) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::waitUntilNextPeriod(const Id task) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::periodicTaskStatistics(const Id task, OperatingSystemTypes::PeriodicTaskStatistics &statistics) {
+    return ErrorType::NotImplemented;
+}
+
 ErrorType OperatingSystem::createQueue(const std::array<char, OperatingSystemTypes::MaxQueueNameLength> &name, const Bytes size, const Count length) {
     return ErrorType::NotImplemented;
 }
@@ -355,19 +427,34 @@ ErrorType OperatingSystem::getSystemTime(UnixTime &currentSystemUnixTime) {
     return ErrorType::Success;
 }
 
+ErrorType OperatingSystem::getSystemTime(Microseconds &currentSystemTime) {
+    struct timespec now;
+    if (-1 == clock_gettime(CLOCK_REALTIME, &now)) {
+        return fromPlatformError(errno);
+    }
+
+    currentSystemTime = static_cast<Microseconds>(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+    return ErrorType::Success;
+}
+
+ErrorType OperatingSystem::monotonicTime(Nanoseconds &time) {
+    time = clock_gettime_nsec_np(CLOCK_MONOTONIC);
+    return ErrorType::Success;
+}
+
 ErrorType OperatingSystem::getSystemTick(Ticks &currentSystemTicks) {
-    struct tms timeSample;
-    currentSystemTicks = static_cast<Ticks>(times(&timeSample));
+    //Ticks are milliseconds on CLOCK_MONOTONIC rather than clock ticks from times(), which are only 100Hz.
+    currentSystemTicks = static_cast<Ticks>(clock_gettime_nsec_np(CLOCK_MONOTONIC) / 1000000);
     return ErrorType::Success;
 }
 
 ErrorType OperatingSystem::ticksToMilliseconds(const Ticks ticks, Milliseconds &timeInMilliseconds) {
-    timeInMilliseconds = static_cast<Milliseconds>(ticks * (sysconf(_SC_CLK_TCK) / 1000));
+    timeInMilliseconds = static_cast<Milliseconds>(ticks);
     return ErrorType::Success;
 }
 
 ErrorType OperatingSystem::millisecondsToTicks(const Milliseconds milli, Ticks &ticks) {
-    ticks = static_cast<Ticks>((milli / 1000) * sysconf(_SC_CLK_TCK));
+    ticks = static_cast<Ticks>(milli);
     return ErrorType::Success;
 }
 
@@ -501,6 +588,25 @@ ErrorType OperatingSystem::memoryRegionUsage(OperatingSystemTypes::MemoryRegionI
     return error;
 }
 
+ErrorType OperatingSystem::processUsage(OperatingSystemTypes::ProcessUsage &usage) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::threadUsage(OperatingSystemTypes::ThreadInfo &thread) {
+    return ErrorType::NotImplemented;
+}
+
+ErrorType OperatingSystem::onlineCores(Count &cores) {
+    const long online = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (online < 1) {
+        return fromPlatformError(errno);
+    }
+
+    cores = static_cast<Count>(online);
+    return ErrorType::Success;
+}
+
 ErrorType OperatingSystem::uptime(Seconds &uptime) {
     const auto duration = std::chrono::steady_clock::now() - _startTime;
     uptime = std::chrono::duration_cast<std::chrono::seconds>(duration).count();
@@ -564,6 +670,58 @@ ErrorType OperatingSystem::block() {
     return error;
 }
 
+ErrorType OperatingSystem::blockUntil(const Nanoseconds time) {
+    Id task;
+    ErrorType error = currentThreadId(task);
+
+    if (OperatingSystemTypes::NullId != task) {
+
+        for (auto &threadStruct : threads) {
+
+            if (threadStruct.threadId == task) {
+                pthread_mutex_lock(&(threadStruct.mutex));
+                    
+                if (threadStruct.blockCount > -1) {
+                    threadStruct.blockCount++;
+                    threadStruct.status = OperatingSystemTypes::ThreadStatus::Blocked;
+
+                    //Condition variables time out on the wall clock so wait relative to the monotonic clock instead.
+                    while (threadStruct.status == OperatingSystemTypes::ThreadStatus::Blocked) {
+                        Nanoseconds now;
+                        monotonicTime(now);
+
+                        if (now >= time) {
+                            threadStruct.blockCount--;
+                            threadStruct.status = OperatingSystemTypes::ThreadStatus::Active;
+                            error = ErrorType::Timeout;
+                            break;
+                        }
+
+                        const struct timespec remaining = {
+                            .tv_sec = static_cast<time_t>((time - now) / 1000000000),
+                            .tv_nsec = static_cast<long>((time - now) % 1000000000)
+                        };
+                        pthread_cond_timedwait_relative_np(&threadStruct.conditionVariable, &(threadStruct.mutex), &remaining);
+                    }
+                }
+                else {
+                    error = ErrorType::LimitReached;
+                    threadStruct.blockCount = 0;
+                }
+
+                pthread_mutex_unlock(&(threadStruct.mutex));
+                
+                break;
+            }
+            else {
+                error = ErrorType::NoData;
+            }
+        }
+    }
+
+    return error;
+}
+
 ErrorType OperatingSystem::unblock(const Id task) {
     ErrorType error = ErrorType::NoData;
 
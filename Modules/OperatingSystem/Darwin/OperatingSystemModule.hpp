@@ -41,15 +41,35 @@ class OperatingSystem final : public OperatingSystemAbstraction, public Global<O
     ErrorType waitSemaphore(const std::array<char, OperatingSystemTypes::MaxSemaphoreNameLength> &name, const Milliseconds timeout) override;
     ErrorType incrementSemaphore(const std::array<char, OperatingSystemTypes::MaxSemaphoreNameLength> &name) override;
     ErrorType decrementSemaphore(const std::array<char, OperatingSystemTypes::MaxSemaphoreNameLength> &name) override;
+    ErrorType createSemaphore(const Count max, const Count initial, const std::array<char, OperatingSystemTypes::MaxSemaphoreNameLength> &name, Id &semaphore) override;
+    ErrorType deleteSemaphore(const Id semaphore) override;
+    ErrorType waitSemaphore(const Id semaphore, const Milliseconds timeout) override;
+    ErrorType incrementSemaphore(const Id semaphore) override;
+    ErrorType decrementSemaphore(const Id semaphore) override;
+    ErrorType createMutex(Id &mutex, const bool priorityInheritance) override;
+    ErrorType deleteMutex(const Id mutex) override;
+    ErrorType lockMutex(const Id mutex, const Milliseconds timeout) override;
+    ErrorType unlockMutex(const Id mutex) override;
+    ErrorType createReadWriteLock(Id &lock) override;
+    ErrorType deleteReadWriteLock(const Id lock) override;
+    ErrorType lockRead(const Id lock, const Milliseconds timeout) override;
+    ErrorType lockWrite(const Id lock, const Milliseconds timeout) override;
+    ErrorType unlockReadWriteLock(const Id lock) override;
     ErrorType createTimer(Id &timer, Milliseconds period, bool autoReload, std::function<void(void)> callback) override;
     ErrorType deleteTimer(const Id timer) override;
     ErrorType startTimer(Id timer, Milliseconds timeout) override;
     ErrorType stopTimer(Id timer, Milliseconds timeout) override;
+    ErrorType createPeriodicTask(Id &task, const Microseconds period, const Microseconds spin) override;
+    ErrorType deletePeriodicTask(const Id task) override;
+    ErrorType waitUntilNextPeriod(const Id task) override;
+    ErrorType periodicTaskStatistics(const Id task, OperatingSystemTypes::PeriodicTaskStatistics &statistics) override;
     ErrorType createQueue(const std::array<char, OperatingSystemTypes::MaxQueueNameLength> &name, const Bytes size, const Count length) override;
     ErrorType sendToQueue(const std::array<char, OperatingSystemTypes::MaxQueueNameLength> &name, const void *data, const Milliseconds timeout, const bool toFront, const bool fromIsr) override;
     ErrorType receiveFromQueue(const std::array<char, OperatingSystemTypes::MaxQueueNameLength> &name, void *buffer, const Milliseconds timeout, const bool fromIsr) override;
     ErrorType peekFromQueue(const std::array<char, OperatingSystemTypes::MaxQueueNameLength> &name, void *buffer, const Milliseconds timeout, const bool fromIsr) override;
     ErrorType getSystemTime(UnixTime &currentSystemUnixTime) override;
+    ErrorType getSystemTime(Microseconds &currentSystemTime) override;
+    ErrorType monotonicTime(Nanoseconds &time) override;
     ErrorType getSystemTick(Ticks &currentSystemTicks) override;
     ErrorType ticksToMilliseconds(const Ticks ticks, Milliseconds &timeInMilliseconds) override;
     ErrorType millisecondsToTicks(const Milliseconds milli, Ticks &ticks) override;
@@ -59,10 +79,14 @@ class OperatingSystem final : public OperatingSystemAbstraction, public Global<O
     ErrorType setTimeOfDay(const UnixTime utc, const int16_t timeZoneDifferenceUtc) override;
     ErrorType idlePercentage(Percent &idlePercent) override;
     ErrorType memoryRegionUsage(OperatingSystemTypes::MemoryRegionInfo &region) override;
+    ErrorType processUsage(OperatingSystemTypes::ProcessUsage &usage) override;
+    ErrorType threadUsage(OperatingSystemTypes::ThreadInfo &thread) override;
+    ErrorType onlineCores(Count &cores) override;
     ErrorType uptime(Seconds &uptime) override;
     ErrorType disableAllInterrupts() override;
     ErrorType enableAllInterrupts() override;
     ErrorType block() override;
+    ErrorType blockUntil(const Nanoseconds time) override;
     ErrorType unblock(const Id task) override;
     ErrorType getSystemMacAddress(std::array<char, NetworkTypes::MacAddressStringSize> &macAddress) override;
 
@@ -1,33 +1,163 @@
 //Modules
 #include "OperatingSystemModule.hpp"
-#include "MemoryPool.hpp"
 //C++
 #include <cstdio>
 //C
 #include <string.h>
 //Posix
-#include <sys/times.h>
 #include <sys/time.h>
 #include <limits.h>
 #include <fcntl.h>
 #include <sys/statvfs.h>
 #include <sys/stat.h>
-#include <signal.h> //For timers
+#include <sys/timerfd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <malloc.h>
+#include <sys/mman.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-void TimerCallback(union sigval val);
+void *TimerServiceThread(void *arguments);
 
 #ifdef __cplusplus
 }
 #endif
 
-//Declared global to keep the memory pool header out of the hpp file otherwise it creates some unwanted dependancies
-//(the Event library would need to link with memory pool).
 namespace {
-    MemoryPool<timer_t, sizeof(timer_t)*8> timerIdPool;
+    /// @brief The Id of the calling thread, or NullId if the thread was not created by createThread.
+    thread_local Id CurrentThreadId = OperatingSystemTypes::NullId;
+
+    /// @brief The absolute time on CLOCK_MONOTONIC that is timeout milliseconds from now.
+    struct timespec deadlineAfter(const Milliseconds timeout) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += timeout / 1000;
+        deadline.tv_nsec += (timeout % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+
+        return deadline;
+    }
+
+    /// @brief The current time on CLOCK_MONOTONIC in nanoseconds.
+    uint64_t monotonicNanoseconds() {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return static_cast<uint64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+    }
+
+    /// @brief Sleep until an absolute time on CLOCK_MONOTONIC in nanoseconds.
+    void sleepUntil(const uint64_t wakeTime) {
+        const struct timespec deadline = {
+            .tv_sec = static_cast<time_t>(wakeTime / 1000000000),
+            .tv_nsec = static_cast<long>(wakeTime % 1000000000)
+        };
+
+        //The deadline is absolute so being interrupted by a signal and going back to sleep doesn't make us late.
+        while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr));
+    }
+
+    /**
+     * @brief Read a file in /proc from the beginning.
+     * @details The file is opened the first time it is read and left open so that reading it again is a single pread. Only as much of
+     *          the file as fits in the buffer is read.
+     * @returns The number of bytes read. The buffer is null terminated. -1 if the file could not be read.
+     */
+    template <size_t size>
+    ssize_t readProcFile(int &fileDescriptor, const char *path, std::array<char, size> &buffer) {
+        if (-1 == fileDescriptor) {
+            if (-1 == (fileDescriptor = open(path, O_RDONLY | O_CLOEXEC))) {
+                return -1;
+            }
+        }
+
+        const ssize_t bytesRead = pread(fileDescriptor, buffer.data(), buffer.size() - 1, 0);
+        buffer[bytesRead > 0 ? bytesRead : 0] = '\0';
+
+        return bytesRead;
+    }
+
+    /// @brief Get the value of a field in a /proc file that is formatted as "field: value" such as /proc/meminfo or /proc/self/status.
+    uint64_t procFileField(const char *contents, const char *field) {
+        const char *value = strstr(contents, field);
+        return nullptr == value ? 0 : strtoull(value + strlen(field), nullptr, 10);
+    }
+
+    /// @brief SCHED_DEADLINE is not defined by all versions of glibc.
+    constexpr int SchedulingPolicyDeadline = 6;
+
+    /**
+     * @struct SchedulingAttributes
+     * @brief The kernel's struct sched_attr. Not all versions of glibc define it.
+     */
+    struct SchedulingAttributes {
+        uint32_t size;
+        uint32_t policy;
+        uint64_t flags;
+        int32_t nice;
+        uint32_t priority;
+        uint64_t runtime;
+        uint64_t deadline;
+        uint64_t period;
+    };
+
+    /// @brief glibc does not provide a wrapper for futex.
+    long futex(uint32_t &word, const int operation, const uint32_t value, const struct timespec *deadline) {
+        return syscall(SYS_futex, &word, operation, value, deadline, nullptr, FUTEX_BITSET_MATCH_ANY);
+    }
+
+    long futex(std::atomic<uint32_t> &word, const int operation, const uint32_t value, const struct timespec *deadline) {
+        return futex(*reinterpret_cast<uint32_t *>(&word), operation, value, deadline);
+    }
+
+    /// @brief Values of Thread::wakeState
+    constexpr uint32_t WakeEmpty = 0;    ///< No unblock is pending.
+    constexpr uint32_t WakeNotified = 1; ///< The thread has been unblocked.
+    constexpr uint32_t WakeParked = 2;   ///< The thread is asleep in the kernel and needs a futex wake.
+    /// @brief The most pause instructions run between checks of the wake state while spinning.
+    constexpr uint32_t MaxPausesPerCheck = 64;
+
+    /// @brief Tell the core we are spinning so that it can give resources to its sibling hyperthread and save power.
+    inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+        asm volatile("yield" ::: "memory");
+#endif
+    }
+
+    /**
+     * @brief Spin with exponential backoff until the wake state is notified or the budget runs out.
+     * @returns true if the thread was notified while spinning.
+     */
+    bool spinUntilNotified(std::atomic_ref<uint32_t> &wakeState, const Microseconds budget) {
+        if (0 == budget) {
+            return false;
+        }
+
+        const auto giveUp = std::chrono::steady_clock::now() + std::chrono::microseconds(budget);
+        uint32_t pauses = 1;
+
+        do {
+            if (WakeNotified == wakeState.load(std::memory_order_acquire)) {
+                return true;
+            }
+
+            for (uint32_t i = 0; i < pauses; i++) {
+                cpuRelax();
+            }
+
+            //Back off so that a long spin doesn't keep pulling the cache line away from the thread that is going to write it.
+            pauses = std::min(pauses * 2, MaxPausesPerCheck);
+        } while (std::chrono::steady_clock::now() < giveUp);
+
+        return false;
+    }
 }
 
 ErrorType OperatingSystem::delay(const Milliseconds delay) {
@@ -45,21 +175,53 @@ ErrorType OperatingSystem::startScheduler() {
 }
 
 ErrorType OperatingSystem::createThread(const OperatingSystemTypes::Priority priority, const std::array<char, OperatingSystemTypes::MaxThreadNameLength> &name, void * arguments, const Bytes stackSize, void *(*startFunction)(void *), Id &number) {
+    return createThread(priority, name, arguments, stackSize, startFunction, number, RealTimeOptions());
+}
+
+ErrorType OperatingSystem::createThread(const OperatingSystemTypes::Priority priority, const std::array<char, OperatingSystemTypes::MaxThreadNameLength> &name, void * arguments, const Bytes stackSize, void *(*startFunction)(void *), Id &number, const RealTimeOptions &options) {
+    const bool isDeadline = RealTimeOptions::Policy::Deadline == options.policy;
+    if (isDeadline && (0 == options.runtime || options.runtime > options.deadline || options.deadline > options.period)) {
+        return ErrorType::InvalidParameter;
+    }
+
     pthread_attr_t attr;
     sched_param param;
     int res;
     static Id nextThreadId = OperatingSystemTypes::NullId + 1;
 
+    //The stack is mapped here instead of by pthreads so that it can be filled with a pattern to measure how much of it is used.
+    //A guard page below the stack catches overflows.
+    const Bytes pageSize = sysconf(_SC_PAGESIZE);
+    const Bytes usableStackSize = ((std::max<Bytes>(stackSize, PTHREAD_STACK_MIN) + pageSize - 1) / pageSize) * pageSize;
+    const Bytes stackMappingSize = usableStackSize + pageSize;
+    void *stackMapping = mmap(nullptr, stackMappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+    if (MAP_FAILED == stackMapping) {
+        return fromPlatformError(errno);
+    }
+    mprotect(stackMapping, pageSize, PROT_NONE);
+    uint8_t *const stack = static_cast<uint8_t *>(stackMapping) + pageSize;
+    //Filling the stack also prefaults it so that the thread never takes a page fault for its stack.
+    std::fill_n(reinterpret_cast<uint32_t *>(stack), usableStackSize / sizeof(uint32_t), StackFillPattern);
+    if (options.lockStack && 0 != mlock(stack, usableStackSize)) {
+        const ErrorType error = fromPlatformError(errno);
+        munmap(stackMapping, stackMappingSize);
+        return error;
+    }
+
     res = pthread_attr_init(&attr);
     assert(0 == res);
     pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
-    pthread_attr_setstacksize(&attr, stackSize);
-    pthread_attr_setschedpolicy(&attr, SCHED_RR);
+    pthread_attr_setstack(&attr, stack, usableStackSize);
+    //The deadline policy can't be set with pthread attributes so the thread starts with the normal policy and sets it itself.
+    pthread_attr_setschedpolicy(&attr, isDeadline ? SCHED_OTHER : RealTimeOptions::Policy::Fifo == options.policy ? SCHED_FIFO : SCHED_RR);
     pthread_attr_getschedparam(&attr, &param);
-    param.sched_priority = toPosixPriority(priority);
+    param.sched_priority = isDeadline ? 0 : toPosixPriority(priority);
     pthread_attr_setschedparam(&attr, &param);
     pthread_attr_setscope(&attr, PTHREAD_SCOPE_PROCESS);
     pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    if (CPU_COUNT(&options.affinity) > 0) {
+        pthread_attr_setaffinity_np(&attr, sizeof(options.affinity), &options.affinity);
+    }
 
     //On Linux, the start function is called before pthread_create returns so we have to add in an init function to make sure
     //that the details of thread are properly saved before the thread code runs. For example, if a thread calls currentThreadId,
@@ -68,12 +230,34 @@ ErrorType OperatingSystem::createThread(const OperatingSystemTypes::Priority pri
     struct InitThreadArgs {
         void *arguments = nullptr;
         void *(*startFunction)(void *);
-        pthread_t *const threadId = nullptr;
+        Thread *const thread = nullptr;
+        const Id id = OperatingSystemTypes::NullId;
+        const SchedulingAttributes *const deadline = nullptr;
+        ErrorType *const deadlineError = nullptr;
+        const Id deadlineSet = OperatingSystemTypes::NullId;
     };
     auto initThread = [](void *arguments) -> void * {
         InitThreadArgs *initThreadArgs = static_cast<InitThreadArgs *>(arguments);
-        *(initThreadArgs->threadId) = pthread_self();
+        Thread &thread = *(initThreadArgs->thread);
+        thread.tid = gettid();
+        CurrentThreadId = initThreadArgs->id;
+
+        //The creator waits to find out if the deadline policy could be set. Nothing it owns can be touched once it's been told.
+        if (nullptr != initThreadArgs->deadline) {
+            const bool deadlineWasSet = (0 == syscall(SYS_sched_setattr, 0, initThreadArgs->deadline, 0));
+            *(initThreadArgs->deadlineError) = deadlineWasSet ? ErrorType::Success : fromPlatformError(errno);
+            OperatingSystem::Instance().incrementSemaphore(initThreadArgs->deadlineSet);
+
+            if (!deadlineWasSet) {
+                delete initThreadArgs;
+                return nullptr;
+            }
+        }
+
         (initThreadArgs->startFunction)(initThreadArgs->arguments);
+        //The CPU clock and /proc entries for the thread go away when it exits so save what it used.
+        getrusage(RUSAGE_THREAD, &thread.usageAtExit);
+        thread.exited = true;
         delete initThreadArgs;
         return nullptr;
     };
@@ -81,35 +265,86 @@ ErrorType OperatingSystem::createThread(const OperatingSystemTypes::Priority pri
     Thread newThread = {
         .name = name,
         .threadId = nextThreadId,
-        .blockCount = 0,
-        .status = OperatingSystemTypes::ThreadStatus::Active
+        .status = OperatingSystemTypes::ThreadStatus::Active,
+        .wakeState = WakeEmpty,
+        .spinBudget = _newThreadSpinBudget,
+        .stackMapping = static_cast<uint8_t *>(stackMapping),
+        .stackMappingSize = stackMappingSize,
+        .stackSize = usableStackSize
     };
-    pthread_mutex_init(&(newThread.mutex), nullptr);
-    pthread_cond_init(&(newThread.conditionVariable), nullptr);
 
     threads.at(toThreadIndex(nextThreadId)) = newThread;
 
+    const SchedulingAttributes deadline = {
+        .size = sizeof(SchedulingAttributes),
+        .policy = SchedulingPolicyDeadline,
+        .flags = 0,
+        .nice = 0,
+        .priority = 0,
+        .runtime = options.runtime * 1000,
+        .deadline = options.deadline * 1000,
+        .period = options.period * 1000
+    };
+    ErrorType deadlineError = ErrorType::Success;
+    Id deadlineSet = OperatingSystemTypes::NullId;
+    if (isDeadline && ErrorType::Success != (deadlineError = createSemaphore(1, 0, {""}, deadlineSet))) {
+        releaseThreadResources(threads.at(toThreadIndex(nextThreadId)));
+        threads.at(toThreadIndex(nextThreadId)) = Thread();
+        pthread_attr_destroy(&attr);
+        return deadlineError;
+    }
+
     InitThreadArgs *initThreadArgs = new InitThreadArgs {
         .arguments = arguments,
         .startFunction = startFunction,
-        .threadId = &threads.at(toThreadIndex(nextThreadId)).posixThreadId,
+        .thread = &threads.at(toThreadIndex(nextThreadId)),
+        .id = nextThreadId,
+        .deadline = isDeadline ? &deadline : nullptr,
+        .deadlineError = isDeadline ? &deadlineError : nullptr,
+        .deadlineSet = deadlineSet
     };
 
     pthread_t thread;
     ErrorType error = ErrorType::Failure;
-    const bool threadWasCreated = (0 == (res = pthread_create(&thread, &attr, initThread, initThreadArgs)));
+    bool threadWasCreated = (0 == (res = pthread_create(&thread, &attr, initThread, initThreadArgs)));
+    if (isDeadline) {
+        if (threadWasCreated) {
+            //Wait as long as it takes. The thread sets its own policy first thing so this is never long.
+            while (ErrorType::Timeout == waitSemaphore(deadlineSet, 1000));
+            if (ErrorType::Success != deadlineError) {
+                pthread_join(thread, nullptr);
+                threadWasCreated = false;
+            }
+        }
+        deleteSemaphore(deadlineSet);
+    }
+
     if (threadWasCreated) {
+        //Set by us rather than the new thread so that joinThread() never reads them before they are written.
+        threads.at(toThreadIndex(nextThreadId)).posixThreadId = thread;
+        pthread_getcpuclockid(thread, &threads.at(toThreadIndex(nextThreadId)).cpuClock);
         number = newThread.threadId;
+        _status.memoryRegion.emplace_back(name);
+        _status.threads.push_back({
+            .name = name,
+            .id = newThread.threadId,
+            .cpuTime = 0,
+            .voluntaryContextSwitches = 0,
+            .involuntaryContextSwitches = 0,
+            .stackSize = usableStackSize,
+            .stackHighWaterMark = 0
+        });
         _status.threadCount++;
         nextThreadId++;
         error = ErrorType::Success;
     }
     else {
-        deleteThread(name);
-        error = fromPlatformError(res);
+        //The thread was never counted so it doesn't need to be deleted. The slot is reused by the next thread that is created.
+        releaseThreadResources(threads.at(toThreadIndex(nextThreadId)));
+        threads.at(toThreadIndex(nextThreadId)) = Thread();
+        error = (0 != res) ? fromPlatformError(res) : deadlineError;
     }
 
-    _status.threadCount = threads.size();
     pthread_attr_destroy(&attr);
 
     return error;
@@ -118,6 +353,22 @@ ErrorType OperatingSystem::createThread(const OperatingSystemTypes::Priority pri
 //I want to use pthreads since I like the portability of them, however, ESP does not implement pthread_kill.
 //The work around is to set the thread in the deatched state and then have the main loops of each thread regularly check their status
 //to see if they have been terminated by the operating system, which will set isTerminated when the thread is detached.
+ErrorType OperatingSystem::lockMemory() {
+    if (0 != mlockall(MCL_CURRENT | MCL_FUTURE)) {
+        return fromPlatformError(errno);
+    }
+
+    return ErrorType::Success;
+}
+
+ErrorType OperatingSystem::unlockMemory() {
+    if (0 != munlockall()) {
+        return fromPlatformError(errno);
+    }
+
+    return ErrorType::Success;
+}
+
 ErrorType OperatingSystem::deleteThread(const std::array<char, OperatingSystemTypes::MaxThreadNameLength> &name) {
     ErrorType error = ErrorType::NoData;
 
@@ -134,6 +385,7 @@ ErrorType OperatingSystem::deleteThread(const std::array<char, OperatingSystemTy
                     return 0 == strncmp(region.name.data(), name.data(), OperatingSystemTypes::MaxMemoryRegionNameLength);
                 }),
             _status.memoryRegion.end());
+        std::erase_if(_status.threads, [&it](const OperatingSystemTypes::ThreadInfo &thread) { return thread.id == it->threadId; });
         
         _status.threadCount--;
         error = ErrorType::Success;
@@ -148,7 +400,24 @@ ErrorType OperatingSystem::joinThread(const std::array<char, OperatingSystemType
         return ErrorType::NoData;
     }
 
-    return fromPlatformError(pthread_join(threads[toThreadIndex(thread)].posixThreadId, nullptr));
+    const int res = pthread_join(threads[toThreadIndex(thread)].posixThreadId, nullptr);
+    if (0 == res) {
+        //Take one last sample while the stack still exists so that the statistics for the thread are kept after it's gone.
+        for (auto &threadInfo : _status.threads) {
+            if (threadInfo.id == thread) {
+                threadUsage(threadInfo);
+            }
+        }
+        for (auto &memoryRegion : _status.memoryRegion) {
+            if (0 == strncmp(memoryRegion.name.data(), name.data(), OperatingSystemTypes::MaxMemoryRegionNameLength)) {
+                memoryRegionUsage(memoryRegion);
+            }
+        }
+
+        releaseThreadResources(threads[toThreadIndex(thread)]);
+    }
+
+    return fromPlatformError(res);
 }
 
 ErrorType OperatingSystem::threadId(const std::array<char, OperatingSystemTypes::MaxThreadNameLength> &name, Id &thread) {
@@ -162,15 +431,12 @@ ErrorType OperatingSystem::threadId(const std::array<char, OperatingSystemTypes:
 }
 
 ErrorType OperatingSystem::currentThreadId(Id &thread) const {
-    pthread_t task = pthread_self();
-    auto it = std::find_if(threads.begin(), threads.end(), [task](const auto &thread) { return thread.posixThreadId == task; });
-    if (threads.end() == it) {
-        thread = OperatingSystemTypes::NullId;
+    thread = CurrentThreadId;
+
+    if (OperatingSystemTypes::NullId == thread) {
         return ErrorType::NoData;
     }
 
-    thread = it->threadId;
-
     return ErrorType::Success;
 }
 
@@ -192,514 +458,1277 @@ ErrorType OperatingSystem::isDeleted(const std::array<char, OperatingSystemTypes
 }
 
 ErrorType OperatingSystem::createSemaphore(const Count max, const Count initial, const std::array<char, OperatingSystemTypes::MaxSemaphoreNameLength> &name) {
-    //The internal name is the name with a leading / to make it a valid semaphore name on POSIX systems.
-    //For all other purposes inside this operating system abstraction, the name should be used directly.
-    std::array<char, OperatingSystemTypes::MaxSemaphoreNameLength+1> internalName = {'/'};
-    strncat(internalName.data(), name.data(), OperatingSystemTypes::MaxSemaphoreNameLength);
-
-    if (internalName.size() > NAME_MAX-4) {
-        return ErrorType::InvalidParameter;
-    }
-
-    //On POSIX systems, a created semaphore has peristence within the kernel until it is removed.
-    //So delete old semaphores first and then create the new one since we specify O_EXCL as a flag.
-    deleteSemaphore(name); //Using name and not internalName is NOT a bug.
-    sem_t *semaphore = sem_open(internalName.data(), O_CREAT | O_EXCL, S_IRWXU, initial);
-    if (SEM_FAILED == semaphore) {
-        return fromPlatformError(errno);
-    }
-    else {
-        semaphores[name] = semaphore;
-        return ErrorType::Success;
-    }
+    Id unused;
+    return createSemaphore(max, initial, name, unused);
 }
 
 ErrorType OperatingSystem::deleteSemaphore(const std::array<char, OperatingSystemTypes::MaxSemaphoreNameLength> &name) {
-    std::array<char, OperatingSystemTypes::MaxSemaphoreNameLength+1> internalName = {'/'};
-    strncat(internalName.data(), name.data(), OperatingSystemTypes::MaxSemaphoreNameLength);
+    pthread_mutex_lock(&_semaphoreMutex);
+    const auto itr = semaphores.find(name);
+    const Id semaphore = semaphores.end() == itr ? OperatingSystemTypes::NullId : itr->second;
+    pthread_mutex_unlock(&_semaphoreMutex);
 
-    if (0 != sem_unlink(internalName.data())) {
-        return fromPlatformError(errno);
-    }
-
-    semaphores.erase(name);
-
-    return ErrorType::Success;
+    return deleteSemaphore(semaphore);
 }
 
 ErrorType OperatingSystem::waitSemaphore(const std::array<char, OperatingSystemTypes::MaxSemaphoreNameLength> &name, const Milliseconds timeout) {
-    Milliseconds timeRemaining = timeout;
-    constexpr Milliseconds delayTime = 1;
-    int result;
-
-    if (!semaphores.contains(name)) {
-        return ErrorType::NoData;
-    }
+    pthread_mutex_lock(&_semaphoreMutex);
+    const auto itr = semaphores.find(name);
+    const Id semaphore = semaphores.end() == itr ? OperatingSystemTypes::NullId : itr->second;
+    pthread_mutex_unlock(&_semaphoreMutex);
 
-    do {
-        if (0 != (result = sem_wait(semaphores[name]))) {
-            if (timeRemaining > 0) {
-                delay(delayTime);
-            }
-            timeRemaining >= delayTime ? timeRemaining -= delayTime : timeRemaining = 0;
-            if (0 == timeRemaining) {
-                return ErrorType::Timeout;
-            }
-        }
-    } while (EAGAIN == errno);
-
-
-    if (0 != result) {
-        return fromPlatformError(errno);
-    }
-
-    return ErrorType::Success;
+    return waitSemaphore(semaphore, timeout);
 }
 
 ErrorType OperatingSystem::incrementSemaphore(const std::array<char, OperatingSystemTypes::MaxSemaphoreNameLength> &name) {
-    if (!semaphores.contains(name)) {
-        return ErrorType::NoData;
-    }
+    pthread_mutex_lock(&_semaphoreMutex);
+    const auto itr = semaphores.find(name);
+    const Id semaphore = semaphores.end() == itr ? OperatingSystemTypes::NullId : itr->second;
+    pthread_mutex_unlock(&_semaphoreMutex);
 
-    std::array<char, OperatingSystemTypes::MaxSemaphoreNameLength+1> internalName = {'/'};
-    strncat(internalName.data(), name.data(), OperatingSystemTypes::MaxSemaphoreNameLength);
+    return incrementSemaphore(semaphore);
+}
 
-    if (0 != sem_post(semaphores[name])) {
-        return fromPlatformError(errno);
-    }
+ErrorType OperatingSystem::decrementSemaphore(const std::array<char, OperatingSystemTypes::MaxSemaphoreNameLength> &name) {
+    pthread_mutex_lock(&_semaphoreMutex);
+    const auto itr = semaphores.find(name);
+    const Id semaphore = semaphores.end() == itr ? OperatingSystemTypes::NullId : itr->second;
+    pthread_mutex_unlock(&_semaphoreMutex);
 
-    return ErrorType::Success;
+    return decrementSemaphore(semaphore);
 }
 
-ErrorType OperatingSystem::decrementSemaphore(const std::array<char, OperatingSystemTypes::MaxSemaphoreNameLength> &name) {
-    if (!semaphores.contains(name)) {
-        return ErrorType::NoData;
+ErrorType OperatingSystem::createSemaphore(const Count max, const Count initial, const std::array<char, OperatingSystemTypes::MaxSemaphoreNameLength> &name, Id &semaphore) {
+    if (0 == max || initial > max) {
+        return ErrorType::InvalidParameter;
     }
 
-    if (0 != sem_trywait(semaphores[name])) {
-        return fromPlatformError(errno);
-    }
+    //Creating a semaphore with the name of one that already exists replaces it.
+    deleteSemaphore(name);
 
-    return ErrorType::Success;
-}
+    pthread_mutex_lock(&_semaphoreMutex);
+    ErrorType error = ErrorType::LimitReached;
 
-ErrorType OperatingSystem::createTimer(Id &timer, const Milliseconds period, const bool autoReload, std::function<void(void)> callback) {
-    struct sigevent signalEvent;
-    timer_t *posixTimerId = nullptr;
-    //The value of posixTimerId is local to this frame. Need a mempool to make sure it sticks around.
-    assert(ErrorType::NoMemory != timerIdPool.allocate(posixTimerId));
-    Timer newTimer = {
-        .callback = callback,
-        .id = _nextTimerId++,
-        .posixTimerId = posixTimerId,
-        .autoReload = autoReload,
-        .period = period
-    };
+    for (Count i = 0; i < _semaphores.size(); i++) {
+        Semaphore &newSemaphore = _semaphores[i];
 
-    signalEvent.sigev_notify = SIGEV_THREAD;
-    signalEvent.sigev_notify_function = TimerCallback;
-    signalEvent.sigev_value.sival_ptr = posixTimerId;
-    //Will fail silently (timer doesn't seem to run at all) if this is not set.
-    signalEvent.sigev_notify_attributes = nullptr;
+        if (!newSemaphore.inUse.load(std::memory_order_relaxed)) {
+            newSemaphore.count.store(initial, std::memory_order_relaxed);
+            newSemaphore.waiters.store(0, std::memory_order_relaxed);
+            newSemaphore.max = max;
+            newSemaphore.inUse.store(true, std::memory_order_release);
 
-    if (0 == timer_create(CLOCK_REALTIME, &signalEvent, posixTimerId)) {
-        timers[*posixTimerId] = newTimer;
-        timer = newTimer.id;
-        return ErrorType::Success;
+            semaphore = i + 1;
+            if ('\0' != name.front()) {
+                semaphores[name] = semaphore;
+            }
+            error = ErrorType::Success;
+            break;
+        }
     }
 
-    return fromPlatformError(errno);
+    pthread_mutex_unlock(&_semaphoreMutex);
+    return error;
 }
 
-ErrorType OperatingSystem::deleteTimer(const Id timer) {
-   auto itr = timers.begin();
-
-    while (itr != timers.end()) {
-        if (timer == itr->second.id) {
-            const timer_t posixTimerId = itr->first;
-            timer_delete(posixTimerId);
-            if (ErrorType::InvalidParameter == timerIdPool.deallocate(itr->second.posixTimerId)) {
-                delete itr->second.posixTimerId;
-            }
-            timers.erase(itr);
-            return ErrorType::Success;
-        }
+ErrorType OperatingSystem::deleteSemaphore(const Id semaphore) {
+    ErrorType error = ErrorType::NoData;
+    pthread_mutex_lock(&_semaphoreMutex);
+
+    Semaphore *const semaphoreToDelete = toSemaphore(semaphore);
+    if (nullptr != semaphoreToDelete) {
+        semaphoreToDelete->inUse.store(false, std::memory_order_release);
+        std::erase_if(semaphores, [semaphore](const auto &namedSemaphore) { return namedSemaphore.second == semaphore; });
+        error = ErrorType::Success;
     }
 
-    return ErrorType::NoData;
+    pthread_mutex_unlock(&_semaphoreMutex);
+    return error;
 }
 
-ErrorType OperatingSystem::startTimer(const Id timer, const Milliseconds timeout) {
-    ErrorType error = ErrorType::NoData;
+ErrorType OperatingSystem::waitSemaphore(const Id semaphore, const Milliseconds timeout) {
+    Semaphore *const semaphoreToWaitOn = toSemaphore(semaphore);
+    if (nullptr == semaphoreToWaitOn) {
+        return ErrorType::NoData;
+    }
 
-    for (const auto &nextTimer : timers) {
-
-        if (nextTimer.second.id == timer) {
-            const Timer &timer = nextTimer.second;
-            struct itimerspec timerSpec;
-            
-            if (timer.autoReload) {
-                //Arm the timer by setting any subfield of it_value to a non-zero value
-                timerSpec.it_value.tv_sec = 1;
-                timerSpec.it_value.tv_nsec = 0;
-                //Timer is autoreload, so the period goes into the interval field.
-                timerSpec.it_interval.tv_sec = timer.period / 1000;
-                timerSpec.it_interval.tv_nsec = 0;
-            }
-            else {
-                timerSpec.it_value.tv_sec = timer.period / 1000;
-                timerSpec.it_value.tv_nsec = 0;
-                //Both subfeilds are zero, so when the timer expires just once according to it_value.
-                timerSpec.it_interval.tv_sec = 0;
-                timerSpec.it_interval.tv_nsec = 0;
-            }
+    ErrorType error = decrementSemaphore(semaphore);
+    if (ErrorType::Timeout != error || 0 == timeout) {
+        return error;
+    }
 
-            //Must not be greater than this according to the docs. Meaning you can't put more than a second into the nsec member.
-            assert(timerSpec.it_value.tv_nsec <= 999999999);
+    //The deadline is absolute so that spurious wakeups and losing the race to other waiters do not extend the time we wait for.
+    const struct timespec deadline = deadlineAfter(timeout);
 
-            //You probably didn't mean to set these to zero. On Linux the posix timer granularity is a second at minimum so if you set timeout
-            //to less than a second the timers will expire right away or never be armed.
-            assert(timerSpec.it_value.tv_sec > 0 || timerSpec.it_value.tv_nsec > 0);
+    //Waiters must be counted before the count is checked again so that a post which happens in between sees that it needs to wake us.
+    semaphoreToWaitOn->waiters.fetch_add(1);
+    while (true) {
+        uint32_t count = semaphoreToWaitOn->count.load();
 
-            //The flag is zero so the timer times relatively instead expiring when the system clock reaches the value specified by it_value.
-            //Last argument is nullptr since we don't want the output parameter of old_time which is the itimerspec that new time replaced.
-            if (0 == timer_settime(nextTimer.first, 0, &timerSpec, nullptr)) {
-                return ErrorType::Success;
-            }
-            else {
-                perror("timer_settime");
-                error = fromPlatformError(errno);
+        if (count > 0) {
+            if (semaphoreToWaitOn->count.compare_exchange_weak(count, count - 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+                error = ErrorType::Success;
+                break;
             }
         }
+        //The kernel only puts us to sleep if the count is still zero so a post can not be missed.
+        else if (-1 == futex(semaphoreToWaitOn->count, FUTEX_WAIT_BITSET_PRIVATE, 0, &deadline) && ETIMEDOUT == errno) {
+            break;
+        }
     }
+    semaphoreToWaitOn->waiters.fetch_sub(1, std::memory_order_relaxed);
 
     return error;
 }
 
-ErrorType OperatingSystem::stopTimer(const Id timer, const Milliseconds timeout) {
-    auto itr = timers.begin();
-    while(itr != timers.end()) {
-        if (itr->second.id == timer) {
-            struct itimerspec timerSpec;
-            timerSpec.it_value.tv_sec = timerSpec.it_value.tv_nsec = 0;
-            constexpr int timerIsAbsolute = 0;
-            constexpr itimerspec *doNotReturnPreviousTime = nullptr;
-            if (0 == timer_settime(itr->first, timerIsAbsolute, &timerSpec, doNotReturnPreviousTime)) {
-                return ErrorType::Success;
-            }
-        }
+ErrorType OperatingSystem::incrementSemaphore(const Id semaphore) {
+    Semaphore *const semaphoreToIncrement = toSemaphore(semaphore);
+    if (nullptr == semaphoreToIncrement) {
+        return ErrorType::NoData;
     }
 
-    return ErrorType::Failure;
-}
+    uint32_t count = semaphoreToIncrement->count.load(std::memory_order_relaxed);
+    do {
+        if (count >= semaphoreToIncrement->max) {
+            return ErrorType::LimitReached;
+        }
+    } while (!semaphoreToIncrement->count.compare_exchange_weak(count, count + 1));
 
-ErrorType OperatingSystem::createQueue(const std::array<char, OperatingSystemTypes::MaxQueueNameLength> &name, const Bytes size, const Count length) {
-    return ErrorType::NotImplemented;
-}
+    if (semaphoreToIncrement->waiters.load() > 0) {
+        futex(semaphoreToIncrement->count, FUTEX_WAKE_PRIVATE, 1, nullptr);
+    }
 
-ErrorType OperatingSystem::sendToQueue(const std::array<char, OperatingSystemTypes::MaxQueueNameLength> &name, const void *data, const Milliseconds timeout, const bool toFront, const bool fromIsr) {
-    return ErrorType::NotImplemented;
+    return ErrorType::Success;
 }
 
-ErrorType OperatingSystem::receiveFromQueue(const std::array<char, OperatingSystemTypes::MaxQueueNameLength> &name, void *buffer, const Milliseconds timeout, const bool fromIsr) {
-    return ErrorType::NotImplemented;
-}
+ErrorType OperatingSystem::decrementSemaphore(const Id semaphore) {
+    Semaphore *const semaphoreToDecrement = toSemaphore(semaphore);
+    if (nullptr == semaphoreToDecrement) {
+        return ErrorType::NoData;
+    }
 
-ErrorType OperatingSystem::peekFromQueue(const std::array<char, OperatingSystemTypes::MaxQueueNameLength> &name, void *buffer, const Milliseconds timeout, const bool fromIsr) {
-    return ErrorType::NotImplemented;
-}
+    uint32_t count = semaphoreToDecrement->count.load(std::memory_order_relaxed);
+    do {
+        if (0 == count) {
+            return ErrorType::Timeout;
+        }
+    } while (!semaphoreToDecrement->count.compare_exchange_weak(count, count - 1, std::memory_order_acquire, std::memory_order_relaxed));
 
-ErrorType OperatingSystem::getSystemTime(UnixTime &currentSystemUnixTime) {
-    currentSystemUnixTime = static_cast<UnixTime>(time(nullptr));
     return ErrorType::Success;
 }
 
-ErrorType OperatingSystem::getSystemTick(Ticks &currentSystemTicks) {
-    struct tms timeSample;
-    currentSystemTicks = static_cast<Ticks>(times(&timeSample));
-    return ErrorType::Success;
-}
+ErrorType OperatingSystem::createMutex(Id &mutex, const bool priorityInheritance) {
+    ErrorType error = ErrorType::LimitReached;
+    pthread_mutex_lock(&_lockMutex);
 
-ErrorType OperatingSystem::ticksToMilliseconds(const Ticks ticks, Milliseconds &timeInMilliseconds) {
-    timeInMilliseconds = static_cast<Milliseconds>(ticks * (sysconf(_SC_CLK_TCK) / 1000));
-    return ErrorType::Success;
-}
+    for (Count i = 0; i < _mutexes.size(); i++) {
+        Mutex &newMutex = _mutexes[i];
 
-ErrorType OperatingSystem::millisecondsToTicks(const Milliseconds milli, Ticks &ticks) {
-    ticks = static_cast<Ticks>((milli / 1000) * sysconf(_SC_CLK_TCK));
-    return ErrorType::Success;
-}
+        if (!newMutex.inUse.load(std::memory_order_relaxed)) {
+            pthread_mutexattr_t attributes;
+            pthread_mutexattr_init(&attributes);
+            //Error checking lets unlockMutex report a thread unlocking a mutex it does not hold instead of silently corrupting it.
+            pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_ERRORCHECK);
+            if (priorityInheritance) {
+                pthread_mutexattr_setprotocol(&attributes, PTHREAD_PRIO_INHERIT);
+            }
 
-ErrorType OperatingSystem::getSoftwareVersion(std::string &softwareVersion) {
-    std::string softwareVersionStringRaw(32, 0);
-    
-    constexpr char command[] = "sh -c \"git describe --tag\"";
-    ErrorType error = ErrorType::Failure;
-    
-    FILE* pipe = popen(command, "r");
-    if (nullptr != pipe) {
-        if (nullptr != fgets(softwareVersionStringRaw.data(), softwareVersionStringRaw.capacity(), pipe)) {
-            error = ErrorType::Success;
-        }
-        else {
-            softwareVersionStringRaw.clear();
-            pclose(pipe);
-            error = ErrorType::Failure;
-        }
-    }
+            const int result = pthread_mutex_init(&newMutex.mutex, &attributes);
+            pthread_mutexattr_destroy(&attributes);
+            if (0 != result) {
+                error = fromPlatformError(result);
+                break;
+            }
 
-    for (unsigned int i = 0; i < softwareVersionStringRaw.size() && softwareVersionStringRaw.at(i) != '-'; i++) {
-        if (softwareVersionStringRaw.at(i) == '.') {
-            softwareVersion.push_back('.');
-            continue;
+            newMutex.inUse.store(true, std::memory_order_release);
+            mutex = i + 1;
+            error = ErrorType::Success;
+            break;
         }
-
-        softwareVersion.push_back(softwareVersionStringRaw.at(i));
     }
 
+    pthread_mutex_unlock(&_lockMutex);
     return error;
 }
 
-ErrorType OperatingSystem::getResetReason(OperatingSystemTypes::ResetReason &resetReason) {
-    //There isn't really such thing as a reset reason for most posix systems.
-    resetReason = OperatingSystemTypes::ResetReason::Unknown;
-    return ErrorType::Success;
-}
-
-ErrorType OperatingSystem::reset() {
-    return ErrorType::NotAvailable;
-}
-
-ErrorType OperatingSystem::setTimeOfDay(const UnixTime utc, const int16_t timeZoneDifferenceUtc) {
-    //On systems that use Posix, you shouldn't attempt to set the time of day, and the time that can be obtained
-    //using the posix API will already be the correct time that you need as soon as you start your application.
-    return ErrorType::NotAvailable;
-}
+ErrorType OperatingSystem::deleteMutex(const Id mutex) {
+    ErrorType error = ErrorType::NoData;
+    pthread_mutex_lock(&_lockMutex);
 
-ErrorType OperatingSystem::idlePercentage(Percent &idlePercent) {
-    ErrorType error = ErrorType::Failure;
-    std::string idleTime(4, 0);
-    std::string cpuTimeSeconds(16, 0);
-    std::string elapsedTimeSeconds(16, 0);
-    Seconds cpuTime, elapsedTime;
-
-    std::string programName(program_invocation_short_name, strlen(program_invocation_short_name));
-    std::string commandCpuTime("ps -p $(pgrep -if ");
-    commandCpuTime.append(programName);
-    commandCpuTime.append(" | head -1) -o cputimes");
-    std::string commandElapsedTime("ps -p $(pgrep -if ");
-    commandElapsedTime.append(programName);
-    commandElapsedTime.append("| head -1) -o etimes");
-    
-    FILE* pipe = popen(commandCpuTime.c_str(), "r");
-    if (nullptr != pipe) {
-        size_t bytesRead = fread(cpuTimeSeconds.data(), sizeof(uint8_t), cpuTimeSeconds.capacity(), pipe);
-        if (feof(pipe) || bytesRead == cpuTimeSeconds.capacity()) {
+    Mutex *const mutexToDelete = toMutex(mutex);
+    if (nullptr != mutexToDelete) {
+        //A mutex that is still locked can't be destroyed so it stays in use until it is unlocked and deleted again.
+        if (0 == pthread_mutex_destroy(&mutexToDelete->mutex)) {
+            mutexToDelete->inUse.store(false, std::memory_order_release);
             error = ErrorType::Success;
-            cpuTimeSeconds.resize(bytesRead);
-            while (cpuTimeSeconds.back() == '\n') {
-                cpuTimeSeconds.pop_back();
-            }
         }
-        else if (ferror(pipe)) {
-            pclose(pipe);
-            error = ErrorType::Failure;
+        else {
+            error = ErrorType::PrerequisitesNotMet;
         }
     }
 
-    cpuTime = strtoul(cpuTimeSeconds.c_str(), nullptr, 10);
+    pthread_mutex_unlock(&_lockMutex);
+    return error;
+}
 
-    pipe = popen(commandElapsedTime.c_str(), "r");
-    if (nullptr != pipe) {
-        size_t bytesRead = fread(elapsedTimeSeconds.data(), sizeof(uint8_t), elapsedTimeSeconds.capacity(), pipe);
-        if (feof(pipe) || bytesRead == elapsedTimeSeconds.capacity()) {
-            error = ErrorType::Success;
-            elapsedTimeSeconds.resize(bytesRead);
-            while (elapsedTimeSeconds.back() == '\n') {
-                elapsedTimeSeconds.pop_back();
-            }
-        }
-        else if (ferror(pipe)) {
-            pclose(pipe);
-            error = ErrorType::Failure;
-        }
+ErrorType OperatingSystem::lockMutex(const Id mutex, const Milliseconds timeout) {
+    Mutex *const mutexToLock = toMutex(mutex);
+    if (nullptr == mutexToLock) {
+        return ErrorType::NoData;
     }
 
-    elapsedTime = strtoul(elapsedTimeSeconds.c_str(), nullptr, 10);
-
-    //TODO: This is more like cpu time rather than idle time.
-    if (0 != elapsedTime) {
-        idlePercent = 100.0f - (((float)cpuTime / (float)elapsedTime) * 100.0f);
+    //Only work out the deadline if we actually have to wait.
+    int result = pthread_mutex_trylock(&mutexToLock->mutex);
+    if (EBUSY == result && 0 != timeout) {
+        const struct timespec deadline = deadlineAfter(timeout);
+        result = pthread_mutex_clocklock(&mutexToLock->mutex, CLOCK_MONOTONIC, &deadline);
     }
-    else {
-        idlePercent = 100.0f;
+
+    if (EBUSY == result || ETIMEDOUT == result) {
+        return ErrorType::Timeout;
     }
 
-    return error;
+    return fromPlatformError(result);
 }
 
-ErrorType OperatingSystem::memoryRegionUsage(OperatingSystemTypes::MemoryRegionInfo &region) {
-    ErrorType error = ErrorType::Failure;
+ErrorType OperatingSystem::unlockMutex(const Id mutex) {
+    Mutex *const mutexToUnlock = toMutex(mutex);
+    if (nullptr == mutexToUnlock) {
+        return ErrorType::NoData;
+    }
 
-    // Get total RAM size in bytes
-    constexpr std::array<char, 49> totalCommand = {"free -b | egrep Mem | tr -s \" \" | cut -d \" \" -f2"};
-    std::array<char, 16> totalRamStr;
-    
-    FILE* totalPipe = popen(totalCommand.data(), "r");
-    if (nullptr != totalPipe) {
+    return fromPlatformError(pthread_mutex_unlock(&mutexToUnlock->mutex));
+}
 
-        size_t bytesRead = fread(totalRamStr.data(), sizeof(uint8_t), totalRamStr.size(), totalPipe);
+ErrorType OperatingSystem::createReadWriteLock(Id &lock) {
+    ErrorType error = ErrorType::LimitReached;
+    pthread_mutex_lock(&_lockMutex);
 
-        if (feof(totalPipe) || bytesRead == totalRamStr.size()) {
+    for (Count i = 0; i < _readWriteLocks.size(); i++) {
+        ReadWriteLock &newLock = _readWriteLocks[i];
 
-            for (int i = totalRamStr.max_size()-1; i >= 0; i--) {
+        if (!newLock.inUse.load(std::memory_order_relaxed)) {
+            pthread_rwlockattr_t attributes;
+            pthread_rwlockattr_init(&attributes);
+            //The default lets a steady stream of readers starve writers forever.
+            pthread_rwlockattr_setkind_np(&attributes, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
 
-                if (totalRamStr[i] == '\n') {
-                    totalRamStr[i] = '\0';
-                }
+            const int result = pthread_rwlock_init(&newLock.lock, &attributes);
+            pthread_rwlockattr_destroy(&attributes);
+            if (0 != result) {
+                error = fromPlatformError(result);
+                break;
             }
-            
-            const Bytes totalRam = std::strtoul(totalRamStr.data(), nullptr, 10);
-            
-            // Get available RAM in bytes
-            constexpr char availableCommand[] = "free -b | egrep Mem | tr -s \" \" | cut -d \" \" -f7";
-            std::array<char, 16> availableRamStr;
-            
-            FILE* availablePipe = popen(availableCommand, "r");
-
-            if (nullptr != availablePipe) {
-
-                const size_t availableBytesRead = fread(availableRamStr.data(), sizeof(uint8_t), availableRamStr.size(), availablePipe);
-
-                if (feof(availablePipe) || availableBytesRead == availableRamStr.size()) {
-
-                    for (int i = availableRamStr.max_size()-1; i >= 0; i--) {
-
-                        if (availableRamStr[i] == '\n') {
-                            availableRamStr[i] = '\0';
-                        }
-                    }
-                    
-                    const Bytes availableRam = std::strtoul(availableRamStr.data(), nullptr, 10);
-                    region.free = (totalRam > 0) ? (Percent(availableRam) / totalRam) * 100.0f : 0.0f;
-                    error = ErrorType::Success;
-                }
 
-                pclose(availablePipe);
-            }
+            newLock.inUse.store(true, std::memory_order_release);
+            lock = i + 1;
+            error = ErrorType::Success;
+            break;
         }
-
-        pclose(totalPipe);
     }
 
+    pthread_mutex_unlock(&_lockMutex);
     return error;
 }
 
-ErrorType OperatingSystem::uptime(Seconds &uptime) {
-    const auto duration = std::chrono::steady_clock::now() - _startTime;
-    uptime = std::chrono::duration_cast<std::chrono::seconds>(duration).count();
+ErrorType OperatingSystem::deleteReadWriteLock(const Id lock) {
+    ErrorType error = ErrorType::NoData;
+    pthread_mutex_lock(&_lockMutex);
+
+    ReadWriteLock *const lockToDelete = toReadWriteLock(lock);
+    if (nullptr != lockToDelete) {
+        if (0 == pthread_rwlock_destroy(&lockToDelete->lock)) {
+            lockToDelete->inUse.store(false, std::memory_order_release);
+            error = ErrorType::Success;
+        }
+        else {
+            error = ErrorType::PrerequisitesNotMet;
+        }
+    }
+
+    pthread_mutex_unlock(&_lockMutex);
+    return error;
+}
+
+ErrorType OperatingSystem::lockRead(const Id lock, const Milliseconds timeout) {
+    ReadWriteLock *const lockToTake = toReadWriteLock(lock);
+    if (nullptr == lockToTake) {
+        return ErrorType::NoData;
+    }
+
+    //Only work out the deadline if we actually have to wait.
+    int result = pthread_rwlock_tryrdlock(&lockToTake->lock);
+    if (EBUSY == result && 0 != timeout) {
+        const struct timespec deadline = deadlineAfter(timeout);
+        result = pthread_rwlock_clockrdlock(&lockToTake->lock, CLOCK_MONOTONIC, &deadline);
+    }
+
+    if (EBUSY == result || ETIMEDOUT == result) {
+        return ErrorType::Timeout;
+    }
+
+    return fromPlatformError(result);
+}
+
+ErrorType OperatingSystem::lockWrite(const Id lock, const Milliseconds timeout) {
+    ReadWriteLock *const lockToTake = toReadWriteLock(lock);
+    if (nullptr == lockToTake) {
+        return ErrorType::NoData;
+    }
+
+    //Only work out the deadline if we actually have to wait.
+    int result = pthread_rwlock_trywrlock(&lockToTake->lock);
+    if (EBUSY == result && 0 != timeout) {
+        const struct timespec deadline = deadlineAfter(timeout);
+        result = pthread_rwlock_clockwrlock(&lockToTake->lock, CLOCK_MONOTONIC, &deadline);
+    }
+
+    if (EBUSY == result || ETIMEDOUT == result) {
+        return ErrorType::Timeout;
+    }
+
+    return fromPlatformError(result);
+}
+
+ErrorType OperatingSystem::unlockReadWriteLock(const Id lock) {
+    ReadWriteLock *const lockToRelease = toReadWriteLock(lock);
+    if (nullptr == lockToRelease) {
+        return ErrorType::NoData;
+    }
+
+    return fromPlatformError(pthread_rwlock_unlock(&lockToRelease->lock));
+}
+
+ErrorType OperatingSystem::createTimer(Id &timer, const Milliseconds period, const bool autoReload, std::function<void(void)> callback) {
+    //It would be reloaded to expire as soon as it was dispatched and keep the timer service from ever getting to another timer.
+    if (autoReload && 0 == period) {
+        return ErrorType::InvalidParameter;
+    }
+
+    pthread_mutex_lock(&_timerMutex);
+
+    ErrorType error = startTimerService();
+    if (ErrorType::Success == error) {
+        const Id id = _nextTimerId++;
+        timers.emplace(id, Timer{
+            .callback = callback,
+            .id = id,
+            .autoReload = autoReload,
+            .period = period,
+            .expiry = {},
+            .heapIndex = NotArmed
+        });
+        timer = id;
+    }
+
+    pthread_mutex_unlock(&_timerMutex);
+    return error;
+}
+
+ErrorType OperatingSystem::deleteTimer(const Id timer) {
+    ErrorType error = ErrorType::NoData;
+    pthread_mutex_lock(&_timerMutex);
+
+    auto itr = timers.find(timer);
+    if (timers.end() != itr) {
+        if (NotArmed != itr->second.heapIndex) {
+            disarmTimer(itr->second);
+        }
+        timers.erase(itr);
+        error = ErrorType::Success;
+    }
+
+    pthread_mutex_unlock(&_timerMutex);
+    return error;
+}
+
+ErrorType OperatingSystem::startTimer(const Id timer, const Milliseconds timeout) {
+    ErrorType error = ErrorType::NoData;
+    pthread_mutex_lock(&_timerMutex);
+
+    auto itr = timers.find(timer);
+    if (timers.end() != itr) {
+        Timer &timerToStart = itr->second;
+        //Starting a timer that is already running restarts it like it does on FreeRTOS.
+        if (NotArmed != timerToStart.heapIndex) {
+            disarmTimer(timerToStart);
+        }
+        armTimer(timerToStart, std::chrono::steady_clock::now() + std::chrono::milliseconds(timerToStart.period));
+        error = ErrorType::Success;
+    }
+
+    pthread_mutex_unlock(&_timerMutex);
+    return error;
+}
+
+ErrorType OperatingSystem::stopTimer(const Id timer, const Milliseconds timeout) {
+    ErrorType error = ErrorType::NoData;
+    pthread_mutex_lock(&_timerMutex);
+
+    auto itr = timers.find(timer);
+    if (timers.end() != itr) {
+        if (NotArmed != itr->second.heapIndex) {
+            disarmTimer(itr->second);
+        }
+        error = ErrorType::Success;
+    }
+
+    pthread_mutex_unlock(&_timerMutex);
+    return error;
+}
+
+ErrorType OperatingSystem::startTimerService() {
+    if (OperatingSystemTypes::NullId != _timerServiceThreadId) {
+        return ErrorType::Success;
+    }
+
+    if (-1 == _timerFileDescriptor) {
+        _timerFileDescriptor = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+        if (-1 == _timerFileDescriptor) {
+            return fromPlatformError(errno);
+        }
+    }
+
+    //Created as one of our own threads so that currentThreadId() recognizes it and EventQueue queues events added from timer callbacks
+    //instead of running them in the context of the timer service.
+    return createThread(OperatingSystemTypes::Priority::High, {"timerService"}, nullptr, _TimerServiceStackSize, TimerServiceThread, _timerServiceThreadId);
+}
+
+void OperatingSystem::armTimer(Timer &timer, const std::chrono::steady_clock::time_point expiry) {
+    assert(NotArmed == timer.heapIndex);
+    const auto previousFirstExpiry = _timerHeap.empty() ? std::chrono::steady_clock::time_point::max() : _timerHeap.front()->expiry;
+
+    timer.expiry = expiry;
+    timer.heapIndex = _timerHeap.size();
+    _timerHeap.push_back(&timer);
+    timerHeapSiftUp(timer.heapIndex);
+
+    if (expiry < previousFirstExpiry) {
+        updateTimerFileDescriptor();
+    }
+}
+
+void OperatingSystem::disarmTimer(Timer &timer) {
+    assert(NotArmed != timer.heapIndex);
+    const bool wasFirst = (0 == timer.heapIndex);
+    const size_t index = timer.heapIndex;
+
+    timerHeapSwap(index, _timerHeap.size() - 1);
+    _timerHeap.pop_back();
+    timer.heapIndex = NotArmed;
+
+    if (index < _timerHeap.size()) {
+        timerHeapSiftDown(index);
+        timerHeapSiftUp(index);
+    }
+
+    if (wasFirst) {
+        updateTimerFileDescriptor();
+    }
+}
+
+void OperatingSystem::timerHeapSiftUp(size_t index) {
+    while (index > 0) {
+        const size_t parent = (index - 1) / 2;
+        if (_timerHeap[index]->expiry >= _timerHeap[parent]->expiry) {
+            break;
+        }
+
+        timerHeapSwap(index, parent);
+        index = parent;
+    }
+}
+
+void OperatingSystem::timerHeapSiftDown(size_t index) {
+    while (true) {
+        const size_t left = 2 * index + 1;
+        const size_t right = left + 1;
+        size_t earliest = index;
+
+        if (left < _timerHeap.size() && _timerHeap[left]->expiry < _timerHeap[earliest]->expiry) {
+            earliest = left;
+        }
+        if (right < _timerHeap.size() && _timerHeap[right]->expiry < _timerHeap[earliest]->expiry) {
+            earliest = right;
+        }
+        if (earliest == index) {
+            break;
+        }
+
+        timerHeapSwap(index, earliest);
+        index = earliest;
+    }
+}
+
+void OperatingSystem::timerHeapSwap(const size_t a, const size_t b) {
+    std::swap(_timerHeap[a], _timerHeap[b]);
+    _timerHeap[a]->heapIndex = a;
+    _timerHeap[b]->heapIndex = b;
+}
+
+void OperatingSystem::updateTimerFileDescriptor() {
+    //An it_value of zero disarms the timerfd.
+    struct itimerspec timerSpec = {};
+
+    if (!_timerHeap.empty()) {
+        const auto expiry = std::chrono::duration_cast<std::chrono::nanoseconds>(_timerHeap.front()->expiry.time_since_epoch()).count();
+        timerSpec.it_value.tv_sec = expiry / 1000000000;
+        timerSpec.it_value.tv_nsec = expiry % 1000000000;
+    }
+
+    //steady_clock is CLOCK_MONOTONIC so the expiry can be used as an absolute time.
+    [[maybe_unused]] const int res = timerfd_settime(_timerFileDescriptor, TFD_TIMER_ABSTIME, &timerSpec, nullptr);
+    assert(0 == res);
+}
+
+template <typename Predicate>
+ErrorType OperatingSystem::waitOnQueue(Queue &queue, pthread_cond_t &condition, const Milliseconds timeout, Predicate predicate) {
+    if (predicate()) {
+        return ErrorType::Success;
+    }
+    else if (0 == timeout) {
+        return ErrorType::Timeout;
+    }
+
+    //The deadline is absolute so that spurious wakeups and contention with other waiters do not extend the time we wait for.
+    const struct timespec deadline = deadlineAfter(timeout);
+
+    while (!predicate()) {
+        if (ETIMEDOUT == pthread_cond_timedwait(&condition, &queue.mutex, &deadline)) {
+            return predicate() ? ErrorType::Success : ErrorType::Timeout;
+        }
+    }
+
     return ErrorType::Success;
 }
 
-ErrorType OperatingSystem::disableAllInterrupts() {
-    while (_interruptsDisabled) {
-        delay(Milliseconds(1));
+ErrorType OperatingSystem::createPeriodicTask(Id &task, const Microseconds period, const Microseconds spin) {
+    if (0 == period || spin >= period) {
+        return ErrorType::InvalidParameter;
     }
 
-    _interruptsDisabled = true;
+    ErrorType error = ErrorType::LimitReached;
+    pthread_mutex_lock(&_periodicTaskMutex);
+
+    for (Count i = 0; i < _periodicTasks.size(); i++) {
+        PeriodicTask &newTask = _periodicTasks[i];
+
+        if (!newTask.inUse.load(std::memory_order_relaxed)) {
+            newTask.release = monotonicNanoseconds();
+            newTask.period = period;
+            newTask.spin = spin;
+            newTask.totalJitter = 0;
+            newTask.statistics.write({});
+            newTask.inUse.store(true, std::memory_order_release);
+
+            task = i + 1;
+            error = ErrorType::Success;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&_periodicTaskMutex);
+    return error;
+}
+
+ErrorType OperatingSystem::deletePeriodicTask(const Id task) {
+    ErrorType error = ErrorType::NoData;
+    pthread_mutex_lock(&_periodicTaskMutex);
+
+    PeriodicTask *const taskToDelete = toPeriodicTask(task);
+    if (nullptr != taskToDelete) {
+        taskToDelete->inUse.store(false, std::memory_order_release);
+        error = ErrorType::Success;
+    }
+
+    pthread_mutex_unlock(&_periodicTaskMutex);
+    return error;
+}
+
+ErrorType OperatingSystem::waitUntilNextPeriod(const Id task) {
+    PeriodicTask *const periodicTask = toPeriodicTask(task);
+    if (nullptr == periodicTask) {
+        return ErrorType::NoData;
+    }
+
+    const uint64_t period = periodicTask->period * 1000;
+    uint64_t release = periodicTask->release + period;
+    Count missedDeadlines = 0;
+
+    //Skip every period that started while we were still working on the last one so that an overrun doesn't turn into a burst
+    //of back to back periods trying to catch up.
+    const uint64_t now = monotonicNanoseconds();
+    if (now > release) {
+        missedDeadlines = (now - release) / period + 1;
+        release += missedDeadlines * period;
+    }
+
+    if (0 == periodicTask->spin) {
+        sleepUntil(release);
+    }
+    else {
+        //Waking up from a sleep can take tens of microseconds so wake up early and spin for the rest.
+        sleepUntil(release - periodicTask->spin * 1000);
+        while (monotonicNanoseconds() < release) {
+            cpuRelax();
+        }
+    }
+
+    const Microseconds jitter = (monotonicNanoseconds() - release) / 1000;
+    periodicTask->release = release;
+    periodicTask->totalJitter += jitter;
+    periodicTask->statistics.update([&](OperatingSystemTypes::PeriodicTaskStatistics &statistics) {
+        statistics.periods++;
+        statistics.missedDeadlines += missedDeadlines;
+        statistics.maxJitter = std::max(statistics.maxJitter, jitter);
+        statistics.averageJitter = periodicTask->totalJitter / statistics.periods;
+    });
+
+    return 0 == missedDeadlines ? ErrorType::Success : ErrorType::Timeout;
+}
+
+ErrorType OperatingSystem::periodicTaskStatistics(const Id task, OperatingSystemTypes::PeriodicTaskStatistics &statistics) {
+    PeriodicTask *const periodicTask = toPeriodicTask(task);
+    if (nullptr == periodicTask) {
+        return ErrorType::NoData;
+    }
+
+    periodicTask->statistics.read(statistics);
     return ErrorType::Success;
 }
 
-ErrorType OperatingSystem::enableAllInterrupts() {
-    while (!_interruptsDisabled) {
-        delay(Milliseconds(1));
+ErrorType OperatingSystem::createQueue(const std::array<char, OperatingSystemTypes::MaxQueueNameLength> &name, const Bytes size, const Count length) {
+    if (0 == size || 0 == length) {
+        return ErrorType::InvalidParameter;
+    }
+
+    //All of the storage the queue will ever need is allocated here so that no allocations happen when sending.
+    std::unique_ptr<uint8_t[]> storage(new (std::nothrow) uint8_t[size * length]);
+    if (nullptr == storage) {
+        return ErrorType::NoMemory;
+    }
+
+    pthread_mutex_lock(&_queueMutex);
+    const bool created = queues.try_emplace(name, std::move(storage), size, length).second;
+    pthread_mutex_unlock(&_queueMutex);
+
+    return created ? ErrorType::Success : ErrorType::Failure;
+}
+
+OperatingSystem::Queue::Queue(std::unique_ptr<uint8_t[]> storage, const Bytes itemSize, const Count length) : storage(std::move(storage)), itemSize(itemSize), length(length), front(0), itemsQueued(0) {
+    pthread_mutex_init(&mutex, nullptr);
+
+    //Timeouts are measured against the monotonic clock so that changes to the time of day do not affect them.
+    pthread_condattr_t conditionAttributes;
+    pthread_condattr_init(&conditionAttributes);
+    pthread_condattr_setclock(&conditionAttributes, CLOCK_MONOTONIC);
+    pthread_cond_init(&notEmpty, &conditionAttributes);
+    pthread_cond_init(&notFull, &conditionAttributes);
+    pthread_condattr_destroy(&conditionAttributes);
+}
+
+OperatingSystem::Queue::~Queue() {
+    pthread_cond_destroy(&notFull);
+    pthread_cond_destroy(&notEmpty);
+    pthread_mutex_destroy(&mutex);
+}
+
+OperatingSystem::Queue *OperatingSystem::toQueue(const std::array<char, OperatingSystemTypes::MaxQueueNameLength> &name) {
+    pthread_mutex_lock(&_queueMutex);
+    auto itr = queues.find(name);
+    Queue *queue = queues.end() == itr ? nullptr : &itr->second;
+    pthread_mutex_unlock(&_queueMutex);
+
+    return queue;
+}
+
+ErrorType OperatingSystem::sendToQueue(const std::array<char, OperatingSystemTypes::MaxQueueNameLength> &name, const void *data, const Milliseconds timeout, const bool toFront, const bool fromIsr) {
+    Queue *const queue = toQueue(name);
+    if (nullptr == queue) {
+        return ErrorType::NoData;
+    }
+
+    //Like FreeRTOS, sending from an ISR never blocks.
+    const Milliseconds timeToWait = fromIsr ? 0 : timeout;
+
+    pthread_mutex_lock(&queue->mutex);
+
+    const ErrorType error = waitOnQueue(*queue, queue->notFull, timeToWait, [queue]() { return queue->itemsQueued < queue->length; });
+
+    if (ErrorType::Success == error) {
+        if (toFront) {
+            queue->front = (queue->front + queue->length - 1) % queue->length;
+            memcpy(queue->itemAt(0), data, queue->itemSize);
+        }
+        else {
+            memcpy(queue->itemAt(queue->itemsQueued), data, queue->itemSize);
+        }
+
+        queue->itemsQueued++;
+        pthread_cond_signal(&queue->notEmpty);
     }
 
-    _interruptsDisabled = false;
+    pthread_mutex_unlock(&queue->mutex);
+
+    return error;
+}
+
+ErrorType OperatingSystem::receiveFromQueue(const std::array<char, OperatingSystemTypes::MaxQueueNameLength> &name, void *buffer, const Milliseconds timeout, const bool fromIsr) {
+    Queue *const queue = toQueue(name);
+    if (nullptr == queue) {
+        return ErrorType::NoData;
+    }
+
+    const Milliseconds timeToWait = fromIsr ? 0 : timeout;
+
+    pthread_mutex_lock(&queue->mutex);
+
+    const ErrorType error = waitOnQueue(*queue, queue->notEmpty, timeToWait, [queue]() { return queue->itemsQueued > 0; });
+
+    if (ErrorType::Success == error) {
+        memcpy(buffer, queue->itemAt(0), queue->itemSize);
+        queue->front = (queue->front + 1) % queue->length;
+        queue->itemsQueued--;
+        pthread_cond_signal(&queue->notFull);
+    }
+
+    pthread_mutex_unlock(&queue->mutex);
+
+    return error;
+}
+
+ErrorType OperatingSystem::peekFromQueue(const std::array<char, OperatingSystemTypes::MaxQueueNameLength> &name, void *buffer, const Milliseconds timeout, const bool fromIsr) {
+    Queue *const queue = toQueue(name);
+    if (nullptr == queue) {
+        return ErrorType::NoData;
+    }
+
+    const Milliseconds timeToWait = fromIsr ? 0 : timeout;
+
+    pthread_mutex_lock(&queue->mutex);
+
+    const ErrorType error = waitOnQueue(*queue, queue->notEmpty, timeToWait, [queue]() { return queue->itemsQueued > 0; });
+
+    if (ErrorType::Success == error) {
+        memcpy(buffer, queue->itemAt(0), queue->itemSize);
+        //The item is left in the queue so another thread waiting to receive or peek should get a chance to see it too.
+        pthread_cond_signal(&queue->notEmpty);
+    }
+
+    pthread_mutex_unlock(&queue->mutex);
+
+    return error;
+}
+
+ErrorType OperatingSystem::getSystemTime(UnixTime &currentSystemUnixTime) {
+    currentSystemUnixTime = static_cast<UnixTime>(time(nullptr));
     return ErrorType::Success;
 }
 
-ErrorType OperatingSystem::block() {
-    Id task;
-    ErrorType error = currentThreadId(task);
+ErrorType OperatingSystem::getSystemTime(Microseconds &currentSystemTime) {
+    struct timespec now;
+    if (-1 == clock_gettime(CLOCK_REALTIME, &now)) {
+        return fromPlatformError(errno);
+    }
 
-    if (OperatingSystemTypes::NullId != task) {
+    currentSystemTime = static_cast<Microseconds>(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+    return ErrorType::Success;
+}
+
+ErrorType OperatingSystem::monotonicTime(Nanoseconds &time) {
+    //clock_gettime is in the vDSO so this doesn't enter the kernel.
+    time = monotonicNanoseconds();
+    return ErrorType::Success;
+}
+
+ErrorType OperatingSystem::getSystemTick(Ticks &currentSystemTicks) {
+    //Ticks are milliseconds on CLOCK_MONOTONIC rather than clock ticks from times(), which are only 100Hz on most systems.
+    currentSystemTicks = static_cast<Ticks>(monotonicNanoseconds() / 1000000);
+    return ErrorType::Success;
+}
 
-        for (auto &threadStruct : threads) {
+ErrorType OperatingSystem::ticksToMilliseconds(const Ticks ticks, Milliseconds &timeInMilliseconds) {
+    timeInMilliseconds = static_cast<Milliseconds>(ticks);
+    return ErrorType::Success;
+}
 
-            if (threadStruct.threadId == task) {
-                pthread_mutex_lock(&(threadStruct.mutex));
-                    
-                if (threadStruct.blockCount > -1) {
-                    threadStruct.blockCount++;
-                    threadStruct.status = OperatingSystemTypes::ThreadStatus::Blocked;
+ErrorType OperatingSystem::millisecondsToTicks(const Milliseconds milli, Ticks &ticks) {
+    ticks = static_cast<Ticks>(milli);
+    return ErrorType::Success;
+}
 
-                    //pthread_cond_wait will unlock the mutex and lock it again when it returns.
-                    //The loop is only to protect against spurious wakeups. It's not common to return before the task has been unblocked.
-                    while (threadStruct.status == OperatingSystemTypes::ThreadStatus::Blocked) {
-                        assert(ErrorType::Success == (error = fromPlatformError(pthread_cond_wait(&threadStruct.conditionVariable, &(threadStruct.mutex)))));
-                    }
-                }
-                else {
-                    error = ErrorType::LimitReached;
-                    threadStruct.blockCount = 0;
-                }
+ErrorType OperatingSystem::getSoftwareVersion(std::string &softwareVersion) {
+    std::string softwareVersionStringRaw(32, 0);
+    
+    constexpr char command[] = "sh -c \"git describe --tag\"";
+    ErrorType error = ErrorType::Failure;
+    
+    FILE* pipe = popen(command, "r");
+    if (nullptr != pipe) {
+        if (nullptr != fgets(softwareVersionStringRaw.data(), softwareVersionStringRaw.capacity(), pipe)) {
+            error = ErrorType::Success;
+        }
+        else {
+            softwareVersionStringRaw.clear();
+            pclose(pipe);
+            error = ErrorType::Failure;
+        }
+    }
 
-                pthread_mutex_unlock(&(threadStruct.mutex));
-                
-                break;
-            }
-            else {
-                error = ErrorType::NoData;
-            }
+    for (unsigned int i = 0; i < softwareVersionStringRaw.size() && softwareVersionStringRaw.at(i) != '-'; i++) {
+        if (softwareVersionStringRaw.at(i) == '.') {
+            softwareVersion.push_back('.');
+            continue;
         }
+
+        softwareVersion.push_back(softwareVersionStringRaw.at(i));
     }
 
     return error;
 }
 
-ErrorType OperatingSystem::unblock(const Id task) {
-    ErrorType error = ErrorType::NoData;
+ErrorType OperatingSystem::getResetReason(OperatingSystemTypes::ResetReason &resetReason) {
+    //There isn't really such thing as a reset reason for most posix systems.
+    resetReason = OperatingSystemTypes::ResetReason::Unknown;
+    return ErrorType::Success;
+}
 
-    if (OperatingSystemTypes::NullId != task) {
+ErrorType OperatingSystem::reset() {
+    return ErrorType::NotAvailable;
+}
+
+ErrorType OperatingSystem::setTimeOfDay(const UnixTime utc, const int16_t timeZoneDifferenceUtc) {
+    //On systems that use Posix, you shouldn't attempt to set the time of day, and the time that can be obtained
+    //using the posix API will already be the correct time that you need as soon as you start your application.
+    return ErrorType::NotAvailable;
+}
 
-        for (auto &threadStruct : threads) {
+ErrorType OperatingSystem::idlePercentage(Percent &idlePercent) {
+    uint64_t total, idle;
 
-            if (threadStruct.threadId == task) {
-                pthread_mutex_lock(&(threadStruct.mutex));
-                threadStruct.blockCount--;
+    if (ErrorType::Success != systemCpuTime(total, idle)) {
+        return ErrorType::Failure;
+    }
 
-                if (threadStruct.status == OperatingSystemTypes::ThreadStatus::Blocked) {
-                    threadStruct.status = OperatingSystemTypes::ThreadStatus::Active;
-                    assert(ErrorType::Success == fromPlatformError(pthread_cond_signal(&(threadStruct.conditionVariable))));
-                }
+    //The first sample is measured from boot.
+    const uint64_t totalElapsed = total - _idleSampleTotalTime;
+    idlePercent = (0 == totalElapsed) ? 100.0f : 100.0f * Percent(idle - _idleSampleIdleTime) / Percent(totalElapsed);
+    _idleSampleTotalTime = total;
+    _idleSampleIdleTime = idle;
 
-                pthread_mutex_unlock(&(threadStruct.mutex));
-                error = ErrorType::Success;
-                break;
-            }
-            else {
-                error = ErrorType::NoData;
+    return ErrorType::Success;
+}
+
+ErrorType OperatingSystem::memoryRegionUsage(OperatingSystemTypes::MemoryRegionInfo &region) {
+    //Threads each have a memory region for their stack.
+    auto thread = std::find_if(threads.begin(), threads.end(), [&region](const Thread &thread) {
+        return OperatingSystemTypes::NullId != thread.threadId && 0 == strncmp(thread.name.data(), region.name.data(), OperatingSystemTypes::MaxMemoryRegionNameLength);
+    });
+    if (threads.end() != thread) {
+        //Once a thread has been joined its stack is gone so the last value is kept.
+        if (nullptr != thread->stackMapping) {
+            region.free = 100.0f * Percent(thread->stackSize - stackHighWaterMark(*thread)) / Percent(thread->stackSize);
+        }
+        return ErrorType::Success;
+    }
+
+    std::array<char, 512> meminfo;
+
+    if (readProcFile(_procMeminfoFileDescriptor, "/proc/meminfo", meminfo) <= 0) {
+        return ErrorType::Failure;
+    }
+
+    const uint64_t totalRam = procFileField(meminfo.data(), "MemTotal:");
+    const uint64_t availableRam = procFileField(meminfo.data(), "MemAvailable:");
+    region.free = (totalRam > 0) ? (Percent(availableRam) / totalRam) * 100.0f : 0.0f;
+
+    return ErrorType::Success;
+}
+
+ErrorType OperatingSystem::processUsage(OperatingSystemTypes::ProcessUsage &usage) {
+    std::array<char, 1024> stat;
+    std::array<char, 4096> status;
+    uint64_t total, idle;
+    unsigned long userTime, systemTime;
+
+    if (ErrorType::Success != systemCpuTime(total, idle)) {
+        return ErrorType::Failure;
+    }
+
+    //The command name is in parenthesis and may contain spaces so start parsing after it.
+    if (readProcFile(_procSelfStatFileDescriptor, "/proc/self/stat", stat) <= 0) {
+        return ErrorType::Failure;
+    }
+    const char *afterCommand = strrchr(stat.data(), ')');
+    if (nullptr == afterCommand || 2 != sscanf(afterCommand + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &userTime, &systemTime)) {
+        return ErrorType::Failure;
+    }
+
+    const uint64_t processTime = userTime + systemTime;
+    const uint64_t totalElapsed = total - _processSampleTotalTime;
+    usage.cpu = (0 == totalElapsed) ? 0.0f : 100.0f * Percent(processTime - _processSampleProcessTime) / Percent(totalElapsed);
+    _processSampleTotalTime = total;
+    _processSampleProcessTime = processTime;
+
+    if (readProcFile(_procSelfStatusFileDescriptor, "/proc/self/status", status) <= 0) {
+        return ErrorType::Failure;
+    }
+    usage.residentBytes = procFileField(status.data(), "VmRSS:") * 1024;
+
+    const struct mallinfo2 heap = mallinfo2();
+    usage.heapUsedBytes = heap.uordblks + heap.hblkhd;
+
+    return ErrorType::Success;
+}
+
+ErrorType OperatingSystem::threadUsage(OperatingSystemTypes::ThreadInfo &thread) {
+    const bool threadExists = OperatingSystemTypes::NullId != thread.id && thread.id <= threads.size() && threads[toThreadIndex(thread.id)].threadId == thread.id;
+    if (!threadExists) {
+        return ErrorType::NoData;
+    }
+
+    Thread &threadStruct = threads[toThreadIndex(thread.id)];
+    if (nullptr != threadStruct.stackMapping) {
+        thread.stackSize = threadStruct.stackSize;
+        thread.stackHighWaterMark = stackHighWaterMark(threadStruct);
+    }
+
+    if (threadStruct.exited) {
+        const struct rusage &usage = threadStruct.usageAtExit;
+        thread.cpuTime = (Microseconds(usage.ru_utime.tv_sec) + usage.ru_stime.tv_sec) * 1000000 + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+        thread.voluntaryContextSwitches = usage.ru_nvcsw;
+        thread.involuntaryContextSwitches = usage.ru_nivcsw;
+        return ErrorType::Success;
+    }
+    //The thread hasn't started running yet.
+    else if (-1 == threadStruct.tid) {
+        return ErrorType::Success;
+    }
+
+    struct timespec cpuTime;
+    if (0 == clock_gettime(threadStruct.cpuClock, &cpuTime)) {
+        thread.cpuTime = Microseconds(cpuTime.tv_sec) * 1000000 + cpuTime.tv_nsec / 1000;
+    }
+
+    std::array<char, sizeof("/proc/self/task/") + 10 + sizeof("/status")> path;
+    snprintf(path.data(), path.size(), "/proc/self/task/%d/status", threadStruct.tid);
+    std::array<char, 2048> status;
+    if (readProcFile(threadStruct.statusFileDescriptor, path.data(), status) > 0) {
+        thread.voluntaryContextSwitches = procFileField(status.data(), "\nvoluntary_ctxt_switches:");
+        thread.involuntaryContextSwitches = procFileField(status.data(), "\nnonvoluntary_ctxt_switches:");
+    }
+
+    return ErrorType::Success;
+}
+
+Bytes OperatingSystem::stackHighWaterMark(const Thread &thread) const {
+    //Stacks grow down so the deepest the thread has been is the lowest address that isn't the fill pattern.
+    const uint32_t *word = reinterpret_cast<const uint32_t *>(thread.stackMapping + (thread.stackMappingSize - thread.stackSize));
+    const uint32_t *const top = word + thread.stackSize / sizeof(uint32_t);
+
+    while (word < top && StackFillPattern == *word) {
+        word++;
+    }
+
+    return (top - word) * sizeof(uint32_t);
+}
+
+void OperatingSystem::releaseThreadResources(Thread &thread) {
+    if (-1 != thread.statusFileDescriptor) {
+        close(thread.statusFileDescriptor);
+        thread.statusFileDescriptor = -1;
+    }
+
+    if (nullptr != thread.stackMapping) {
+        munmap(thread.stackMapping, thread.stackMappingSize);
+        thread.stackMapping = nullptr;
+    }
+}
+
+ErrorType OperatingSystem::systemCpuTime(uint64_t &total, uint64_t &idle) {
+    //Only the first line which is the sum of all CPUs is needed.
+    std::array<char, 256> stat;
+    unsigned long long user, nice, system, idleTime, ioWait, irq, softIrq, steal;
+
+    if (readProcFile(_procStatFileDescriptor, "/proc/stat", stat) <= 0) {
+        return ErrorType::Failure;
+    }
+
+    if (8 != sscanf(stat.data(), "cpu %llu %llu %llu %llu %llu %llu %llu %llu", &user, &nice, &system, &idleTime, &ioWait, &irq, &softIrq, &steal)) {
+        return ErrorType::Failure;
+    }
+
+    //Guest time is already counted in user time.
+    total = user + nice + system + idleTime + ioWait + irq + softIrq + steal;
+    idle = idleTime + ioWait;
+
+    return ErrorType::Success;
+}
+
+ErrorType OperatingSystem::onlineCores(Count &cores) {
+    const long online = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (online < 1) {
+        return fromPlatformError(errno);
+    }
+
+    cores = static_cast<Count>(online);
+    return ErrorType::Success;
+}
+
+ErrorType OperatingSystem::uptime(Seconds &uptime) {
+    const auto duration = std::chrono::steady_clock::now() - _startTime;
+    uptime = std::chrono::duration_cast<std::chrono::seconds>(duration).count();
+    return ErrorType::Success;
+}
+
+ErrorType OperatingSystem::disableAllInterrupts() {
+    const void *callSite = __builtin_return_address(0);
+    const pthread_t self = pthread_self();
+
+    //Nested entries are free.
+    if (pthread_equal(self, _criticalSectionOwner.load(std::memory_order_relaxed))) {
+        _criticalSectionDepth++;
+        return ErrorType::Success;
+    }
+
+    Microseconds timeWaiting;
+    const bool contended = lockCriticalSection(timeWaiting);
+    _criticalSectionOwner.store(self, std::memory_order_relaxed);
+    _criticalSectionDepth = 1;
+
+    //Open addressing on the call site. The last entry collects any call sites that don't fit.
+    size_t index = (reinterpret_cast<uintptr_t>(callSite) >> 2) % (_criticalSectionCallSites.size() - 1);
+    for (size_t probes = 0; probes < _criticalSectionCallSites.size() - 1; probes++) {
+        if (nullptr == _criticalSectionCallSites[index].callSite) {
+            _criticalSectionCallSites[index].callSite = callSite;
+        }
+        if (callSite == _criticalSectionCallSites[index].callSite) {
+            break;
+        }
+
+        index = (index + 1) % (_criticalSectionCallSites.size() - 1);
+    }
+    if (callSite != _criticalSectionCallSites[index].callSite) {
+        index = _criticalSectionCallSites.size() - 1;
+    }
+
+    CriticalSectionStatistics &statistics = _criticalSectionCallSites[index];
+    statistics.entries++;
+    if (contended) {
+        statistics.contentions++;
+        statistics.timeWaiting += timeWaiting;
+    }
+
+    return ErrorType::Success;
+}
+
+ErrorType OperatingSystem::enableAllInterrupts() {
+    if (!pthread_equal(pthread_self(), _criticalSectionOwner.load(std::memory_order_relaxed))) {
+        return ErrorType::PrerequisitesNotMet;
+    }
+
+    if (--_criticalSectionDepth > 0) {
+        return ErrorType::Success;
+    }
+
+    _criticalSectionOwner.store(pthread_t(), std::memory_order_relaxed);
+    unlockCriticalSection();
+
+    return ErrorType::Success;
+}
+
+ErrorType OperatingSystem::criticalSectionStatistics(std::vector<CriticalSectionStatistics> &statistics) {
+    const bool alreadyOwned = pthread_equal(pthread_self(), _criticalSectionOwner.load(std::memory_order_relaxed));
+    statistics.clear();
+
+    Microseconds timeWaiting;
+    if (!alreadyOwned) {
+        lockCriticalSection(timeWaiting);
+    }
+
+    for (size_t i = 0; i < _criticalSectionCallSites.size(); i++) {
+        if (_criticalSectionCallSites[i].entries > 0) {
+            statistics.push_back(_criticalSectionCallSites[i]);
+            //The overflow entry stores the last call site that didn't fit. Don't let that be mistaken for a single call site.
+            if (_criticalSectionCallSites.size() - 1 == i) {
+                statistics.back().callSite = nullptr;
             }
         }
     }
 
-    return error;
+    if (!alreadyOwned) {
+        unlockCriticalSection();
+    }
+
+    std::sort(statistics.begin(), statistics.end(), [](const auto &a, const auto &b) { return a.timeWaiting > b.timeWaiting; });
+
+    return ErrorType::Success;
+}
+
+bool OperatingSystem::lockCriticalSection(Microseconds &timeWaiting) {
+    uint32_t state = 0;
+    if (_criticalSectionLock.compare_exchange_strong(state, 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+        return false;
+    }
+
+    const auto waitStart = std::chrono::steady_clock::now();
+
+    for (Count i = 0; i < CriticalSectionSpins; i++) {
+        cpuRelax();
+        state = 0;
+        if (0 == _criticalSectionLock.load(std::memory_order_relaxed) && _criticalSectionLock.compare_exchange_weak(state, 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+            timeWaiting = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - waitStart).count();
+            return true;
+        }
+    }
+
+    //Mark the lock as having waiters so that the owner knows to wake us. We own it if it was free when we did.
+    while (0 != _criticalSectionLock.exchange(2, std::memory_order_acquire)) {
+        futex(_criticalSectionLock, FUTEX_WAIT_PRIVATE, 2, nullptr);
+    }
+
+    timeWaiting = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - waitStart).count();
+    return true;
 }
 
-void OperatingSystem::callTimerCallback(timer_t *const posixTimerId) {
-    assert(nullptr != posixTimerId);
+void OperatingSystem::unlockCriticalSection() {
+    if (2 == _criticalSectionLock.exchange(0, std::memory_order_release)) {
+        futex(_criticalSectionLock, FUTEX_WAKE_PRIVATE, 1, nullptr);
+    }
+}
 
-    if (timers.contains(*posixTimerId)) {
-        timers[*posixTimerId].callback();
+ErrorType OperatingSystem::block() {
+    return blockCurrentThread(nullptr);
+}
 
-        const bool timerIsOneShot = !timers[*posixTimerId].autoReload;
-        if (timerIsOneShot) {
-            deleteTimer(timers[*posixTimerId].id);
+ErrorType OperatingSystem::blockUntil(const Nanoseconds time) {
+    const struct timespec deadline = {
+        .tv_sec = static_cast<time_t>(time / 1000000000),
+        .tv_nsec = static_cast<long>(time % 1000000000)
+    };
+
+    return blockCurrentThread(&deadline);
+}
+
+ErrorType OperatingSystem::blockCurrentThread(const struct timespec *deadline) {
+    const Id task = CurrentThreadId;
+
+    if (OperatingSystemTypes::NullId == task) {
+        return ErrorType::NoData;
+    }
+
+    Thread &threadStruct = threads[toThreadIndex(task)];
+    std::atomic_ref<uint32_t> wakeState(threadStruct.wakeState);
+    std::atomic_ref<OperatingSystemTypes::ThreadStatus> status(threadStruct.status);
+    bool timedOut = false;
+
+    if (WakeNotified == wakeState.exchange(WakeEmpty, std::memory_order_acquire)) {
+        return ErrorType::LimitReached;
+    }
+
+    status.store(OperatingSystemTypes::ThreadStatus::Blocked, std::memory_order_relaxed);
+
+    if (!spinUntilNotified(wakeState, std::atomic_ref<Microseconds>(threadStruct.spinBudget).load(std::memory_order_relaxed))) {
+        uint32_t expected = WakeEmpty;
+
+        //If this fails we were notified after we stopped spinning.
+        if (wakeState.compare_exchange_strong(expected, WakeParked, std::memory_order_acquire)) {
+            //The loop is only to protect against spurious wakeups and signals.
+            do {
+                if (-1 == futex(threadStruct.wakeState, FUTEX_WAIT_BITSET_PRIVATE, WakeParked, deadline) && ETIMEDOUT == errno) {
+                    timedOut = true;
+                    break;
+                }
+            } while (WakeParked == wakeState.load(std::memory_order_acquire));
         }
     }
 
-    return;
+    //Consume the notification. Any unblock from here on is kept for the next call.
+    const uint32_t woken = wakeState.exchange(WakeEmpty, std::memory_order_acquire);
+    status.store(OperatingSystemTypes::ThreadStatus::Active, std::memory_order_relaxed);
+
+    //An unblock that raced with the timeout still counts as being unblocked.
+    if (timedOut && WakeNotified != woken) {
+        return ErrorType::Timeout;
+    }
+
+    return ErrorType::Success;
+}
+
+ErrorType OperatingSystem::unblock(const Id task) {
+    const bool threadExists = OperatingSystemTypes::NullId != task && task <= threads.size() && threads[toThreadIndex(task)].threadId == task;
+    if (!threadExists) {
+        return ErrorType::NoData;
+    }
+
+    Thread &threadStruct = threads[toThreadIndex(task)];
+
+    //A thread that is still spinning sees the notification without needing a system call.
+    if (WakeParked == std::atomic_ref<uint32_t>(threadStruct.wakeState).exchange(WakeNotified, std::memory_order_release)) {
+        futex(threadStruct.wakeState, FUTEX_WAKE_PRIVATE, 1, nullptr);
+    }
+
+    return ErrorType::Success;
+}
+
+ErrorType OperatingSystem::setSpinBudget(const Id thread, const Microseconds budget) {
+    const bool threadExists = OperatingSystemTypes::NullId != thread && thread <= threads.size() && threads[toThreadIndex(thread)].threadId == thread;
+    if (!threadExists) {
+        return ErrorType::NoData;
+    }
+
+    std::atomic_ref<Microseconds>(threads[toThreadIndex(thread)].spinBudget).store(budget, std::memory_order_relaxed);
+
+    return ErrorType::Success;
+}
+
+void OperatingSystem::timerService() {
+    uint64_t expirations;
+
+    while (true) {
+        //The number of expirations isn't needed since every timer that has expired is still in the heap. A failed read (e.g. EINTR)
+        //just means we check the heap early.
+        [[maybe_unused]] const ssize_t bytesRead = read(_timerFileDescriptor, &expirations, sizeof(expirations));
+
+        pthread_mutex_lock(&_timerMutex);
+        auto now = std::chrono::steady_clock::now();
+
+        while (!_timerHeap.empty() && _timerHeap.front()->expiry <= now) {
+            Timer &timer = *_timerHeap.front();
+            const Id id = timer.id;
+            const bool timerIsOneShot = !timer.autoReload;
+            const auto expiry = timer.expiry;
+            disarmTimer(timer);
+
+            if (!timerIsOneShot) {
+                //Reload from when the timer was supposed to expire so that the period doesn't drift. If we have fallen more than a
+                //period behind, skip the expirations that were missed rather than firing them all back to back.
+                const auto period = std::chrono::milliseconds(timer.period);
+                armTimer(timer, (expiry + period > now) ? expiry + period : now + period);
+            }
+
+            //The lock is not held during the callback so that it can start, stop or delete timers (including itself).
+            std::function<void(void)> callback = timer.callback;
+            pthread_mutex_unlock(&_timerMutex);
+            callback();
+            pthread_mutex_lock(&_timerMutex);
+
+            if (timerIsOneShot) {
+                auto itr = timers.find(id);
+                const bool timerWasNotRestarted = timers.end() != itr && NotArmed == itr->second.heapIndex;
+                if (timerWasNotRestarted) {
+                    timers.erase(itr);
+                }
+            }
+
+            now = std::chrono::steady_clock::now();
+        }
+
+        //The timerfd may have been left armed for a timer that was already dispatched.
+        updateTimerFileDescriptor();
+        pthread_mutex_unlock(&_timerMutex);
+    }
 }
 
 ErrorType OperatingSystem::getSystemMacAddress(std::array<char, NetworkTypes::MacAddressStringSize> &macAddress) {
@@ -710,8 +1739,9 @@ ErrorType OperatingSystem::getSystemMacAddress(std::array<char, NetworkTypes::Ma
 extern "C" {
 #endif
 
-void TimerCallback(union sigval val) {
-    OperatingSystem::Instance().callTimerCallback((timer_t *)val.sival_ptr);
+void *TimerServiceThread([[maybe_unused]] void *arguments) {
+    OperatingSystem::Instance().timerService();
+    return nullptr;
 }
 
 #ifdef __cplusplus
@@ -4,21 +4,55 @@
 //AbstractionLayer
 #include "OperatingSystemAbstraction.hpp"
 #include "Global.hpp"
+#include "SeqLock.hpp"
 //Posix
 #include <sched.h>
-#include <semaphore.h>
+#include <sys/resource.h>
 //C++
 #include <cassert>
 #include <ctime>
 #include <map>
 #include <chrono>
+#include <memory>
+#include <vector>
+#include <atomic>
 
 class OperatingSystem final : public OperatingSystemAbstraction, public Global<OperatingSystem> {
 
     public:
+    /**
+     * @struct RealTimeOptions
+     * @brief Options for threads that need to run deterministically.
+     * @details Stacks are always prefaulted when a thread is created. Combine with lockMemory() or lockStack so that they stay resident.
+     */
+    struct RealTimeOptions {
+        /**
+         * @enum Policy
+         * @brief The scheduling policy for the thread.
+         */
+        enum class Policy : uint8_t {
+            RoundRobin = 0, ///< SCHED_RR at the priority given to createThread. The policy used for threads created without options.
+            Fifo,           ///< SCHED_FIFO at the priority given to createThread. Runs until it blocks or a higher priority thread is ready.
+            Deadline        ///< SCHED_DEADLINE. The priority is ignored and the runtime, deadline and period are used instead.
+        };
+
+        Policy policy = Policy::RoundRobin; ///< The scheduling policy for the thread.
+        cpu_set_t affinity = {};            ///< The CPUs the thread may run on. The thread may run on any CPU if no CPUs are set.
+        Microseconds runtime = 0;           ///< Deadline policy only. The CPU time the thread needs every period.
+        Microseconds deadline = 0;          ///< Deadline policy only. The runtime must be delivered within this amount of time from the start of the period.
+        Microseconds period = 0;            ///< Deadline policy only. How often the thread runs.
+        bool lockStack = false;             ///< Lock the stack into memory so that it never page faults.
+    };
+
     OperatingSystem() : OperatingSystemAbstraction(), Global<OperatingSystem>() {
         _startTime = std::chrono::steady_clock::now();
 
+        //Cores do not come and go often enough to be worth checking every time a thread is created.
+        Count cores = 0;
+        if (ErrorType::Success == onlineCores(cores) && cores > 1) {
+            _newThreadSpinBudget = DefaultSpinBudget;
+        }
+
         // Add Heap memory region
         constexpr std::array<char, OperatingSystemTypes::MaxMemoryRegionNameLength> heap = {"Heap"};
         _status.memoryRegion.emplace_back(heap);
@@ -38,15 +72,35 @@ class OperatingSystem final : public OperatingSystemAbstraction, public Global<O
     ErrorType waitSemaphore(const std::array<char, OperatingSystemTypes::MaxSemaphoreNameLength> &name, const Milliseconds timeout) override;
     ErrorType incrementSemaphore(const std::array<char, OperatingSystemTypes::MaxSemaphoreNameLength> &name) override;
     ErrorType decrementSemaphore(const std::array<char, OperatingSystemTypes::MaxSemaphoreNameLength> &name) override;
+    ErrorType createSemaphore(const Count max, const Count initial, const std::array<char, OperatingSystemTypes::MaxSemaphoreNameLength> &name, Id &semaphore) override;
+    ErrorType deleteSemaphore(const Id semaphore) override;
+    ErrorType waitSemaphore(const Id semaphore, const Milliseconds timeout) override;
+    ErrorType incrementSemaphore(const Id semaphore) override;
+    ErrorType decrementSemaphore(const Id semaphore) override;
+    ErrorType createMutex(Id &mutex, const bool priorityInheritance) override;
+    ErrorType deleteMutex(const Id mutex) override;
+    ErrorType lockMutex(const Id mutex, const Milliseconds timeout) override;
+    ErrorType unlockMutex(const Id mutex) override;
+    ErrorType createReadWriteLock(Id &lock) override;
+    ErrorType deleteReadWriteLock(const Id lock) override;
+    ErrorType lockRead(const Id lock, const Milliseconds timeout) override;
+    ErrorType lockWrite(const Id lock, const Milliseconds timeout) override;
+    ErrorType unlockReadWriteLock(const Id lock) override;
     ErrorType createTimer(Id &timer, Milliseconds period, bool autoReload, std::function<void(void)> callback) override;
     ErrorType deleteTimer(const Id timer) override;
     ErrorType startTimer(Id timer, Milliseconds timeout) override;
     ErrorType stopTimer(Id timer, Milliseconds timeout) override;
+    ErrorType createPeriodicTask(Id &task, const Microseconds period, const Microseconds spin) override;
+    ErrorType deletePeriodicTask(const Id task) override;
+    ErrorType waitUntilNextPeriod(const Id task) override;
+    ErrorType periodicTaskStatistics(const Id task, OperatingSystemTypes::PeriodicTaskStatistics &statistics) override;
     ErrorType createQueue(const std::array<char, OperatingSystemTypes::MaxQueueNameLength> &name, const Bytes size, const Count length) override;
     ErrorType sendToQueue(const std::array<char, OperatingSystemTypes::MaxQueueNameLength> &name, const void *data, const Milliseconds timeout, const bool toFront, const bool fromIsr) override;
     ErrorType receiveFromQueue(const std::array<char, OperatingSystemTypes::MaxQueueNameLength> &name, void *buffer, const Milliseconds timeout, const bool fromIsr) override;
     ErrorType peekFromQueue(const std::array<char, OperatingSystemTypes::MaxQueueNameLength> &name, void *buffer, const Milliseconds timeout, const bool fromIsr) override;
     ErrorType getSystemTime(UnixTime &currentSystemUnixTime) override;
+    ErrorType getSystemTime(Microseconds &currentSystemTime) override;
+    ErrorType monotonicTime(Nanoseconds &time) override;
     ErrorType getSystemTick(Ticks &currentSystemTicks) override;
     ErrorType ticksToMilliseconds(const Ticks ticks, Milliseconds &timeInMilliseconds) override;
     ErrorType millisecondsToTicks(const Milliseconds milli, Ticks &ticks) override;
@@ -56,10 +110,14 @@ class OperatingSystem final : public OperatingSystemAbstraction, public Global<O
     ErrorType setTimeOfDay(const UnixTime utc, const int16_t timeZoneDifferenceUtc) override;
     ErrorType idlePercentage(Percent &idlePercent) override;
     ErrorType memoryRegionUsage(OperatingSystemTypes::MemoryRegionInfo &region) override;
+    ErrorType processUsage(OperatingSystemTypes::ProcessUsage &usage) override;
+    ErrorType threadUsage(OperatingSystemTypes::ThreadInfo &thread) override;
+    ErrorType onlineCores(Count &cores) override;
     ErrorType uptime(Seconds &uptime) override;
     ErrorType disableAllInterrupts() override;
     ErrorType enableAllInterrupts() override;
     ErrorType block() override;
+    ErrorType blockUntil(const Nanoseconds time) override;
     ErrorType unblock(const Id task) override;
     ErrorType getSystemMacAddress(std::array<char, NetworkTypes::MacAddressStringSize> &macAddress) override;
 
@@ -85,40 +143,351 @@ class OperatingSystem final : public OperatingSystemAbstraction, public Global<O
         }
     }
 
-    void callTimerCallback(timer_t *const posixTimerId);
+    /**
+     * @brief Create a thread with real-time scheduling options.
+     * @details Requires CAP_SYS_NICE (or a suitable RLIMIT_RTPRIO) for the real-time policies.
+     * @sa OperatingSystemAbstraction::createThread
+     * @param[in] options The real-time options for the thread.
+     * @returns ErrorType::InvalidParameter if the deadline policy parameters are not runtime <= deadline <= period.
+     * @returns Anything returned by OperatingSystemAbstraction::createThread.
+     */
+    ErrorType createThread(const OperatingSystemTypes::Priority priority, const std::array<char, OperatingSystemTypes::MaxThreadNameLength> &name, void * arguments, const Bytes stackSize, void *(*startFunction)(void *), Id &number, const RealTimeOptions &options);
+    /**
+     * @brief Lock all current and future memory of the process into RAM so that it can never be paged out.
+     * @returns ErrorType::Success if the memory was locked.
+     * @returns The error from mlockall otherwise.
+     */
+    ErrorType lockMemory();
+    /**
+     * @brief Allow memory locked by lockMemory() to be paged out again.
+     * @returns ErrorType::Success if the memory was unlocked.
+     * @returns The error from munlockall otherwise.
+     */
+    ErrorType unlockMemory();
+    /**
+     * @brief Set how long a thread spins waiting to be unblocked before block() puts it to sleep.
+     * @details Waking a thread that is still spinning costs a single atomic write instead of a futex wake and a trip through the
+     *          scheduler, which is worth it when the thread that unblocks us usually does so within a few microseconds. Spinning
+     *          burns the core for up to the whole budget when the wake up takes longer. Threads start with DefaultSpinBudget on
+     *          multi-core systems and 0 on single core systems where spinning only delays the thread that would unblock us.
+     * @param[in] thread The thread to set the spin budget for.
+     * @param[in] budget How long to spin. 0 always sleeps straight away.
+     * @returns ErrorType::Success if the budget was set.
+     * @returns ErrorType::NoData if the thread does not exist.
+     */
+    ErrorType setSpinBudget(const Id thread, const Microseconds budget);
+    /// @brief The spin budget given to new threads on multi-core systems.
+    static constexpr Microseconds DefaultSpinBudget = 20;
+
+    /**
+     * @struct CriticalSectionStatistics
+     * @brief How often a call site entered the critical section and how long it waited to get in.
+     */
+    struct CriticalSectionStatistics {
+        const void *callSite;     ///< The return address of the call to disableAllInterrupts(). Resolve it with addr2line. nullptr for call sites that didn't fit in the table.
+        Count entries;            ///< The number of times the call site entered the critical section. Nested entries are not counted.
+        Count contentions;        ///< The number of times another thread was already in the critical section.
+        Microseconds timeWaiting; ///< The total time spent waiting for other threads to leave the critical section.
+    };
+    /**
+     * @brief Get the statistics for every call site that has entered the critical section.
+     * @details On Linux, disableAllInterrupts() and enableAllInterrupts() are a recursive, process-wide lock. The call sites that
+     *          wait the longest are the ones serializing the system.
+     * @param[out] statistics The statistics, sorted by the time spent waiting with the longest first.
+     * @returns ErrorType::Success
+     */
+    ErrorType criticalSectionStatistics(std::vector<CriticalSectionStatistics> &statistics);
+
+    /**
+     * @brief Dispatch timers as they expire.
+     * @details Runs on the timer service thread and never returns. Only the timer service thread should call this.
+     */
+    void timerService();
 
     private:
     struct Thread {
         pthread_t posixThreadId;
         std::array<char, OperatingSystemTypes::MaxThreadNameLength> name;
         Id threadId;
-        int blockCount;
         OperatingSystemTypes::ThreadStatus status;
-        pthread_mutex_t mutex;
-        pthread_cond_t conditionVariable;
+        uint32_t wakeState;                     ///< Futex word for block() and unblock(). Only accessed through std::atomic_ref so that Thread stays copyable.
+        Microseconds spinBudget;                ///< How long block() spins before sleeping. Only accessed through std::atomic_ref.
+        pid_t tid = -1;                         ///< The kernel's id for the thread. Used to find the thread in /proc/self/task.
+        clockid_t cpuClock = 0;                 ///< Clock that measures the CPU time used by the thread.
+        int statusFileDescriptor = -1;          ///< /proc/self/task/<tid>/status
+        uint8_t *stackMapping = nullptr;        ///< The start of the memory mapped for the stack, including the guard page.
+        Bytes stackMappingSize = 0;             ///< The size of the memory mapped for the stack, including the guard page.
+        Bytes stackSize = 0;                    ///< The size of the stack that the thread can use.
+        bool exited = false;                    ///< True once the start function of the thread has returned.
+        struct rusage usageAtExit = {};         ///< The resources used by the thread by the time it exited.
     };
+    /// @brief Written to the whole stack when a thread is created so that the stack high water mark can be found.
+    static constexpr uint32_t StackFillPattern = 0xA5A5A5A5;
 
+    /**
+     * @struct Timer
+     * @brief A timer that is dispatched by the timer service thread.
+     * @details Armed timers are kept in a min-heap ordered by expiry. Each timer remembers its position in the heap so that
+     *          it can be stopped or restarted in O(log n).
+     */
     struct Timer {
-        std::function<void(void)> callback;
-        Id id;
-        timer_t *posixTimerId;
-        bool autoReload;
-        Milliseconds period;
+        std::function<void(void)> callback;             ///< Called from the timer service thread when the timer expires.
+        Id id;                                          ///< The id of the timer.
+        bool autoReload;                                ///< True if the timer is rearmed after it expires.
+        Milliseconds period;                            ///< The period of the timer.
+        std::chrono::steady_clock::time_point expiry;   ///< When the timer expires next. Only valid while the timer is armed.
+        size_t heapIndex;                               ///< The position of the timer in the heap or NotArmed.
     };
+    static constexpr size_t NotArmed = SIZE_MAX;
 
-    std::map<timer_t, Timer> timers;
+    std::map<Id, Timer> timers;
+    /// @brief Min-heap of armed timers. The timer that expires first is at the front.
+    std::vector<Timer *> _timerHeap;
+    /// @brief Protects timers and the heap.
+    pthread_mutex_t _timerMutex = PTHREAD_MUTEX_INITIALIZER;
+    /// @brief Armed to expire at the same time as the timer at the front of the heap.
+    int _timerFileDescriptor = -1;
+    /// @brief Created the first time a timer is so that applications without timers don't pay for the thread.
+    Id _timerServiceThreadId = OperatingSystemTypes::NullId;
+    static constexpr Bytes _TimerServiceStackSize = 256 * 1024;
     Id _nextTimerId = 0;
 
+    /**
+     * @struct Queue
+     * @brief A bounded, fixed size ring buffer of queue items.
+     * @details All of the storage is allocated when the queue is created so that sending and receiving never allocates.
+     *          Any number of threads may send and receive concurrently.
+     */
+    struct Queue {
+        std::unique_ptr<uint8_t[]> storage; ///< length * itemSize bytes of storage for the items.
+        Bytes itemSize;                     ///< The size of each item in the queue.
+        Count length;                       ///< The maximum number of items that can be in the queue.
+        Count front;                        ///< The index of the item at the front of the queue.
+        Count itemsQueued;                  ///< The number of items currently in the queue.
+        pthread_mutex_t mutex;              ///< Protects all other members of the queue.
+        pthread_cond_t notEmpty;            ///< Signalled when an item is added to the queue.
+        pthread_cond_t notFull;             ///< Signalled when an item is removed from the queue.
+
+        /// @brief Initialize the mutex and condition variables. pthread objects can not be moved so the queue is constructed in place.
+        Queue(std::unique_ptr<uint8_t[]> storage, const Bytes itemSize, const Count length);
+        /// @brief Destroy the mutex and condition variables.
+        ~Queue();
+        Queue(const Queue &) = delete;
+        Queue &operator=(const Queue &) = delete;
+
+        /// @brief Get the storage for the item at the given position relative to the front of the queue.
+        uint8_t *itemAt(const Count position) { return &storage[((front + position) % length) * itemSize]; }
+    };
+
+    /**
+     * @struct Semaphore
+     * @brief A process-local counting semaphore built on a futex.
+     * @details The count is the futex word so posting and waiting on a semaphore that does not need to block never enter the kernel.
+     */
+    struct Semaphore {
+        std::atomic<uint32_t> count = 0;    ///< The value of the semaphore. Also the futex word that waiters sleep on.
+        std::atomic<uint32_t> waiters = 0;  ///< The number of threads sleeping on the futex so that posts only wake when someone is waiting.
+        Count max = 0;                      ///< The maximum value of the semaphore.
+        std::atomic<bool> inUse = false;    ///< True if the semaphore has been created and not deleted.
+    };
+    static_assert(std::atomic<uint32_t>::is_always_lock_free && sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "Semaphore count must be usable as a futex word.");
+    /// @brief The maximum number of semaphores that can exist at once.
+    static constexpr Count MaxSemaphores = 256;
+    /// @struct Mutex
+    /// @brief A pthread mutex that can be looked up by handle.
+    struct Mutex {
+        pthread_mutex_t mutex;              ///< The mutex. Only initialized while inUse is true.
+        std::atomic<bool> inUse = false;    ///< True if the mutex has been created and not deleted.
+    };
+    /// @brief The maximum number of mutexes that can exist at once.
+    static constexpr Count MaxMutexes = 256;
+    /// @struct ReadWriteLock
+    /// @brief A pthread reader-writer lock that can be looked up by handle.
+    struct ReadWriteLock {
+        pthread_rwlock_t lock;              ///< The lock. Only initialized while inUse is true.
+        std::atomic<bool> inUse = false;    ///< True if the lock has been created and not deleted.
+    };
+    /// @brief The maximum number of reader-writer locks that can exist at once.
+    static constexpr Count MaxReadWriteLocks = 256;
+    /// @struct PeriodicTask
+    /// @brief The schedule of a thread that runs at a fixed rate.
+    struct PeriodicTask {
+        uint64_t release = 0;                                                  ///< The start of the current period on CLOCK_MONOTONIC in nanoseconds.
+        Microseconds period = 0;                                               ///< The time between the start of each period.
+        Microseconds spin = 0;                                                 ///< How long before the start of each period to spin instead of sleep.
+        Microseconds totalJitter = 0;                                          ///< The sum of the jitter of every period for the average.
+        SeqLock<OperatingSystemTypes::PeriodicTaskStatistics> statistics;     ///< Written by the task and read from any thread.
+        std::atomic<bool> inUse = false;                                       ///< True if the task has been created and not deleted.
+    };
+    /// @brief The maximum number of periodic tasks that can exist at once.
+    static constexpr Count MaxPeriodicTasks = 64;
+
     std::array<Thread, APP_MAX_NUMBER_OF_THREADS> threads;
-    std::map<std::array<char, OperatingSystemTypes::MaxSemaphoreNameLength>, sem_t *> semaphores;
+    /// @brief Semaphores are looked up by handle. The handle is the index of the semaphore plus one so that NullId is never a valid handle.
+    std::array<Semaphore, MaxSemaphores> _semaphores;
+    /// @brief Handles to semaphores that were created with a name.
+    std::map<std::array<char, OperatingSystemTypes::MaxSemaphoreNameLength>, Id> semaphores;
+    /// @brief Protects semaphores and the creation and deletion of _semaphores.
+    pthread_mutex_t _semaphoreMutex = PTHREAD_MUTEX_INITIALIZER;
+    /// @brief Mutexes are looked up by handle the same way as semaphores.
+    std::array<Mutex, MaxMutexes> _mutexes;
+    /// @brief Reader-writer locks are looked up by handle the same way as semaphores.
+    std::array<ReadWriteLock, MaxReadWriteLocks> _readWriteLocks;
+    /// @brief Protects the creation and deletion of _mutexes and _readWriteLocks.
+    pthread_mutex_t _lockMutex = PTHREAD_MUTEX_INITIALIZER;
+    /// @brief Periodic tasks are looked up by handle the same way as semaphores.
+    std::array<PeriodicTask, MaxPeriodicTasks> _periodicTasks;
+    /// @brief Protects the creation and deletion of _periodicTasks.
+    pthread_mutex_t _periodicTaskMutex = PTHREAD_MUTEX_INITIALIZER;
+    /// @brief Queues are never removed once created so a queue found in the map stays valid after _queueMutex is released.
+    std::map<std::array<char, OperatingSystemTypes::MaxQueueNameLength>, Queue> queues;
+    /// @brief Protects queues. Each queue has its own mutex for its contents.
+    pthread_mutex_t _queueMutex = PTHREAD_MUTEX_INITIALIZER;
 
-    bool _interruptsDisabled = false;
+    /// @brief Futex word for the critical section. 0 when free, 1 when taken, 2 when taken and there may be threads waiting.
+    std::atomic<uint32_t> _criticalSectionLock = 0;
+    /// @brief The thread in the critical section. Only ever set to the calling thread's own id so relaxed loads are enough to tell if we own it.
+    std::atomic<pthread_t> _criticalSectionOwner = pthread_t();
+    /// @brief How many times the owner has entered the critical section without leaving it.
+    Count _criticalSectionDepth = 0;
+    /// @brief Spins on the critical section before sleeping since they are normally held for a very short time.
+    static constexpr Count CriticalSectionSpins = 100;
+    /// @brief The maximum number of call sites that statistics are kept for. Any others share one entry.
+    static constexpr Count MaxCriticalSectionCallSites = 64;
+    /// @brief Statistics for each call site. Only written while holding the critical section.
+    std::array<CriticalSectionStatistics, MaxCriticalSectionCallSites> _criticalSectionCallSites = {};
+
+    /// @brief Files in /proc are opened the first time they are read and kept open so that each sample is a single pread.
+    int _procStatFileDescriptor = -1;
+    int _procSelfStatFileDescriptor = -1;
+    int _procSelfStatusFileDescriptor = -1;
+    int _procMeminfoFileDescriptor = -1;
+    /// @brief CPU times from the previous sample for idlePercentage. In units of clock ticks.
+    uint64_t _idleSampleTotalTime = 0;
+    uint64_t _idleSampleIdleTime = 0;
+    /// @brief CPU times from the previous sample for processUsage. In units of clock ticks.
+    uint64_t _processSampleTotalTime = 0;
+    uint64_t _processSampleProcessTime = 0;
 
     std::chrono::steady_clock::time_point _startTime;
+    /// @brief The spin budget given to new threads. DefaultSpinBudget on multi-core systems and 0 on single core systems.
+    Microseconds _newThreadSpinBudget = 0;
 
     int toThreadIndex(Id thread) {
         return thread - 1;
     }
+
+    /**
+     * @brief Read the total and idle CPU time of all CPUs from /proc/stat.
+     * @param[out] total The total CPU time in clock ticks.
+     * @param[out] idle The idle CPU time in clock ticks.
+     * @returns ErrorType::Success if the CPU times were read.
+     * @returns ErrorType::Failure otherwise.
+     */
+    ErrorType systemCpuTime(uint64_t &total, uint64_t &idle);
+    /**
+     * @brief The most stack a thread has used at once.
+     * @details Found by scanning from the bottom of the stack for the first word that has been changed from the fill pattern.
+     */
+    Bytes stackHighWaterMark(const Thread &thread) const;
+    /**
+     * @brief Take the critical section lock.
+     * @param[out] timeWaiting How long it took to get the lock. Only set if another thread was holding it.
+     * @returns true if another thread was holding it.
+     */
+    bool lockCriticalSection(Microseconds &timeWaiting);
+    /// @brief Release the critical section lock and wake a waiter if there is one.
+    void unlockCriticalSection();
+    /// @brief Unmap the stack of a thread that has exited and close any files opened for it.
+    void releaseThreadResources(Thread &thread);
+    /**
+     * @brief Block the calling thread until it is unblocked or the deadline passes.
+     * @param[in] deadline Absolute time on CLOCK_MONOTONIC. nullptr to wait forever.
+     * @sa block
+     */
+    ErrorType blockCurrentThread(const struct timespec *deadline);
+
+    /// @brief Get the semaphore for a handle or nullptr if the handle does not refer to a semaphore that exists.
+    Semaphore *toSemaphore(const Id semaphore) {
+        if (OperatingSystemTypes::NullId == semaphore || semaphore > MaxSemaphores || !_semaphores[semaphore - 1].inUse.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+
+        return &_semaphores[semaphore - 1];
+    }
+
+    /// @brief Get the mutex for a handle or nullptr if the handle does not refer to a mutex that exists.
+    Mutex *toMutex(const Id mutex) {
+        if (OperatingSystemTypes::NullId == mutex || mutex > MaxMutexes || !_mutexes[mutex - 1].inUse.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+
+        return &_mutexes[mutex - 1];
+    }
+
+    /// @brief Get the reader-writer lock for a handle or nullptr if the handle does not refer to a lock that exists.
+    ReadWriteLock *toReadWriteLock(const Id lock) {
+        if (OperatingSystemTypes::NullId == lock || lock > MaxReadWriteLocks || !_readWriteLocks[lock - 1].inUse.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+
+        return &_readWriteLocks[lock - 1];
+    }
+
+    /// @brief Get the periodic task for a handle or nullptr if the handle does not refer to a periodic task that exists.
+    PeriodicTask *toPeriodicTask(const Id task) {
+        if (OperatingSystemTypes::NullId == task || task > MaxPeriodicTasks || !_periodicTasks[task - 1].inUse.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+
+        return &_periodicTasks[task - 1];
+    }
+
+    /// @brief Get the queue with the given name or nullptr if no queue has been created with that name.
+    Queue *toQueue(const std::array<char, OperatingSystemTypes::MaxQueueNameLength> &name);
+
+    /**
+     * @brief Wait on a queue until the predicate is satisfied or the timeout expires.
+     * @pre The queue mutex must be locked.
+     * @param[in] queue The queue to wait on.
+     * @param[in] condition The condition variable to wait on.
+     * @param[in] timeout The maximum amount of time to wait.
+     * @param[in] predicate Returns true when the wait is over.
+     * @returns ErrorType::Success if the predicate was satisfied.
+     * @returns ErrorType::Timeout if the predicate was not satisfied before the timeout.
+     * @post The queue mutex is locked.
+     */
+    template <typename Predicate>
+    ErrorType waitOnQueue(Queue &queue, pthread_cond_t &condition, const Milliseconds timeout, Predicate predicate);
+
+    /**
+     * @brief Create the timer service thread if it hasn't been already.
+     * @pre The timer mutex must be locked.
+     * @returns ErrorType::Success if the timer service is running.
+     * @returns The error from creating the timerfd or the thread otherwise.
+     */
+    ErrorType startTimerService();
+    /**
+     * @brief Add a timer to the heap.
+     * @pre The timer mutex must be locked and the timer must not be armed.
+     */
+    void armTimer(Timer &timer, const std::chrono::steady_clock::time_point expiry);
+    /**
+     * @brief Remove a timer from the heap.
+     * @pre The timer mutex must be locked and the timer must be armed.
+     */
+    void disarmTimer(Timer &timer);
+    /// @brief Move the timer at the given position in the heap towards the front until the heap is ordered.
+    void timerHeapSiftUp(size_t index);
+    /// @brief Move the timer at the given position in the heap towards the back until the heap is ordered.
+    void timerHeapSiftDown(size_t index);
+    /// @brief Swap two timers in the heap.
+    void timerHeapSwap(const size_t a, const size_t b);
+    /**
+     * @brief Arm the timerfd to expire with the timer at the front of the heap, or disarm it if the heap is empty.
+     * @pre The timer mutex must be locked.
+     */
+    void updateTimerFileDescriptor();
 };
 
 #endif // __OPERATING_SYSTEM_HPP__
@@ -11,6 +11,29 @@
 #error "Please define your platforms home directory as APP_HOME_DIRECTORY. Don't include a trailing slash. In CMake, `APP_HOME_DIRECTORY=\"$ENV{HOME}\"` will work."
 #endif
 
+FileSystem::FileSystem(StorageAbstraction &storage, FileSystemTypes::Implementation implementation, FileSystemTypes::PartitionName partitionName) : FileSystemAbstraction(storage, implementation, partitionName) {
+    //Left at 0 if it can't be created. The file system still works from a single thread.
+    if (ErrorType::Success != OperatingSystem::Instance().createMutex(_openFilesMutex, false)) {
+        _openFilesMutex = 0;
+    }
+}
+
+FileSystem::~FileSystem() {
+    if (0 != _openFilesMutex) {
+        OperatingSystem::Instance().deleteMutex(_openFilesMutex);
+    }
+}
+
+bool FileSystem::lockOpenFiles() {
+    return 0 != _openFilesMutex && ErrorType::Success == OperatingSystem::Instance().lockMutex(_openFilesMutex, std::numeric_limits<Milliseconds>::max());
+}
+
+void FileSystem::unlockOpenFiles(const bool locked) {
+    if (locked) {
+        OperatingSystem::Instance().unlockMutex(_openFilesMutex);
+    }
+}
+
 ErrorType FileSystem::mount() {
     const bool fileSystemHasNotBeenMounted = !_status.mounted;
 
@@ -36,53 +59,41 @@ ErrorType FileSystem::unmount() {
 }
 
 ErrorType FileSystem::maxPartitionSize(Bytes &size) {
-    volatile bool maxStorageQueryDone = false;
-    ErrorType callbackError = ErrorType::Failure;
-    Id thread;
-    OperatingSystem::Instance().currentThreadId(thread);
+    EventQueue::Future<> queried;
 
-    auto maxStorageQueryCallback = [&, thread]() -> ErrorType {
+    auto maxStorageQueryCallback = [&, promise = queried.promise()]() -> ErrorType {
         std::filesystem::space_info spaceInfo = std::filesystem::space(mountPrefix().data());
         size = spaceInfo.capacity;
-        maxStorageQueryDone = true;
-        OperatingSystem::Instance().unblock(thread);
-        return callbackError;
+        promise.complete(ErrorType::Success);
+        return ErrorType::Success;
     };
 
     EventQueue::Event event = EventQueue::Event(maxStorageQueryCallback);
     ErrorType error = _storage.addEvent(event);
-    if (ErrorType::Success != error) {
+    if (ErrorType::Success != error || ErrorType::Success != (error = queried.wait())) {
         return error;
     }
 
-    while (!maxStorageQueryDone && ErrorType::LimitReached == OperatingSystem::Instance().block());
-
-    return callbackError;
+    return queried.result();
 }
 
 ErrorType FileSystem::availablePartition(Bytes &size) {
-    volatile bool availableStorageQueryDone = false;
-    ErrorType callbackError = ErrorType::Failure;
-    Id thread;
-    OperatingSystem::Instance().currentThreadId(thread);
+    EventQueue::Future<> queried;
 
-    auto availableStorageQueryCallback = [&, thread]() -> ErrorType {
+    auto availableStorageQueryCallback = [&, promise = queried.promise()]() -> ErrorType {
         std::filesystem::space_info spaceInfo = std::filesystem::space(mountPrefix().data());
         size = spaceInfo.available;
-        availableStorageQueryDone = true;
-        OperatingSystem::Instance().unblock(thread);
-        return callbackError;
+        promise.complete(ErrorType::Success);
+        return ErrorType::Success;
     };
 
     EventQueue::Event event = EventQueue::Event(availableStorageQueryCallback);
     ErrorType error = _storage.addEvent(event);
-    if (ErrorType::Success != error) {
+    if (ErrorType::Success != error || ErrorType::Success != (error = queried.wait())) {
         return error;
-    }   
-
-    while (!availableStorageQueryDone && ErrorType::LimitReached == OperatingSystem::Instance().block());
+    }
 
-    return callbackError;
+    return queried.result();
 }
 
 ErrorType FileSystem::erasePartition() {
@@ -91,16 +102,16 @@ ErrorType FileSystem::erasePartition() {
 
 ErrorType FileSystem::open(std::string_view path, const FileSystemTypes::OpenMode mode, FileSystemTypes::File &file) {
     assert(path.size() > 0);
-    volatile bool openDone = false;
-    ErrorType callbackError = ErrorType::PrerequisitesNotMet;
-    Id thread;
-    OperatingSystem::Instance().currentThreadId(thread);
+    EventQueue::Future<> opened;
+
+    auto openCallback = [&, promise = opened.promise()]() -> ErrorType {
+        ErrorType error = ErrorType::PrerequisitesNotMet;
+        const bool locked = lockOpenFiles();
 
-    auto openCallback = [&, thread]() -> ErrorType {
         if (_storage.status().isInitialized) {
             if (!isOpen(file)) {
-                std::ios_base::openmode openMode = toStdOpenMode(mode, callbackError);
-                if (ErrorType::Success == callbackError) {
+                std::ios_base::openmode openMode = toStdOpenMode(mode, error);
+                if (ErrorType::Success == error) {
                     std::string absolutePath(mountPrefix().data());
                     absolutePath.append(path);
                     const uint32_t key = FileSystemTypes::pathKey(path);
@@ -110,53 +121,51 @@ ErrorType FileSystem::open(std::string_view path, const FileSystemTypes::OpenMod
                     if (openFiles[key].good()) {
                         file.path->assign(path);
 
-                        if (ErrorType::Success == (callbackError = size(file))) {
+                        if (ErrorType::Success == (error = size(file))) {
                             file.isOpen = true;
                             file.openMode = mode;
                             file.filePointer = static_cast<FileOffset>(file.size);
                             openFiles[key].imbue(std::locale::classic());
-                            callbackError = ErrorType::Success;
+                            error = ErrorType::Success;
                         }
                     }
                     else {
                         openFiles.erase(key);
-                        callbackError = ErrorType::Failure;
+                        error = ErrorType::Failure;
                     }
                 }
             }
             else {
-                callbackError = ErrorType::Success;
+                error = ErrorType::Success;
                 _status.openedFiles = openFiles.size();
             }
         }
 
-        openDone = true;
-        OperatingSystem::Instance().unblock(thread);
-        return callbackError;
+        unlockOpenFiles(locked);
+        promise.complete(error);
+        return error;
     };
 
     EventQueue::Event event = EventQueue::Event(openCallback);
     ErrorType error = _storage.addEvent(event);
-    if (ErrorType::Success != error) {
+    if (ErrorType::Success != error || ErrorType::Success != (error = opened.wait())) {
         return error;
     }
 
-    while (!openDone && ErrorType::LimitReached == OperatingSystem::Instance().block());
-
-    return callbackError;
+    return opened.result();
 }
 
 ErrorType FileSystem::close(FileSystemTypes::File &file) {
-    volatile bool closeDone = false;
-    ErrorType callbackError = ErrorType::Success;
-    Id thread;
-    OperatingSystem::Instance().currentThreadId(thread);
+    EventQueue::Future<> closed;
+
+    auto closeCallback = [&, promise = closed.promise()]() -> ErrorType {
+        ErrorType error = ErrorType::Success;
+        const bool locked = lockOpenFiles();
 
-    auto closeCallback = [&, thread]() -> ErrorType {
         if (isOpen(file)) {
             const uint32_t key = FileSystemTypes::pathKey(std::string_view(file.path->c_str()));
 
-            if (ErrorType::Success == (callbackError = synchronize(file))) {
+            if (ErrorType::Success == (error = synchronize(file))) {
                 openFiles[key].close();
                 file.openMode = FileSystemTypes::OpenMode::Unknown;
                 file.isOpen = false;
@@ -165,60 +174,54 @@ ErrorType FileSystem::close(FileSystemTypes::File &file) {
             }
         }
 
-        closeDone = true;
-        OperatingSystem::Instance().unblock(thread);
-        return callbackError;
+        unlockOpenFiles(locked);
+        promise.complete(error);
+        return error;
     };
 
     EventQueue::Event event = EventQueue::Event(closeCallback);
     ErrorType error = _storage.addEvent(event);
-    if (ErrorType::Success != error) {
+    if (ErrorType::Success != error || ErrorType::Success != (error = closed.wait())) {
         return error;
     }
 
-    while (!closeDone && ErrorType::LimitReached == OperatingSystem::Instance().block());
-
-    return callbackError;
+    return closed.result();
 }
 
 ErrorType FileSystem::remove(FileSystemTypes::File &file) {
-    volatile bool removeDone = false;
-    ErrorType callbackError = ErrorType::Failure;
-    Id thread;
-    OperatingSystem::Instance().currentThreadId(thread);
+    EventQueue::Future<> removed;
+
+    auto removeCallback = [&, promise = removed.promise()]() -> ErrorType {
+        ErrorType error = ErrorType::Failure;
 
-    auto removeCallback = [&, thread]() -> ErrorType {
-        if (ErrorType::Success == (callbackError = close(file))) {
+        if (ErrorType::Success == (error = close(file))) {
             std::string absolutePath(mountPrefix().data());
             absolutePath.append(file.path->c_str());
             if (0 == std::remove(absolutePath.c_str())) {
-                callbackError = ErrorType::Success;
+                error = ErrorType::Success;
             }
         }
 
-        removeDone = true;
-        OperatingSystem::Instance().unblock(thread);
-        return callbackError;
+        promise.complete(error);
+        return error;
     };
 
     EventQueue::Event event = EventQueue::Event(removeCallback);
     ErrorType error = _storage.addEvent(event);
-    if (ErrorType::Success != error) {
+    if (ErrorType::Success != error || ErrorType::Success != (error = removed.wait())) {
         return error;
     }
 
-    while (!removeDone && ErrorType::LimitReached == OperatingSystem::Instance().block());
-
-    return callbackError;
+    return removed.result();
 }
 
 ErrorType FileSystem::readBlocking(FileSystemTypes::File &file, char *buffer, const size_t bufferSize, Bytes &read) {
-    volatile bool readDone = false;
-    ErrorType callbackError = ErrorType::PrerequisitesNotMet;
-    Id thread;
-    OperatingSystem::Instance().currentThreadId(thread);
+    EventQueue::Future<> readDone;
+
+    auto readCallback = [&, promise = readDone.promise()]() -> ErrorType {
+        ErrorType error = ErrorType::PrerequisitesNotMet;
+        const bool locked = lockOpenFiles();
 
-    auto readCallback = [&, thread]() -> ErrorType {
         //If the buffer doesn't have a size, you won't be able to read anything.
         assert(bufferSize > 0);
 
@@ -229,10 +232,10 @@ ErrorType FileSystem::readBlocking(FileSystemTypes::File &file, char *buffer, co
                 std::istream &is = openFiles[key].read(buffer, bufferSize);
 
                 if (is.rdstate() & std::ios_base::eofbit) {
-                    callbackError = ErrorType::EndOfFile;
+                    error = ErrorType::EndOfFile;
                 }
                 else {
-                    callbackError = ErrorType::Success;
+                    error = ErrorType::Success;
                 }
 
                 read = is.gcount();
@@ -244,30 +247,28 @@ ErrorType FileSystem::readBlocking(FileSystemTypes::File &file, char *buffer, co
             }
         }
 
-        readDone = true;
-        OperatingSystem::Instance().unblock(thread);
-        return callbackError;
+        unlockOpenFiles(locked);
+        promise.complete(error);
+        return error;
     };
 
     EventQueue::Event event = EventQueue::Event(readCallback);
     ErrorType error = _storage.addEvent(event);
 
-    if (ErrorType::Success != error) {
+    if (ErrorType::Success != error || ErrorType::Success != (error = readDone.wait())) {
         return error;
     }
 
-    while (!readDone && ErrorType::LimitReached == OperatingSystem::Instance().block());
-
-    return callbackError;
+    return readDone.result();
 }
 
 ErrorType FileSystem::writeBlocking(FileSystemTypes::File &file, std::string_view data) {
-    volatile bool writeDone = false;
-    ErrorType callbackError = ErrorType::PrerequisitesNotMet;
-    Id thread;
-    OperatingSystem::Instance().currentThreadId(thread);
+    EventQueue::Future<> written;
+
+    auto writeCallback = [&, promise = written.promise()]() -> ErrorType {
+        ErrorType error = ErrorType::PrerequisitesNotMet;
+        const bool locked = lockOpenFiles();
 
-    auto writeCallback = [&, thread]() -> ErrorType {
         if (isOpen(file)) {
             const uint32_t key = FileSystemTypes::pathKey(std::string_view(file.path->c_str()));
 
@@ -276,81 +277,77 @@ ErrorType FileSystem::writeBlocking(FileSystemTypes::File &file, std::string_vie
                 if (openFiles[key].seekp(file.filePointer, std::ios_base::beg).good()) {
 
                     if (openFiles[key].write(data.data(), static_cast<std::streamsize>(data.size())).good()) {
-                        callbackError = synchronize(file);
+                        error = synchronize(file);
                         file.size += data.size();
                     }
                 }
                 else {
-                    callbackError = ErrorType::Failure;
+                    error = ErrorType::Failure;
                     openFiles[key].clear();
                 }
             }
         }
 
-        writeDone = true;
-        OperatingSystem::Instance().unblock(thread);
-        return callbackError;
+        unlockOpenFiles(locked);
+        promise.complete(error);
+        return error;
     };
 
     EventQueue::Event event = EventQueue::Event(writeCallback);
     ErrorType error = _storage.addEvent(event);
 
-    if (ErrorType::Success != error) {
+    if (ErrorType::Success != error || ErrorType::Success != (error = written.wait())) {
         return error;
     }
 
-    while (!writeDone && ErrorType::LimitReached == OperatingSystem::Instance().block());
-
-    return error;
+    return written.result();
 }
 
 ErrorType FileSystem::synchronize(const FileSystemTypes::File &file) {
-    volatile bool synchronizeDone = false;
-    ErrorType callbackError = ErrorType::PrerequisitesNotMet;
-    Id thread;
-    OperatingSystem::Instance().currentThreadId(thread);
+    EventQueue::Future<> synchronized;
+
+    auto synchronizeCallback = [&, promise = synchronized.promise()]() -> ErrorType {
+        ErrorType error = ErrorType::PrerequisitesNotMet;
+        const bool locked = lockOpenFiles();
 
-    auto synchronizeCallback = [&, thread]() -> ErrorType {
         if (isOpen(file)) {
             const uint32_t key = FileSystemTypes::pathKey(std::string_view(file.path->c_str()));
 
             if (openFiles[key].flush().good()) {
-                callbackError = ErrorType::Success;
+                error = ErrorType::Success;
             }
             else if (!canWriteToFile(file.openMode)) {
                 //If the file wasn't opened for writing then there is nothing to sync anyway.
                 openFiles[key].clear();
-                callbackError = ErrorType::Success;
+                error = ErrorType::Success;
             }
             else {
                 openFiles[key].clear();
-                callbackError = ErrorType::Failure;
+                error = ErrorType::Failure;
             }
         }
 
-        synchronizeDone = true;
-        OperatingSystem::Instance().unblock(thread);
-        return callbackError;
+        unlockOpenFiles(locked);
+        promise.complete(error);
+        return error;
     };
 
     EventQueue::Event event = EventQueue::Event(synchronizeCallback);
     ErrorType error = _storage.addEvent(event);
-    if (ErrorType::Success != error) {
+    if (ErrorType::Success != error || ErrorType::Success != (error = synchronized.wait())) {
         return error;
     }
 
-    while (!synchronizeDone && ErrorType::LimitReached == OperatingSystem::Instance().block());
-
-    return callbackError;
+    return synchronized.result();
 }
 
 ErrorType FileSystem::size(FileSystemTypes::File &file) {
-    volatile bool sizeQueryDone = false;
-    ErrorType callbackError = ErrorType::PrerequisitesNotMet;
-    Id thread;
-    OperatingSystem::Instance().currentThreadId(thread);
+    EventQueue::Future<> queried;
+
+    auto sizeQueryCallback = [&, promise = queried.promise()]() -> ErrorType {
+        ErrorType error = ErrorType::PrerequisitesNotMet;
+        const bool locked = lockOpenFiles();
 
-    auto sizeQueryCallback = [&, thread]() -> ErrorType {
         if (isOpen(file)) {
             const uint32_t key = FileSystemTypes::pathKey(std::string_view(file.path->c_str()));
 
@@ -358,25 +355,23 @@ ErrorType FileSystem::size(FileSystemTypes::File &file) {
                 file.size = openFiles[key].tellg();
 
                 if (openFiles[key].seekg(0, std::ios_base::beg).good()) {
-                    callbackError = ErrorType::Success;
+                    error = ErrorType::Success;
                 }
             }
 
             openFiles[key].clear();
         }
 
-        sizeQueryDone = true;
-        OperatingSystem::Instance().unblock(thread);
-        return callbackError;
+        unlockOpenFiles(locked);
+        promise.complete(error);
+        return error;
     };
 
     EventQueue::Event event = EventQueue::Event(sizeQueryCallback);
     ErrorType error = _storage.addEvent(event);
-    if (ErrorType::Success != error) {
+    if (ErrorType::Success != error || ErrorType::Success != (error = queried.wait())) {
         return error;
     }
 
-    while (!sizeQueryDone && ErrorType::LimitReached == OperatingSystem::Instance().block());
-
-    return callbackError;
+    return queried.result();
 }
@@ -11,7 +11,8 @@
 class FileSystem final : public FileSystemAbstraction {
 
     public:
-    FileSystem(StorageAbstraction &storage, FileSystemTypes::Implementation implementation, FileSystemTypes::PartitionName partitionName) : FileSystemAbstraction(storage, implementation, partitionName) {}
+    FileSystem(StorageAbstraction &storage, FileSystemTypes::Implementation implementation, FileSystemTypes::PartitionName partitionName);
+    ~FileSystem();
 
     static constexpr Count _MaxOpenFiles = 10;
 
@@ -29,7 +30,19 @@ class FileSystem final : public FileSystemAbstraction {
     ErrorType size(FileSystemTypes::File &file) override;
 
     private:
+    /// @brief The files that are open. Guarded by _openFilesMutex.
     std::map<uint32_t, std::fstream> openFiles;
+    /// @brief Guards openFiles and the streams in it since the storage may run its events on more than one thread. 0 if it couldn't be created.
+    Id _openFilesMutex = 0;
+
+    /**
+     * @brief Lock _openFilesMutex.
+     * @returns true if it was locked and has to be unlocked with unlockOpenFiles. false if the calling thread already holds it, such as
+     *          when one operation calls another, or if there is no mutex.
+     */
+    bool lockOpenFiles();
+    /// @brief Unlock _openFilesMutex if lockOpenFiles locked it.
+    void unlockOpenFiles(const bool locked);
 
     std::ios_base::openmode toStdOpenMode(FileSystemTypes::OpenMode mode, ErrorType &error) {
         error = ErrorType::Success;
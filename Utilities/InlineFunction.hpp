@@ -0,0 +1,145 @@
+/**************************************************************************//**
+* @author Ben Haubrich
+* @file   InlineFunction.hpp
+* @details A callable wrapper that never allocates.
+* @ingroup Utilities
+*******************************************************************************/
+#ifndef __INLINE_FUNCTION_HPP__
+#define __INLINE_FUNCTION_HPP__
+
+//C++
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template <typename Signature, size_t Capacity>
+class InlineFunction;
+
+/**
+ * @class InlineFunction
+ * @brief Like std::function, but the callable is always stored inside the object instead of on the heap.
+ * @details Callables that are too big for the capacity fail to compile rather than falling back to an allocation. Move only, so
+ *          callables that capture move only types such as std::unique_ptr can be stored.
+ * @tparam Return The return type of the callable.
+ * @tparam Args The argument types of the callable.
+ * @tparam Capacity The most bytes the callable and everything it captures can take up.
+ * @code{.cpp}
+ * int counter = 0;
+ * InlineFunction<void(int), 16> add = [&counter](int amount) { counter += amount; };
+ * add(2);
+ * @endcode
+ */
+template <typename Return, typename... Args, size_t Capacity>
+class InlineFunction<Return(Args...), Capacity> {
+
+    public:
+    /// @brief Constructor. Holds no callable.
+    InlineFunction() = default;
+    /// @brief Constructor. Holds no callable.
+    InlineFunction(std::nullptr_t) {}
+
+    /**
+     * @brief Constructor.
+     * @param[in] callable The callable to store. Copied or moved into the inline storage.
+     */
+    template <typename Callable>
+    requires (!std::is_same_v<std::remove_cvref_t<Callable>, InlineFunction> && std::is_invocable_r_v<Return, std::decay_t<Callable> &, Args...>)
+    InlineFunction(Callable &&callable) {
+        using Stored = std::decay_t<Callable>;
+        static_assert(sizeof(Stored) <= Capacity, "The callable captures more than the capacity of the InlineFunction. Capture less or increase the capacity.");
+        static_assert(alignof(Stored) <= alignof(std::max_align_t), "The callable needs stricter alignment than the InlineFunction storage provides.");
+        static_assert(std::is_nothrow_move_constructible_v<Stored>, "The callable must be nothrow move constructible so that moving an InlineFunction can not fail.");
+
+        ::new (static_cast<void *>(_storage)) Stored(std::forward<Callable>(callable));
+        _operations = &OperationsFor<Stored>;
+    }
+
+    /// @brief Move constructor. Leaves other empty.
+    InlineFunction(InlineFunction &&other) noexcept {
+        moveFrom(other);
+    }
+
+    /// @brief Move assignment. Leaves other empty.
+    InlineFunction &operator=(InlineFunction &&other) noexcept {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+
+        return *this;
+    }
+
+    /// @brief Destroy the stored callable.
+    InlineFunction &operator=(std::nullptr_t) {
+        reset();
+        return *this;
+    }
+
+    InlineFunction(const InlineFunction &) = delete;
+    InlineFunction &operator=(const InlineFunction &) = delete;
+
+    /// @brief Destructor.
+    ~InlineFunction() {
+        reset();
+    }
+
+    /// @brief True if a callable is stored.
+    explicit operator bool() const { return nullptr != _operations; }
+
+    /**
+     * @brief Call the stored callable.
+     * @pre A callable is stored.
+     */
+    Return operator()(Args... args) {
+        return _operations->invoke(_storage, std::forward<Args>(args)...);
+    }
+
+    /// @brief Destroy the stored callable so that none is stored.
+    void reset() {
+        if (nullptr != _operations) {
+            _operations->destroy(_storage);
+            _operations = nullptr;
+        }
+    }
+
+    private:
+    /**
+     * @struct Operations
+     * @brief What to do with the type of callable that is stored. One table is shared by every InlineFunction storing the same type.
+     */
+    struct Operations {
+        Return (*invoke)(void *storage, Args &&...args); ///< Call the callable.
+        void (*move)(void *to, void *from);              ///< Move construct the callable into new storage and destroy the old one.
+        void (*destroy)(void *storage);                  ///< Destroy the callable.
+    };
+
+    template <typename Stored>
+    static constexpr Operations OperationsFor = {
+        [](void *storage, Args &&...args) -> Return {
+            return (*static_cast<Stored *>(storage))(std::forward<Args>(args)...);
+        },
+        [](void *to, void *from) {
+            ::new (to) Stored(std::move(*static_cast<Stored *>(from)));
+            static_cast<Stored *>(from)->~Stored();
+        },
+        [](void *storage) {
+            static_cast<Stored *>(storage)->~Stored();
+        }
+    };
+
+    /// @brief The stored callable.
+    alignas(std::max_align_t) unsigned char _storage[Capacity];
+    /// @brief How to use the stored callable. nullptr when none is stored.
+    const Operations *_operations = nullptr;
+
+    void moveFrom(InlineFunction &other) {
+        if (nullptr != other._operations) {
+            other._operations->move(_storage, other._storage);
+            _operations = other._operations;
+            other._operations = nullptr;
+        }
+    }
+};
+
+#endif //__INLINE_FUNCTION_HPP__
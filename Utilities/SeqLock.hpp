@@ -0,0 +1,120 @@
+/**************************************************************************//**
+* @author Ben Haubrich
+* @file   SeqLock.hpp
+* @details Sequence lock for data that is read far more often than it is written.
+* @ingroup Utilities
+*******************************************************************************/
+#ifndef __SEQ_LOCK_HPP__
+#define __SEQ_LOCK_HPP__
+
+//C++
+#include <atomic>
+#include <array>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+
+/**
+ * @class SeqLock
+ * @brief Publishes a value from one writer to any number of readers without readers ever taking a lock.
+ * @details Readers copy the value out and retry if the writer changed it while they were copying. Writers never wait for readers, so a
+ *          status that is polled from many threads costs the thread that updates it nothing. The value is stored as atomic words so that
+ *          a reader copying it while it is being written is not a data race.
+ * @tparam T The type of the value. Must be trivially copyable.
+ * @note There must only be one writer at a time.
+ */
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable_v<T>, "SeqLock values are copied word by word so they must be trivially copyable.");
+
+    public:
+    /// @brief Constructor.
+    SeqLock() : SeqLock(T()) {}
+    /// @brief Constructor.
+    explicit SeqLock(const T &value) : _value(value) {
+        store(value);
+    }
+
+    /**
+     * @brief Get a consistent copy of the value.
+     * @param[out] value The value.
+     * @post Never blocks. Spins only for as long as a write that is in progress takes.
+     */
+    void read(T &value) const {
+        std::array<uintptr_t, Words> words;
+        uint32_t before;
+        uint32_t after;
+
+        do {
+            before = _sequence.load(std::memory_order_acquire);
+            //An odd sequence means a write is in progress.
+            if (0 != (before & 1)) {
+                continue;
+            }
+
+            //Acquire keeps the second load of the sequence from moving ahead of the loads of the words.
+            for (size_t i = 0; i < Words; i++) {
+                words[i] = _words[i].load(std::memory_order_acquire);
+            }
+
+            after = _sequence.load(std::memory_order_relaxed);
+        } while (0 != (before & 1) || before != after);
+
+        std::memcpy(static_cast<void *>(&value), words.data(), sizeof(T));
+    }
+
+    /// @brief Get a consistent copy of the value.
+    T read() const {
+        T value;
+        read(value);
+        return value;
+    }
+
+    /**
+     * @brief Replace the value.
+     * @param[in] value The new value.
+     */
+    void write(const T &value) {
+        _value = value;
+        store(value);
+    }
+
+    /**
+     * @brief Change part of the value.
+     * @details The writer keeps its own copy of the value so that it can change single members without reading the published one back.
+     * @param[in] modify Called with the writer's copy of the value to change it.
+     */
+    template <typename Modify>
+    void update(Modify &&modify) {
+        modify(_value);
+        store(_value);
+    }
+
+    private:
+    /// @brief The number of words needed to hold the value.
+    static constexpr size_t Words = (sizeof(T) + sizeof(uintptr_t) - 1) / sizeof(uintptr_t);
+
+    /// @brief Incremented before and after each write so that it is odd while a write is in progress.
+    std::atomic<uint32_t> _sequence = 0;
+    /// @brief The published value.
+    std::array<std::atomic<uintptr_t>, Words> _words = {};
+    /// @brief The writer's copy of the value. Never read by readers.
+    T _value;
+
+    void store(const T &value) {
+        std::array<uintptr_t, Words> words = {};
+        std::memcpy(words.data(), &value, sizeof(T));
+
+        const uint32_t sequence = _sequence.load(std::memory_order_relaxed);
+        _sequence.store(sequence + 1, std::memory_order_relaxed);
+
+        //Release keeps the odd sequence from being seen after any of the words.
+        for (size_t i = 0; i < Words; i++) {
+            _words[i].store(words[i], std::memory_order_release);
+        }
+
+        _sequence.store(sequence + 2, std::memory_order_release);
+    }
+};
+
+#endif //__SEQ_LOCK_HPP__
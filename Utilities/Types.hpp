@@ -14,6 +14,9 @@
 #include <array>
 
 //-------------------------------Time
+///@typedef Nanoseconds
+///Nanoseconds (ns)
+using Nanoseconds = uint64_t;
 ///@typedef Microseconds
 ///Microseconds (μs)
 using Microseconds = uint64_t;
@@ -48,6 +48,9 @@ endif()
 if (ENABLE_MEMORY_POOL)
   add_subdirectory(${CMAKE_CURRENT_LIST_DIR}/Applications/MemoryPool)
 endif()
+if (ENABLE_THREAD_POOL)
+  add_subdirectory(${CMAKE_CURRENT_LIST_DIR}/Applications/ThreadPool)
+endif()
 if (ENABLE_SM10001)
   add_subdirectory(${CMAKE_CURRENT_LIST_DIR}/Applications/Peripherals/Adafruit/Sm10001)
 endif()